@@ -158,10 +158,8 @@ static void updateRotatingDrawing(tpContext _context, void * _userData, tpBool _
     tpTransform transform = tpTransformMakeTranslation(100, 250);
     tpTransform rot = tpTransformMakeRotation(angle);
     transform = tpTransformCombine(&transform, &rot);
-    // tpPathSetTransform(drawing->path, &transform);
-    tpSetTransform(_context, &transform);
+    tpPathSetTransform(drawing->path, &transform);
     tpDrawPath(_context, drawing->path, &drawing->style);
-    tpResetTransform(_context);
     rotTimer += 0.1;
     angle += (sin(rotTimer) + 1.0) * 0.5 * 0.05;
 }
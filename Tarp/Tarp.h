@@ -37,6 +37,22 @@ See end of file.
 #include <math.h>
 #include <stdio.h>
 #include <float.h>
+#include <limits.h>
+#include <time.h>
+
+/*
+simd, the array functions (i.e. tpTransformApplyArray) use SSE2 or NEON if the compiler targets them.
+Define TARP_NO_SIMD before including tarp to only use the plain C code paths.
+*/
+#if !defined(TARP_NO_SIMD)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TARP_SIMD_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define TARP_SIMD_NEON
+#include <arm_neon.h>
+#endif
+#endif
 
 /* debug */
 #if !defined(NDEBUG)
@@ -68,6 +84,7 @@ memory allocation!
 #ifdef TARP_IMPLEMENTATION_OPENGL
 #ifdef TARP_DEBUG
 #define _TARP_ASSERT_NO_GL_ERROR(_func) do { GLenum glerr; _func; \
+if(_tpGLIsDebugOutputActive()) break; \
 glerr = glGetError(); \
 if(glerr != GL_NO_ERROR) \
 { \
@@ -103,6 +120,19 @@ exit(EXIT_FAILURE); \
 #define TARP_GL_RAMP_TEXTURE_SIZE 1024
 #define TARP_GL_MAX_CLIPPING_STACK_DEPTH 64
 #define TARP_GL_ERROR_MESSAGE_SIZE 512
+#define TARP_GL_MAX_UPLOAD_RANGES 4
+#define TARP_GL_MAX_HIT_GRID_SIZE 256
+#define TARP_GL_MAX_SPATIAL_INDEX_CELLS_PER_PATH 64
+#define TARP_GL_MAX_DAMAGE_RECTS 8
+#define TARP_GL_MAX_LAYER_SIZE 4096
+#define TARP_GL_LAYER_SAMPLES 4
+#define TARP_GL_MAX_DEPTH_SLOTS (1 << 22)
+#define TARP_GL_MAX_OCCLUDERS 16
+#define TARP_GL_GLYPH_BATCH_SIZE 256
+#define TARP_GL_GLYPH_SIZE_BUCKETS 12
+#define TARP_GL_CONTOUR_INLINE_SEGMENTS 8
+#define TARP_GL_COVER_GRID_SIZE 8
+#define TARP_GL_SPARSE_COVER_RATIO 0.5f
 
 #endif /* TARP_IMPLEMENTATION_OPENGL */
 
@@ -111,7 +141,9 @@ exit(EXIT_FAILURE); \
 #define TARP_MAX_DASH_ARRAY_SIZE 64
 #define TARP_MAX_ERROR_MESSAGE 512
 #define TARP_MAX_CURVE_SUBDIVISIONS 16
+#define TARP_MAX_SIMPLIFY_DEPTH 64
 #define TARP_RADIAL_GRADIENT_SLICES 64
+#define TARP_MAX_RADIAL_GRADIENT_SLICES (TARP_RADIAL_GRADIENT_SLICES * 4)
 
 /* some helper macros */
 #define TARP_MIN(a,b) (((a)<(b))?(a):(b))
@@ -166,7 +198,8 @@ typedef enum TARP_API
 {
     kTpPaintTypeNone,
     kTpPaintTypeColor,
-    kTpPaintTypeGradient
+    kTpPaintTypeGradient,
+    kTpPaintTypePattern
 } tpPaintType;
 
 typedef enum TARP_API
@@ -182,6 +215,12 @@ typedef enum TARP_API
     kTpStrokeCapButt
 } tpStrokeCap;
 
+typedef enum TARP_API
+{
+    kTpSmallPathModeSkip,
+    kTpSmallPathModeApproximate
+} tpSmallPathMode;
+
 typedef enum
 {
     kTpStrokeJoinMiter,
@@ -189,6 +228,16 @@ typedef enum
     kTpStrokeJoinBevel
 } tpStrokeJoin;
 
+/* the commands understood by tpPathAddCommands and the number of coordinates each one consumes */
+typedef enum TARP_API
+{
+    kTpPathCommandMoveTo, /* x, y */
+    kTpPathCommandLineTo, /* x, y */
+    kTpPathCommandQuadraticCurveTo, /* hx, hy, x, y */
+    kTpPathCommandCubicCurveTo, /* h0x, h0y, h1x, h1y, x, y */
+    kTpPathCommandClose /* no coordinates */
+} tpPathCommand;
+
 /*
 Basic Types
 ~~~~~~~~~~~~~~~~~~~~~~~~~~
@@ -202,6 +251,11 @@ typedef enum TARP_API
 
 TARP_HANDLE(tpPath);
 TARP_HANDLE(tpGradient);
+TARP_HANDLE(tpSpatialIndex);
+TARP_HANDLE(tpLayer);
+TARP_HANDLE(tpGlyphCache);
+TARP_HANDLE(tpStyleHandle);
+TARP_HANDLE(tpPattern);
 
 /*
 Structures
@@ -251,6 +305,7 @@ typedef union TARP_API
 {
     tpGradient gradient;
     tpColor color;
+    tpPattern pattern;
 } _tpPaintUnion;
 
 typedef struct TARP_API
@@ -274,6 +329,96 @@ typedef struct TARP_API
     tpBool scaleStroke;
 } tpStyle;
 
+/*
+Quality hints of a path (see tpPathSetQualityHints). 1 is the default for each of them, smaller values
+produce coarser geometry that is faster to build and draw, bigger ones finer geometry.
+*/
+typedef struct TARP_API
+{
+    /* scales how closely curves are flattened */
+    tpFloat curveQuality;
+    /* scales the number of segments of round joins and caps */
+    tpFloat roundQuality;
+    /* scales the number of slices radial gradients are drawn with */
+    tpFloat gradientQuality;
+} tpQualityHints;
+
+/* a glyph of a run drawn with tpDrawGlyphRun */
+typedef struct TARP_API
+{
+    /* the id the glyph was added to the cache with */
+    int glyph;
+    /* the position of the glyph's origin on the baseline */
+    tpFloat x, y;
+} tpGlyphInstance;
+
+/*
+Callbacks used by tpPathTessellate to hand the generated geometry to the caller.
+All vertex pointers point directly into Tarp's internal caches and are only valid
+for the duration of the callback. Any of the callbacks can be NULL.
+*/
+typedef struct TARP_API
+{
+    void * userData;
+
+    /*
+    Called once per contour with its flattened polygon. The polygon needs to be rasterized
+    as a triangle fan using the stencil buffer (even-odd or non-zero) as it might be concave or
+    self intersecting.
+    */
+    void (*fillContour)(void * _userData, const tpVec2 * _vertices, int _vertexCount, tpBool _bClosed);
+
+    /*
+    If provided, this is called instead of fillContour with triangle list indices (relative to
+    _vertices) that form the triangle fan of the contour.
+    */
+    void (*fillContourIndexed)(void * _userData, const tpVec2 * _vertices, int _vertexCount,
+                               const unsigned int * _indices, int _indexCount, tpBool _bClosed);
+
+    /* Called once with all stroke triangles (three vertices per triangle) */
+    void (*strokeTriangles)(void * _userData, const tpVec2 * _vertices, int _vertexCount);
+} tpTessellationCallbacks;
+
+/* Options for tpContextCreateWithOptions, use tpContextOptionsMake to get the defaults. */
+typedef struct TARP_API
+{
+    /*
+    If not NULL, the binaries of the linked shader programs are cached in a file in this directory
+    and loaded from it by the next context, which is a lot faster than compiling them.
+    */
+    const char * programCacheDirectory;
+
+    /*
+    Alternatively, a program cache previously retrieved with tpContextProgramCache that the
+    context loads its programs from.
+    */
+    const void * programCacheData;
+    int programCacheSize;
+
+    /*
+    The number of vertices the scratch buffers used to build path geometry start out with. By default
+    they grow as needed.
+    */
+    int vertexCapacityHint;
+
+    /*
+    If true and the OpenGL context is a debug context, errors are reported through the KHR_debug
+    message callback instead of checking glGetError after each call in TARP_DEBUG builds. The messages
+    name the path and drawing pass that caused them and the OpenGL objects created by tarp are labeled.
+    Messages are forwarded to a callback that was installed before the context was created.
+    */
+    tpBool bDebugOutput;
+
+    /*
+    The ramp textures of gradients whose color stops changed are generated in one batch before the next
+    gradient is drawn. If parallelFor is set, it is called with the number of ramps and has to call _job
+    for each index from 0 to _count - 1 before it returns. The jobs are independent of each other,
+    so they can be distributed to your own worker threads. By default they run on the calling thread.
+    */
+    void (*parallelFor)(void * _userData, int _count, void (*_job)(void * _jobData, int _index), void * _jobData);
+    void * parallelForUserData;
+} tpContextOptions;
+
 TARP_HANDLE(tpContext);
 
 /*
@@ -371,6 +516,18 @@ TARP_API tpVec2 tpTransformApply(const tpTransform * _trafo, tpVec2 _vec);
 
 TARP_API tpTransform tpTransformCombine(const tpTransform * _a, const tpTransform * _b);
 
+/*
+Applies the transform to _count points and writes the results to _outPoints. _points and _outPoints
+can be the same array to transform in place. Processes several points at once with SSE2 or NEON.
+*/
+TARP_API void tpTransformApplyArray(const tpTransform * _trafo, const tpVec2 * _points, tpVec2 * _outPoints, int _count);
+
+/*
+Computes the bounds of _count points. If _count is 0, _outMin is set to FLT_MAX and _outMax to -FLT_MAX.
+Processes several points at once with SSE2 or NEON.
+*/
+TARP_API void tpVec2ArrayBounds(const tpVec2 * _points, int _count, tpVec2 * _outMin, tpVec2 * _outMax);
+
 TARP_API tpMat4 tpMat4Make(tpFloat _v0, tpFloat _v1, tpFloat _v2, tpFloat _v3, /* row1 */
                            tpFloat _v4, tpFloat _v5, tpFloat _v6, tpFloat _v7, /* row2 */
                            tpFloat _v8, tpFloat _v9, tpFloat _v10, tpFloat _v11, /* row3 */
@@ -401,6 +558,11 @@ TARP_API tpPath tpPathCreate();
 
 TARP_API tpPath tpPathClone(tpPath _path);
 
+/*
+Destroys a path. This doesn't call into OpenGL, the buffer of the context the path was last drawn in
+is reused by other paths of that context. Paths can be drawn in any number of contexts, but switching
+between them uploads all of the geometry again.
+*/
 TARP_API void tpPathDestroy(tpPath _path);
 
 /* Set the fill transformation */
@@ -409,6 +571,44 @@ TARP_API tpBool tpPathSetFillPaintTransform(tpPath, const tpTransform * _transfo
 /* Set the stroke transformation */
 TARP_API tpBool tpPathSetStrokePaintTransform(tpPath, const tpTransform * _transform);
 
+/*
+Set the transformation of the path, which is applied before the transform of the context. It is combined
+with it on the GPU, so moving, rotating or scaling a path down does not rebuild its geometry unless it has
+a non scaling stroke. Scaling it up beyond the scale it was flattened for does. Hit tests stay in path space.
+*/
+TARP_API tpBool tpPathSetTransform(tpPath _path, const tpTransform * _transform);
+
+/*
+Simplify the flattened contours of the path before they are stroked and filled, so that they
+deviate at most _tolerance pixels from the exact geometry. This drastically reduces the vertex
+count of very detailed paths (i.e. big data plots) when they are drawn zoomed out. The result is
+cached per power of two scale range. A tolerance of zero (the default) disables simplification.
+*/
+TARP_API tpBool tpPathSetSimplifyTolerance(tpPath _path, tpFloat _tolerance);
+
+/*
+Sets the quality hints of the path, i.e. to spend less on background decoration and more on prominent
+artwork. Only the geometry affected by the hints that changed is rebuilt.
+*/
+TARP_API tpBool tpPathSetQualityHints(tpPath _path, const tpQualityHints * _hints);
+
+/*
+Freezes the topology of the flattened path for shape tweening and deformations that move the segments
+every frame without adding or removing any. While frozen, the curve parameters each contour was subdivided
+at are recorded and later changes only evaluate the curves at them again, so the vertex counts of the
+contours stay the same. A contour is subdivided again if its number of curves, the flattening tolerance
+or whether it is closed changes. Frozen contours are not simplified (see tpPathSetSimplifyTolerance).
+*/
+TARP_API tpBool tpPathSetFrozenTopology(tpPath _path, tpBool _bFrozen);
+
+/*
+Adds a new contour from _count points stored in the _xy array (x0, y0, x1, y1...). The points
+are stored compactly and connected with straight lines, which skips curve flattening entirely.
+This is the fastest way to add large polylines such as data plots to a path. tpPathLineTo
+appends to a polyline contour directly, curve commands turn it into a regular contour.
+*/
+TARP_API tpBool tpPathAddPolyline(tpPath _path, const tpFloat * _xy, int _count, tpBool _bClosed);
+
 /* Adds a circle contour to the provided path */
 TARP_API tpBool tpPathAddCircle(tpPath _path, tpFloat _x, tpFloat _y, tpFloat _r);
 
@@ -436,6 +636,15 @@ TARP_API tpBool tpPathQuadraticCurveTo(tpPath _path, tpFloat _hx, tpFloat _hy, t
 /* Closes the current contour */
 TARP_API tpBool tpPathClose(tpPath _path);
 
+/*
+Appends _commandCount commands to the path, taking their coordinates from the _coords array in order
+(see tpPathCommand). This behaves like calling tpPathMoveTo, tpPathLineTo etc. for each command, but
+writes the segments straight into the contour storage, which makes it the fastest way to import
+paths from svg or font data.
+*/
+TARP_API tpBool tpPathAddCommands(tpPath _path, const tpPathCommand * _commands, int _commandCount,
+                                  const tpFloat * _coords, int _coordCount);
+
 /* Removes all contours from the path */
 TARP_API tpBool tpPathClear(tpPath _path);
 
@@ -464,6 +673,29 @@ a new contour will be added to the path.
  */
 TARP_API tpBool tpPathSetContour(tpPath _path, int _contourIndex, tpSegment * _segments, int _count, tpBool _bClosed);
 
+/*
+Flattens and strokes the path with the provided style without issuing any rendering calls and
+streams the resulting geometry to the provided callbacks. _scale is the scale the geometry will be
+displayed at, which determines the flattening tolerance. If the style uses a non scaling stroke,
+the geometry is generated in the space scaled by _scale.
+The internal geometry caches of the path are used and updated, just like when drawing it.
+*/
+TARP_API tpBool tpPathTessellate(tpPath _path, const tpStyle * _style, tpFloat _scale, const tpTessellationCallbacks * _callbacks);
+
+/*
+Returns tpTrue if the point (in path space) lies inside the fill of the path using the provided fill rule.
+The test runs against the cached flattened geometry and a lazily built acceleration grid, so repeated
+queries on an unchanged path are cheap.
+*/
+TARP_API tpBool tpPathHitTestFill(tpPath _path, tpFloat _x, tpFloat _y, tpFillRule _fillRule);
+
+/*
+Returns tpTrue if the point (in path space) lies inside the stroke geometry the provided style
+produces, including joins, caps and dashes. Non scaling strokes are tested as if the path was
+drawn without a transform.
+*/
+TARP_API tpBool tpPathHitTestStroke(tpPath _path, const tpStyle * _style, tpFloat _x, tpFloat _y);
+
 /* generates tpPathInvalidHandle() and tpPathIsValidHandle(tpPath) functions to generate
 an invalid handle and check a handle for validity. */
 TARP_HANDLE_FUNCTIONS(tpPath)
@@ -480,6 +712,9 @@ TARP_API tpPaint tpPaintMakeColor(tpFloat _r, tpFloat _g, tpFloat _b, tpFloat _a
 /* creates a gradient paint */
 TARP_API tpPaint tpPaintMakeGradient(tpGradient _gradient);
 
+/* creates a pattern paint, it is placed by the fill or stroke paint transform of the path it is drawn with */
+TARP_API tpPaint tpPaintMakePattern(tpPattern _pattern);
+
 /*
 Style Functions
 ~~~~~~~~~~~~~~~~~~~~~~~~~~
@@ -488,6 +723,66 @@ Style Functions
 /* default initializes and returns a tpStyle struct. */
 TARP_API tpStyle tpStyleMake();
 
+/* returns the default tpQualityHints. */
+TARP_API tpQualityHints tpQualityHintsMake();
+
+/*
+Style handles hold a copy of a tpStyle (including its dash array) together with a version that changes
+whenever the style is modified. Drawing with a handle (see tpDrawPathWithStyle) lets the renderer check if
+the cached stroke of a path is still valid by comparing that version instead of every stroke property.
+Prefer them over plain tpStyle structs for styles that are used many times.
+*/
+
+/* Creates a style handle with the default style (see tpStyleMake). */
+TARP_API tpStyleHandle tpStyleCreate();
+
+/* Creates a style handle holding a copy of _style. */
+TARP_API tpStyleHandle tpStyleCreateFrom(const tpStyle * _style);
+
+/* Creates a copy of a style handle */
+TARP_API tpStyleHandle tpStyleClone(tpStyleHandle _style);
+
+TARP_API void tpStyleDestroy(tpStyleHandle _style);
+
+/* Replaces the whole style. Fails if _style has more than TARP_MAX_DASH_ARRAY_SIZE dashes. */
+TARP_API tpBool tpStyleSet(tpStyleHandle _style, const tpStyle * _from);
+
+/* Returns the style. Its dashArray points into the handle and stays valid until the handle changes. */
+TARP_API tpStyle tpStyleGet(tpStyleHandle _style);
+
+TARP_API void tpStyleSetFill(tpStyleHandle _style, tpPaint _paint);
+
+TARP_API void tpStyleSetFillColor(tpStyleHandle _style, tpFloat _r, tpFloat _g, tpFloat _b, tpFloat _a);
+
+TARP_API void tpStyleSetFillGradient(tpStyleHandle _style, tpGradient _gradient);
+
+TARP_API void tpStyleSetFillRule(tpStyleHandle _style, tpFillRule _fillRule);
+
+TARP_API void tpStyleSetStroke(tpStyleHandle _style, tpPaint _paint);
+
+TARP_API void tpStyleSetStrokeColor(tpStyleHandle _style, tpFloat _r, tpFloat _g, tpFloat _b, tpFloat _a);
+
+TARP_API void tpStyleSetStrokeGradient(tpStyleHandle _style, tpGradient _gradient);
+
+TARP_API void tpStyleSetStrokeWidth(tpStyleHandle _style, tpFloat _width);
+
+TARP_API void tpStyleSetStrokeJoin(tpStyleHandle _style, tpStrokeJoin _join);
+
+TARP_API void tpStyleSetStrokeCap(tpStyleHandle _style, tpStrokeCap _cap);
+
+TARP_API void tpStyleSetMiterLimit(tpStyleHandle _style, tpFloat _limit);
+
+TARP_API void tpStyleSetScaleStroke(tpStyleHandle _style, tpBool _bScaleStroke);
+
+/* Sets the dash pattern, pass 0 for _count to remove it. Fails if _count is bigger than TARP_MAX_DASH_ARRAY_SIZE. */
+TARP_API tpBool tpStyleSetDashArray(tpStyleHandle _style, const tpFloat * _dashArray, int _count);
+
+TARP_API void tpStyleSetDashOffset(tpStyleHandle _style, tpFloat _offset);
+
+/* generates tpStyleHandleInvalidHandle() and tpStyleHandleIsValidHandle(tpStyleHandle) functions to generate
+an invalid handle and check a handle for validity. */
+TARP_HANDLE_FUNCTIONS(tpStyleHandle)
+
 /*
 Gradient Functions
 ~~~~~~~~~~~~~~~~~~~~~~~~~~
@@ -523,6 +818,7 @@ TARP_API void tpGradientAddColorStop(tpGradient _gradient, tpFloat _r, tpFloat _
 /* remove all color stops */
 TARP_API void tpGradientClearColorStops(tpGradient _gradient);
 
+/* Destroys a gradient and its ramp texture, which needs the context it was created in to be current. */
 TARP_API void tpGradientDestroy(tpGradient _gradient);
 
 /* generates tpGradientInvalidHandle() and tpGradientIsValidHandle(tpGradient) functions to generate
@@ -530,6 +826,128 @@ an invalid handle and check a handle for validity. */
 TARP_HANDLE_FUNCTIONS(tpGradient)
 
 
+/*
+Spatial Index Functions
+~~~~~~~~~~~~~~~~~~~~~~~~~~
+A spatial index keeps track of the bounds of a lot of paths to quickly find the ones that touch
+a region, i.e. for culling, picking or computing dirty rectangles.
+*/
+
+/*
+Creates a spatial index. _cellSize is the size of the grid cells in the space of the transforms
+that paths are inserted with. Something around the size of a typical path works well.
+*/
+TARP_API tpSpatialIndex tpSpatialIndexCreate(tpFloat _cellSize);
+
+TARP_API void tpSpatialIndexDestroy(tpSpatialIndex _index);
+
+/*
+Adds a path to the index or updates it if it was added before. The path is indexed by its bounds
+when drawn with _style under _transform (NULL for none). Call this again whenever the path, style
+or transform changes. Paths need to be removed before they are destroyed.
+*/
+TARP_API tpBool tpSpatialIndexInsert(tpSpatialIndex _index, tpPath _path, const tpStyle * _style, const tpTransform * _transform);
+
+/* Removes a path from the index */
+TARP_API tpBool tpSpatialIndexRemove(tpSpatialIndex _index, tpPath _path);
+
+/* Removes all paths from the index */
+TARP_API void tpSpatialIndexClear(tpSpatialIndex _index);
+
+/*
+Writes up to _maxCount of the paths whose bounds overlap the provided rectangle to _outPaths
+and returns the total number of overlapping paths.
+*/
+TARP_API int tpSpatialIndexQuery(tpSpatialIndex _index, tpFloat _minX, tpFloat _minY, tpFloat _maxX, tpFloat _maxY,
+                                 tpPath * _outPaths, int _maxCount);
+
+/* generates tpSpatialIndexInvalidHandle() and tpSpatialIndexIsValidHandle(tpSpatialIndex) functions to generate
+an invalid handle and check a handle for validity. */
+TARP_HANDLE_FUNCTIONS(tpSpatialIndex)
+
+
+/*
+Layer Related Functions
+~~~~~~~~~~~~~~~~~~~~~~~~~~
+*/
+
+/*
+Creates a layer. A layer records the draw calls between tpBeginLayer and tpEndLayer and caches their
+rendering in an offscreen texture. Drawing it with tpDrawLayer only draws a single textured quad, as long
+as none of its paths or gradients changed and it is not scaled past the resolution it was rendered at.
+*/
+TARP_API tpLayer tpLayerCreate();
+
+/* destroys a layer and its texture, which needs the context it was rendered in to be current */
+TARP_API void tpLayerDestroy(tpLayer _layer);
+
+/* generates tpLayerInvalidHandle() and tpLayerIsValidHandle(tpLayer) functions to generate
+an invalid handle and check a handle for validity. */
+TARP_HANDLE_FUNCTIONS(tpLayer)
+
+
+/*
+Pattern Functions
+~~~~~~~~~~~~~~~~~~~~~~~~~~
+A pattern repeats a tile in both directions of the paint space. The tile is the rect from (0, 0) to
+(_tileWidth, _tileHeight) and holds a list of paths drawn with their styles. Tarp renders it into a texture
+once, and again only if one of the paths or gradients changed or the pattern is drawn at a higher resolution,
+so a pattern paint only costs a texture lookup per pixel no matter how many paths the tile holds.
+*/
+
+TARP_API tpPattern tpPatternCreate(tpFloat _tileWidth, tpFloat _tileHeight);
+
+/* Destroys a pattern and its tile texture, which needs the context it was rendered in to be current. */
+TARP_API void tpPatternDestroy(tpPattern _pattern);
+
+/*
+Adds a path in tile coordinates, drawn with _style, to the tile. Anything outside of the tile is cut off. The path
+and the gradients of the style need to stay alive for as long as the pattern is drawn. The style can't use a
+pattern paint itself.
+*/
+TARP_API tpBool tpPatternAddPath(tpPattern _pattern, tpPath _path, const tpStyle * _style);
+
+/* Removes all paths from the tile. */
+TARP_API void tpPatternClear(tpPattern _pattern);
+
+/* generates tpPatternInvalidHandle() and tpPatternIsValidHandle(tpPattern) functions to generate
+an invalid handle and check a handle for validity. */
+TARP_HANDLE_FUNCTIONS(tpPattern)
+
+
+/*
+Glyph Cache Functions
+~~~~~~~~~~~~~~~~~~~~~~~~~~
+A glyph cache holds the outlines of the glyphs of a font and their flattened geometry per power of two size
+bucket, so text can be drawn without a path per glyph. Tarp does not load fonts, the outlines come from
+whatever font library you use (i.e. stb_truetype).
+*/
+
+/* Creates a glyph cache for a font with _unitsPerEm font units per em (i.e. 2048 for most TrueType fonts). */
+TARP_API tpGlyphCache tpGlyphCacheCreate(tpFloat _unitsPerEm);
+
+/* Destroys a glyph cache. Like tpPathDestroy, this doesn't call into OpenGL. */
+TARP_API void tpGlyphCacheDestroy(tpGlyphCache _cache);
+
+/*
+Adds the outline of a glyph or replaces it if _glyph was added before. The outline is in font units with the
+y axis pointing up and described by the same commands and coordinates as in tpPathAddCommands. The vertices
+of stbtt_GetGlyphShape map directly to them: vmove, vline, vcurve and vcubic are move to, line to, quadratic
+and cubic curve to with the coordinates cx, cy, (cx1, cy1,) x, y. Quadratic curves are converted to the
+equivalent cubic curves.
+Replacing a glyph discards the geometry cached for all glyphs.
+*/
+TARP_API tpBool tpGlyphCacheAddGlyph(tpGlyphCache _cache, int _glyph, const tpPathCommand * _commands, int _commandCount,
+                                     const tpFloat * _coords, int _coordCount);
+
+/* Returns tpTrue if the outline of _glyph was added to the cache. */
+TARP_API tpBool tpGlyphCacheHasGlyph(tpGlyphCache _cache, int _glyph);
+
+/* generates tpGlyphCacheInvalidHandle() and tpGlyphCacheIsValidHandle(tpGlyphCache) functions to generate
+an invalid handle and check a handle for validity. */
+TARP_HANDLE_FUNCTIONS(tpGlyphCache)
+
+
 /*
 Context Related Functions
 ~~~~~~~~~~~~~~~~~~~~~~~~~~
@@ -538,7 +956,21 @@ Context Related Functions
 /* Call this to initialize a tarp context. */
 TARP_API tpContext tpContextCreate();
 
-/* shut down a context */
+/* Returns the default context options */
+TARP_API tpContextOptions tpContextOptionsMake();
+
+/* Initializes a tarp context with the provided options. */
+TARP_API tpContext tpContextCreateWithOptions(const tpContextOptions * _options);
+
+/*
+Copies the program cache of a context to _outData if it is at least _maxSize bytes big and returns
+its size, or 0 if program caching is not enabled or not supported by the driver. Pass it to
+tpContextOptions.programCacheData to speed up the creation of later contexts.
+Cached programs that the driver rejects (i.e. after a driver update) are simply compiled again.
+*/
+TARP_API int tpContextProgramCache(tpContext _ctx, void * _outData, int _maxSize);
+
+/* shut down a context, which needs its OpenGL context to be current */
 TARP_API void tpContextDestroy(tpContext _ctx);
 
 /* Call this at the beginning of a "frame" before you call any draw functions */
@@ -559,6 +991,21 @@ TARP_API tpBool tpResetTransform(tpContext _ctx);
 /* Draw a path with the provided style */
 TARP_API tpBool tpDrawPath(tpContext _ctx, tpPath _path, const tpStyle * _style);
 
+/*
+Draw a path with a style handle. This is the same as tpDrawPath, but the cached stroke of the path is
+validated by comparing the version of the style instead of all of its properties.
+*/
+TARP_API tpBool tpDrawPathWithStyle(tpContext _ctx, tpPath _path, tpStyleHandle _style);
+
+/*
+Draws a run of glyphs of _cache with _color at _size units per em in the space of the current transform.
+The outlines are flipped so that they stand upright on their baseline with a y down projection and filled
+with the non zero rule. All glyphs of a run are drawn together, with one stencil and one cover pass and one
+instanced draw per distinct glyph. Glyphs that were not added to the cache (i.e. spaces) are skipped.
+*/
+TARP_API tpBool tpDrawGlyphRun(tpContext _ctx, tpGlyphCache _cache, const tpGlyphInstance * _glyphs, int _count,
+                               tpFloat _size, tpColor _color);
+
 /*
 Define a clipping path. You can nest these calls. All following draw
 calls will be clippied by the provided path.
@@ -571,6 +1018,67 @@ TARP_API tpBool tpEndClipping(tpContext _ctx);
 /* End all clipping paths. This will remove all clipping. */
 TARP_API tpBool tpResetClipping(tpContext _ctx);
 
+/*
+Enables or disables retained mode. In retained mode, the draw and clipping calls between tpPrepareDrawing
+and tpFinishDrawing are only recorded. tpFinishDrawing compares them to the previous frame and only
+redraws the regions of the framebuffer that changed, after clearing them to _clearColor.
+The framebuffer contents need to be preserved between frames for this to work (i.e. by rendering to a
+texture) and you must not clear the color buffer yourself. Paths, gradients and glyph caches need to stay
+alive until tpFinishDrawing was called.
+*/
+TARP_API tpBool tpSetRetainedMode(tpContext _ctx, tpBool _bEnabled, tpColor _clearColor);
+
+/* Forces the next retained frame to redraw everything, i.e. if the framebuffer contents were lost. */
+TARP_API void tpInvalidateRetainedFrame(tpContext _ctx);
+
+/*
+Writes up to _maxCount of the rectangles redrawn by the last retained frame to _outRects (as x, y, width
+and height in window pixels, just like glScissor) and returns their total number. Useful to only present the
+damaged parts of the window.
+*/
+TARP_API int tpRetainedDamage(tpContext _ctx, int * _outRects, int _maxCount);
+
+/*
+All following draw and clipping calls are recorded into _layer instead of being drawn, until tpEndLayer is
+called. The current transform at the time of recording is relative to the transform the layer is drawn with.
+Layers can't be nested. The paths, gradients and glyph caches drawn need to stay alive for as long as the layer
+is drawn.
+*/
+TARP_API tpBool tpBeginLayer(tpContext _ctx, tpLayer _layer);
+
+/* Ends recording the current layer. If nothing changed compared to last time, its cached rendering is kept. */
+TARP_API tpBool tpEndLayer(tpContext _ctx);
+
+/* Draws a layer with the current transform, rendering it again first if needed. */
+TARP_API tpBool tpDrawLayer(tpContext _ctx, tpLayer _layer);
+
+/*
+Enables or disables depth ordering. With depth ordering, the draw calls between tpPrepareDrawing and
+tpFinishDrawing are recorded and each one is assigned its own depth. tpFinishDrawing then draws the opaque
+ones first, grouped by paint and front to back, so the depth test rejects the pixels they hide early and the
+translucent ones in their original order afterwards. This needs a depth buffer which tarp overwrites.
+Paths, gradients and glyph caches need to stay alive until tpFinishDrawing was called. Works together with
+retained mode.
+*/
+TARP_API tpBool tpSetDepthOrdering(tpContext _ctx, tpBool _bEnabled);
+
+/*
+Enables or disables occlusion culling. Like with depth ordering, the draw calls of a frame are recorded.
+tpFinishDrawing then skips the ones that are entirely covered by the opaque fill of a later convex path
+without a clipping call in between, before anything about them is built, uploaded or drawn.
+*/
+TARP_API tpBool tpSetOcclusionCulling(tpContext _ctx, tpBool _bEnabled);
+
+/*
+Sets the size in pixels below which paths are not drawn with the usual stencil and cover passes. A path
+whose bounds on screen are smaller than _pixels in both dimensions is skipped with kTpSmallPathModeSkip
+or drawn as a single quad with the color of its paint and an opacity that approximates the area it covers
+with kTpSmallPathModeApproximate. Paths without any area on screen are always skipped. Only the cached
+bounds (or the control points) and the current transform are used, nothing is flattened. 0, the default,
+disables this. Clipping paths are never affected.
+*/
+TARP_API tpBool tpSetMinimumPathSize(tpContext _ctx, tpFloat _pixels, tpSmallPathMode _mode);
+
 /* Returns a string identifier of the current implementation */
 TARP_API const char * tpImplementationName();
 
@@ -886,6 +1394,106 @@ TARP_API tpTransform tpTransformCombine(const tpTransform * _a, const tpTransfor
     return ret;
 }
 
+TARP_API void tpTransformApplyArray(const tpTransform * _trafo, const tpVec2 * _points, tpVec2 * _outPoints, int _count)
+{
+    int i = 0;
+    tpFloat x;
+    const tpFloat * m = _trafo->m.v;
+
+#if defined(TARP_SIMD_SSE2)
+    /* two interleaved points per register, the columns of the matrix are repeated accordingly */
+    __m128 c0 = _mm_setr_ps(m[0], m[1], m[0], m[1]);
+    __m128 c1 = _mm_setr_ps(m[2], m[3], m[2], m[3]);
+    __m128 t = _mm_setr_ps(_trafo->t.x, _trafo->t.y, _trafo->t.x, _trafo->t.y);
+    __m128 a, b;
+    for (; i + 4 <= _count; i += 4)
+    {
+        a = _mm_loadu_ps(&_points[i].x);
+        b = _mm_loadu_ps(&_points[i + 2].x);
+        _mm_storeu_ps(&_outPoints[i].x, _mm_add_ps(_mm_add_ps(
+                          _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 2, 0, 0)), c0),
+                          _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 1, 1)), c1)), t));
+        _mm_storeu_ps(&_outPoints[i + 2].x, _mm_add_ps(_mm_add_ps(
+                          _mm_mul_ps(_mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 2, 0, 0)), c0),
+                          _mm_mul_ps(_mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 3, 1, 1)), c1)), t));
+    }
+#elif defined(TARP_SIMD_NEON)
+    /* four points per iteration, deinterleaved into x and y registers */
+    float32x4x2_t v, r;
+    for (; i + 4 <= _count; i += 4)
+    {
+        v = vld2q_f32(&_points[i].x);
+        r.val[0] = vmlaq_n_f32(vmlaq_n_f32(vdupq_n_f32(_trafo->t.x), v.val[0], m[0]), v.val[1], m[2]);
+        r.val[1] = vmlaq_n_f32(vmlaq_n_f32(vdupq_n_f32(_trafo->t.y), v.val[0], m[1]), v.val[1], m[3]);
+        vst2q_f32(&_outPoints[i].x, r);
+    }
+#endif
+
+    for (; i < _count; ++i)
+    {
+        x = _points[i].x;
+        _outPoints[i].x = x * m[0] + _points[i].y * m[2] + _trafo->t.x;
+        _outPoints[i].y = x * m[1] + _points[i].y * m[3] + _trafo->t.y;
+    }
+}
+
+TARP_API void tpVec2ArrayBounds(const tpVec2 * _points, int _count, tpVec2 * _outMin, tpVec2 * _outMax)
+{
+    int i = 0;
+    tpVec2 mn = {FLT_MAX, FLT_MAX};
+    tpVec2 mx = { -FLT_MAX, -FLT_MAX};
+
+#if defined(TARP_SIMD_SSE2)
+    /* keeps the minimum and maximum of the even and odd points in the two halves of the registers */
+    __m128 vmin = _mm_set1_ps(FLT_MAX);
+    __m128 vmax = _mm_set1_ps(-FLT_MAX);
+    __m128 a;
+    tpFloat tmp[4];
+    for (; i + 2 <= _count; i += 2)
+    {
+        a = _mm_loadu_ps(&_points[i].x);
+        vmin = _mm_min_ps(vmin, a);
+        vmax = _mm_max_ps(vmax, a);
+    }
+    _mm_storeu_ps(tmp, vmin);
+    mn = tpVec2Make(TARP_MIN(tmp[0], tmp[2]), TARP_MIN(tmp[1], tmp[3]));
+    _mm_storeu_ps(tmp, vmax);
+    mx = tpVec2Make(TARP_MAX(tmp[0], tmp[2]), TARP_MAX(tmp[1], tmp[3]));
+#elif defined(TARP_SIMD_NEON)
+    float32x4x2_t v;
+    float32x4_t minx = vdupq_n_f32(FLT_MAX), miny = minx;
+    float32x4_t maxx = vdupq_n_f32(-FLT_MAX), maxy = maxx;
+    float32x2_t r;
+    for (; i + 4 <= _count; i += 4)
+    {
+        v = vld2q_f32(&_points[i].x);
+        minx = vminq_f32(minx, v.val[0]);
+        miny = vminq_f32(miny, v.val[1]);
+        maxx = vmaxq_f32(maxx, v.val[0]);
+        maxy = vmaxq_f32(maxy, v.val[1]);
+    }
+    r = vpmin_f32(vget_low_f32(minx), vget_high_f32(minx));
+    mn.x = TARP_MIN(vget_lane_f32(r, 0), vget_lane_f32(r, 1));
+    r = vpmin_f32(vget_low_f32(miny), vget_high_f32(miny));
+    mn.y = TARP_MIN(vget_lane_f32(r, 0), vget_lane_f32(r, 1));
+    r = vpmax_f32(vget_low_f32(maxx), vget_high_f32(maxx));
+    mx.x = TARP_MAX(vget_lane_f32(r, 0), vget_lane_f32(r, 1));
+    r = vpmax_f32(vget_low_f32(maxy), vget_high_f32(maxy));
+    mx.y = TARP_MAX(vget_lane_f32(r, 0), vget_lane_f32(r, 1));
+#endif
+
+    for (; i < _count; ++i)
+    {
+        mn.x = TARP_MIN(_points[i].x, mn.x);
+        mn.y = TARP_MIN(_points[i].y, mn.y);
+        mx.x = TARP_MAX(_points[i].x, mx.x);
+        mx.y = TARP_MAX(_points[i].y, mx.y);
+    }
+
+    *_outMin = mn;
+    *_outMax = mx;
+}
+
 TARP_API tpMat4 tpMat4Make(tpFloat _v0, tpFloat _v1, tpFloat _v2, tpFloat _v3,
                            tpFloat _v4, tpFloat _v5, tpFloat _v6, tpFloat _v7,
                            tpFloat _v8, tpFloat _v9, tpFloat _v10, tpFloat _v11,
@@ -979,6 +1587,14 @@ TARP_API tpPaint tpPaintMakeGradient(tpGradient _gradient)
     return ret;
 }
 
+TARP_API tpPaint tpPaintMakePattern(tpPattern _pattern)
+{
+    tpPaint ret;
+    ret.data.pattern = _pattern;
+    ret.type = kTpPaintTypePattern;
+    return ret;
+}
+
 #ifdef TARP_IMPLEMENTATION_OPENGL
 
 /* @TODO: Clean up the layout of all the structs */
@@ -991,6 +1607,39 @@ TARP_LOCAL void _tpGLSetErrorMessage(const char * _message)
     strcpy(__g_error, _message);
 }
 
+/*
+checks if the context that is currently drawing (or being created) reports OpenGL errors through the debug
+message callback (see tpContextOptions.bDebugOutput), in which case _TARP_ASSERT_NO_GL_ERROR doesn't call
+glGetError and objects get labeled.
+*/
+TARP_LOCAL tpBool _tpGLIsDebugOutputActive();
+
+/* labels an OpenGL object so that debug messages and graphics debuggers can tell what it is used for */
+TARP_LOCAL void _tpGLObjectLabel(GLenum _identifier, GLuint _name, const char * _label, const void * _owner)
+{
+    /* the labels passed in are short, leave room for the pointer */
+    char label[96];
+    if (!_tpGLIsDebugOutputActive())
+        return;
+    if (_owner && strlen(_label) < 48)
+    {
+        sprintf(label, "%s %p", _label, _owner);
+        _label = label;
+    }
+    glObjectLabel(_identifier, _name, -1, _label);
+}
+
+/*
+global counter to hand out versions to paths and gradients whenever they change (see tpSetRetainedMode).
+Not thread safe, just like the gradient ids.
+*/
+TARP_LOCAL int __g_version;
+
+TARP_LOCAL int _tpGLNextVersion()
+{
+    return ++__g_version;
+}
+
 /* The shader programs used by the renderer */
 static const char * _vertexShaderCode =
     "#version 150 \n"
@@ -1035,11 +1684,71 @@ static const char * _fragmentShaderCodeTexture =
     "pixelColor = texture(tex, itc); \n"
     "} \n";
 
-typedef struct _tpGLContext _tpGLContext;
+static const char * _vertexShaderCodeLayer =
+    "#version 150 \n"
+    "uniform mat4 transformProjection; \n"
+    "in vec2 vertex; \n"
+    "in vec2 tc; \n"
+    "out vec2 itc;\n"
+    "void main() \n"
+    "{ \n"
+    "gl_Position = transformProjection * vec4(vertex, 0.0, 1.0); \n"
+    "itc = tc; \n"
+    "} \n";
 
-typedef enum TARP_LOCAL
-{
-    /*
+static const char * _fragmentShaderCodeLayer =
+    "#version 150 \n"
+    "uniform sampler2D tex;\n"
+    "in vec2 itc; \n"
+    "out vec4 pixelColor; \n"
+    "void main() \n"
+    "{ \n"
+    "pixelColor = texture(tex, itc); \n"
+    "} \n";
+
+/*
+covers a path with a pattern, the texture coordinates are the vertex position in tiles. It uses the layer fragment
+shader to sample the tile.
+*/
+static const char * _vertexShaderCodePattern =
+    "#version 150 \n"
+    "uniform mat4 transformProjection; \n"
+    "uniform mat3 patternTransform; \n"
+    "in vec2 vertex; \n"
+    "out vec2 itc;\n"
+    "void main() \n"
+    "{ \n"
+    "gl_Position = transformProjection * vec4(vertex, 0.0, 1.0); \n"
+    "itc = (patternTransform * vec3(vertex, 1.0)).xy; \n"
+    "} \n";
+
+#define _TARP_GL_STRINGIFY_H(_x) #_x
+#define _TARP_GL_STRINGIFY(_x) _TARP_GL_STRINGIFY_H(_x)
+
+/*
+places the instances of a glyph (see tpDrawGlyphRun), two glyph origins are packed into each vec4. Only used
+to write the stencil, so the color does not matter.
+*/
+static const char * _vertexShaderCodeGlyph =
+    "#version 150 \n"
+    "uniform mat4 transformProjection; \n"
+    "uniform float glyphScale; \n"
+    "uniform vec4 glyphOffsets[" _TARP_GL_STRINGIFY(TARP_GL_GLYPH_BATCH_SIZE) " / 2]; \n"
+    "in vec2 vertex; \n"
+    "out vec4 icol;\n"
+    "void main() \n"
+    "{ \n"
+    "vec4 offsets = glyphOffsets[gl_InstanceID / 2]; \n"
+    "vec2 offset = gl_InstanceID % 2 == 0 ? offsets.xy : offsets.zw; \n"
+    "gl_Position = transformProjection * vec4(vertex * vec2(glyphScale, -glyphScale) + offset, 0.0, 1.0); \n"
+    "icol = vec4(0.0); \n"
+    "} \n";
+
+typedef struct _tpGLContext _tpGLContext;
+
+typedef enum TARP_LOCAL
+{
+    /*
     The mask values are important! FillRaster needs to have at least
     2 bits. These need to be the lower bits in order to work with the
     Increment, Decrement stencil operations
@@ -1066,6 +1775,10 @@ typedef struct TARP_LOCAL
     _tpGLCurve first, second;
 } _tpGLCurvePair;
 
+#define _TARP_ARRAY_T _tpIntArray
+#define _TARP_ITEM_T int
+#include <Tarp/TarpArray.h>
+
 #define _TARP_ARRAY_T _tpFloatArray
 #define _TARP_ITEM_T tpFloat
 #include <Tarp/TarpArray.h>
@@ -1074,6 +1787,10 @@ typedef struct TARP_LOCAL
 #define _TARP_ITEM_T tpBool
 #include <Tarp/TarpArray.h>
 
+#define _TARP_ARRAY_T _tpCharArray
+#define _TARP_ITEM_T char
+#include <Tarp/TarpArray.h>
+
 #define _TARP_ARRAY_T _tpSegmentArray
 #define _TARP_ITEM_T tpSegment
 #define _TARP_COMPARATOR_T 0
@@ -1089,9 +1806,96 @@ typedef struct TARP_LOCAL
 #define _TARP_COMPARATOR_T 0
 #include <Tarp/TarpArray.h>
 
+/*
+the segments of a contour. Up to TARP_GL_CONTOUR_INLINE_SEGMENTS segments are stored inside of the
+contour itself, so the many small contours of glyphs and icons don't need an allocation each. Bigger
+contours move their segments to the heap. As contours are moved around in memory, the segments are
+always accessed through _tpGLSegmentBufferData instead of a stored pointer.
+*/
+typedef struct TARP_LOCAL
+{
+    int count;
+    int capacity;
+    tpSegment * heap;
+    tpSegment local[TARP_GL_CONTOUR_INLINE_SEGMENTS];
+} _tpGLSegmentBuffer;
+
+TARP_LOCAL void _tpGLSegmentBufferInit(_tpGLSegmentBuffer * _buf)
+{
+    _buf->count = 0;
+    _buf->capacity = TARP_GL_CONTOUR_INLINE_SEGMENTS;
+    _buf->heap = NULL;
+}
+
+TARP_LOCAL void _tpGLSegmentBufferDeallocate(_tpGLSegmentBuffer * _buf)
+{
+    if (_buf->heap)
+        TARP_FREE(_buf->heap);
+    _tpGLSegmentBufferInit(_buf);
+}
+
+TARP_LOCAL tpSegment * _tpGLSegmentBufferData(_tpGLSegmentBuffer * _buf)
+{
+    return _buf->heap ? _buf->heap : _buf->local;
+}
+
+TARP_LOCAL tpSegment * _tpGLSegmentBufferAtPtr(_tpGLSegmentBuffer * _buf, int _index)
+{
+    assert(_index >= 0 && _index < _buf->count);
+    return _tpGLSegmentBufferData(_buf) + _index;
+}
+
+TARP_LOCAL int _tpGLSegmentBufferReserve(_tpGLSegmentBuffer * _buf, int _capacity)
+{
+    tpSegment * mem;
+
+    if (_capacity <= _buf->capacity)
+        return 0;
+
+    if (_buf->heap)
+    {
+        mem = (tpSegment *)TARP_REALLOC(_buf->heap, sizeof(tpSegment) * _capacity);
+    }
+    else
+    {
+        mem = (tpSegment *)TARP_MALLOC(sizeof(tpSegment) * _capacity);
+        if (mem)
+            memcpy(mem, _buf->local, sizeof(tpSegment) * _buf->count);
+    }
+
+    if (!mem)
+        return 1;
+    _buf->heap = mem;
+    _buf->capacity = _capacity;
+    return 0;
+}
+
+TARP_LOCAL int _tpGLSegmentBufferAppendArray(_tpGLSegmentBuffer * _buf, const tpSegment * _segments, int _count)
+{
+    if (_buf->count + _count > _buf->capacity &&
+            _tpGLSegmentBufferReserve(_buf, TARP_MAX(_buf->count + _count, _buf->capacity * 2)))
+        return 1;
+
+    if (_count)
+        memcpy(_tpGLSegmentBufferData(_buf) + _buf->count, _segments, sizeof(tpSegment) * _count);
+    _buf->count += _count;
+    return 0;
+}
+
+TARP_LOCAL void _tpGLSegmentBufferRemoveRange(_tpGLSegmentBuffer * _buf, int _from, int _to)
+{
+    tpSegment * data = _tpGLSegmentBufferData(_buf);
+    assert(_from >= 0 && _to > _from && _to <= _buf->count);
+    memmove(data + _from, data + _to, sizeof(tpSegment) * (_buf->count - _to));
+    _buf->count -= _to - _from;
+}
+
 typedef struct TARP_LOCAL
 {
-    _tpSegmentArray segments;
+    _tpGLSegmentBuffer segments;
+    /* polyline contours only store their points (see tpPathAddPolyline) and leave segments empty */
+    _tpVec2Array points;
+    tpBool bIsPolyline;
     tpBool bDirty, bIsClosed, bLengthDirty;
     int lastSegmentIndex;
 
@@ -1100,9 +1904,22 @@ typedef struct TARP_LOCAL
     int fillVertexCount;
     int strokeVertexOffset;
     int strokeVertexCount;
+    /* number of segments (or points) that made it into the fill geometry */
+    int flattenedSegmentCount;
+    /* start of the end cap in the stroke geometry of an open contour, -1 otherwise */
+    int strokeCapOffset;
 
     _tpGLRect bounds;
     tpFloat length;
+
+    /*
+    the curve parameters of the flattened vertices, their count per curve, the tolerance and if the contour
+    was closed when they were recorded (see tpPathSetFrozenTopology)
+    */
+    _tpFloatArray frozenParameters;
+    _tpIntArray frozenCurveCounts;
+    tpFloat frozenTolerance;
+    tpBool bFrozenClosed;
 } _tpGLContour;
 
 #define _TARP_ARRAY_T _tpGLContourArray
@@ -1130,10 +1947,38 @@ typedef struct TARP_LOCAL
     int dashCount;
     tpStrokeJoin join;
     tpStrokeCap cap;
+    tpFloat miterLimit;
     tpBool scaleStroke;
+    tpFloat roundQuality;
 } _tpGLStrokeData;
 
+/* the data behind a tpStyleHandle. style.dashArray points to dashes. */
 typedef struct TARP_LOCAL
+{
+    tpStyle style;
+    tpFloat dashes[TARP_MAX_DASH_ARRAY_SIZE];
+    /* changes with every modification, never 0 (see tpDrawPathWithStyle) */
+    int version;
+} _tpGLStyle;
+
+/*
+uniform grid over the bounds of a set of items (edges or triangles) for hit testing. The items
+of each cell are stored compactly in items, cellStarts holds the offset of each cell into it.
+*/
+typedef struct TARP_LOCAL
+{
+    _tpGLRect bounds;
+    int columns, rows;
+    tpFloat invCellWidth, invCellHeight;
+    _tpIntArray cellStarts;
+    _tpIntArray items;
+    /* the geometry version of the path the grid was built for, -1 if it was not built yet */
+    int version;
+} _tpGLHitGrid;
+
+typedef struct _tpGLGradient _tpGLGradient;
+
+struct _tpGLGradient
 {
     int gradientID;
     tpVec2 origin;
@@ -1143,10 +1988,28 @@ typedef struct TARP_LOCAL
     _tpColorStopArray stops;
     tpGradientType type;
 
+    /* changes whenever the gradient is modified */
+    int version;
+
     /* rendering specific data/caches */
     tpBool bDirty;
     GLuint rampTexture;
-} _tpGLGradient;
+
+    /* the ramp texture is out of date and the gradient is linked into __g_dirtyRamps */
+    tpBool bRampDirty;
+    _tpGLGradient * prevDirtyRamp;
+    _tpGLGradient * nextDirtyRamp;
+};
+
+#define _TARP_ARRAY_T _tpGLGradientPtrArray
+#define _TARP_ITEM_T _tpGLGradient *
+#include <Tarp/TarpArray.h>
+
+/*
+the gradients whose color stops changed since their ramp texture was last generated. They are
+uploaded in one batch just before the next gradient is drawn (see _tpGLUploadDirtyRamps).
+*/
+TARP_LOCAL _tpGLGradient * __g_dirtyRamps;
 
 typedef struct TARP_LOCAL
 {
@@ -1154,27 +2017,73 @@ typedef struct TARP_LOCAL
     _tpGLRect * bounds; /* the bounds used by this gradient (i.e. stroke or fill) */
     int vertexOffset;
     int vertexCount;
+    /* a fan over the bounds or the triangles of the cover quads of a sparse path (see _tpGLCacheCoverGeometry) */
+    GLenum primitive;
 
 } _tpGLGradientCacheData;
 
+/* a vertex buffer of a context that a path or glyph cache keeps its geometry in */
+typedef struct TARP_LOCAL
+{
+    GLuint vbo;
+    int vertexCapacity;
+} _tpGLBuffer;
+
+#define _TARP_ARRAY_T _tpGLBufferArray
+#define _TARP_ITEM_T _tpGLBuffer
+#define _TARP_COMPARATOR_T 0
+#include <Tarp/TarpArray.h>
+
+/*
+the buffer at index in the context with the id contextID, or none if contextID is 0. Contexts are
+looked up by their id, so the context doesn't need to be alive or current to release the buffer.
+*/
+typedef struct TARP_LOCAL
+{
+    int contextID;
+    int index;
+} _tpGLBufferRef;
+
 typedef struct TARP_LOCAL
 {
     _tpGLContourArray contours;
     int currentContourIndex;
+
+    /* see tpPathSetTransform, the scale is the bigger one of its axes */
     tpTransform transform;
+    tpFloat transformScale;
+    tpBool bHasTransform;
 
     /* rendering specific data/caches */
     _tpVec2Array geometryCache;
     _tpGLTextureVertexArray textureGeometryCache;
     _tpBoolArray jointCache;
+    /* the segments of a contour mapped by the transform of a non scaling stroke (see _tpGLPathTransformedSegments) */
+    _tpSegmentArray transformedSegments;
+    /*
+    the fill vertex ranges of all contours packed tightly for the stencil passes, rebuilt from the
+    contours whenever fillRangesVersion falls behind geometryVersion (see _tpGLPathUpdateFillRanges)
+    */
+    _tpIntArray fillFirsts;
+    _tpIntArray fillCounts;
+    int fillRangesVersion;
 
     tpBool bPathGeometryDirty;
+    /* segments were only appended to the last contour, see _tpGLPathAppendGeometry */
+    tpBool bPathGeometryAppended;
     tpFloat lastTransformScale;
+    /* see tpPathSetSimplifyTolerance, the bucket is the scale range the geometry was simplified for */
+    tpFloat simplifyTolerance;
+    int simplifyBucket;
+    tpQualityHints quality;
+    tpBool bFrozenTopology;
     _tpGLRect boundsCache;
     _tpGLRect strokeBoundsCache;
 
     /* holds the properties that the stroke geometry was generated with */
     _tpGLStrokeData lastStroke;
+    /* version of the style handle lastStroke was last validated against, 0 for plain styles */
+    int lastStyleVersion;
 
     _tpGLGradientCacheData fillGradientData;
     _tpGLGradientCacheData strokeGradientData;
@@ -1182,6 +2091,39 @@ typedef struct TARP_LOCAL
     int strokeVertexOffset;
     int strokeVertexCount;
     int boundsVertexOffset;
+    /* the triangles of the cover quads of a sparse path that follow the bounds quad, 0 if it has none */
+    int coverVertexCount;
+    /* unused vertices between the fill and stroke geometry that appended fill vertices can go into */
+    int fillVertexGap;
+
+    /* incremented whenever the geometry cache changes */
+    int geometryVersion;
+    /* changes whenever the path is modified through the api (see _tpGLNextVersion) */
+    int version;
+
+    /* the path version the convexity was last determined for (see _tpGLPathIsConvex) */
+    int convexVersion;
+    tpBool bConvex;
+
+    /* acceleration structures for hit testing, built lazily (see tpPathHitTestFill) */
+    _tpIntArray hitEdges;
+    _tpGLHitGrid fillHitGrid;
+    _tpGLHitGrid strokeHitGrid;
+    /*
+    a copy of the path that holds the path space geometry for hit testing while the geometry cache holds
+    the screen space geometry of a non scaling stroke, and the version of the path it was copied at.
+    */
+    tpPath hitTestPath;
+    int hitTestVersion;
+
+    /*
+    the buffer holding the geometry cache in the context the path was last drawn in and the ranges of it
+    that are out of date. Drawing the path in another context uploads all of it to a buffer of that context.
+    */
+    _tpGLBufferRef buffer;
+    tpBool bUploadAll;
+    int uploadRangeCount;
+    int uploadRanges[TARP_GL_MAX_UPLOAD_RANGES * 2];
 
     _tpGLContext * lastDrawContext;
     int lastTransformID;
@@ -1192,6 +2134,224 @@ typedef struct TARP_LOCAL
     tpBool bStrokePaintTransformDirty;
 } _tpGLPath;
 
+typedef struct TARP_LOCAL
+{
+    tpPath path;
+    _tpGLRect bounds;
+    /* the range of cells the entry is stored in, empty if it is oversized or has empty bounds */
+    int c0, r0, c1, r1;
+    tpBool bOversized;
+    int queryStamp;
+    /* next entry in the free list if this entry is not in use */
+    int nextFree;
+} _tpGLSpatialEntry;
+
+#define _TARP_ARRAY_T _tpGLSpatialEntryArray
+#define _TARP_ITEM_T _tpGLSpatialEntry
+#define _TARP_COMPARATOR_T 0
+#include <Tarp/TarpArray.h>
+
+typedef struct TARP_LOCAL
+{
+    int x, y;
+    tpBool bUsed;
+    _tpIntArray entries;
+} _tpGLSpatialCell;
+
+typedef struct TARP_LOCAL
+{
+    _tpGLPath * path;
+    int entry;
+} _tpGLSpatialSlot;
+
+typedef struct TARP_LOCAL
+{
+    tpFloat invCellSize;
+    _tpGLSpatialEntryArray entries;
+    int freeEntry;
+    int queryStamp;
+
+    /* open addressing hash tables, mapping cells to their entries and paths to their entry */
+    _tpGLSpatialCell * cells;
+    int cellCount, cellCapacity;
+    _tpGLSpatialSlot * slots;
+    int slotCount, slotCapacity;
+
+    /* entries that would span too many cells are tested for every query */
+    _tpIntArray oversized;
+} _tpGLSpatialIndex;
+
+typedef struct TARP_LOCAL
+{
+    int id;
+    /* the outline in font units, converted from the commands once */
+    tpPath path;
+    /* the bounds of the outline's control points in font units */
+    _tpGLRect bounds;
+    /*
+    the range of the triangles of the flattened outline in the vertices of the cache for each size bucket,
+    the offset is -1 if the glyph was not flattened for a bucket yet.
+    */
+    int vertexOffsets[TARP_GL_GLYPH_SIZE_BUCKETS];
+    int vertexCounts[TARP_GL_GLYPH_SIZE_BUCKETS];
+} _tpGLGlyph;
+
+#define _TARP_ARRAY_T _tpGLGlyphArray
+#define _TARP_ITEM_T _tpGLGlyph
+#define _TARP_COMPARATOR_T 0
+#include <Tarp/TarpArray.h>
+
+#define _TARP_ARRAY_T _tpGlyphInstanceArray
+#define _TARP_ITEM_T tpGlyphInstance
+#define _TARP_COMPARATOR_T 0
+#include <Tarp/TarpArray.h>
+
+typedef struct TARP_LOCAL
+{
+    tpFloat unitsPerEm;
+    _tpGLGlyphArray glyphs;
+    /* open addressing hash table mapping glyph ids to their index in glyphs plus one, 0 marks a free slot */
+    int * slots;
+    int slotCapacity;
+
+    /*
+    the triangles of all flattened glyphs in font units and the buffer they are uploaded to. Vertices are
+    only ever appended, so only the ones that were added since the last draw need to be uploaded.
+    */
+    _tpVec2Array vertices;
+    _tpGLBufferRef buffer;
+    int uploadedVertexCount;
+
+    /* changes whenever an outline is added or replaced */
+    int version;
+} _tpGLGlyphCache;
+
+typedef enum TARP_LOCAL
+{
+    _kTpGLCommandDrawPath,
+    _kTpGLCommandBeginClipping,
+    _kTpGLCommandEndClipping,
+    _kTpGLCommandResetClipping,
+    _kTpGLCommandDrawLayer,
+    _kTpGLCommandDrawGlyphRun
+} _tpGLCommandType;
+
+typedef struct _tpGLLayer _tpGLLayer;
+
+/* a draw or clipping call recorded in retained mode or into a layer (see tpSetRetainedMode and tpBeginLayer) */
+typedef struct TARP_LOCAL
+{
+    _tpGLCommandType type;
+    /* only used for comparisons with the previous frame, the path might not be alive anymore */
+    _tpGLPath * path;
+    _tpGLLayer * layer;
+    int version;
+    /* glyph runs are drawn with the color of the fill and their glyphs are stored at glyphStart in the list */
+    _tpGLGlyphCache * glyphCache;
+    int glyphStart;
+    int glyphCount;
+    tpFloat glyphSize;
+    /* the dashArray of the style is stored at dashStart in the dashes of the list */
+    tpStyle style;
+    int dashStart;
+    /* version of the style handle the command was drawn with or 0 (see tpDrawPathWithStyle) */
+    int styleVersion;
+    /* versions of the gradients or pattern tiles of the fill and stroke (see _tpGLPaintVersion) */
+    int fillPaintVersion;
+    int strokePaintVersion;
+    tpTransform transform;
+    tpMat4 projection;
+    /* identifies the clipping paths the command is drawn with */
+    int clipSignature;
+    /* bounds in window pixels (or layer space for layers), empty if nothing is drawn */
+    _tpGLRect bounds;
+    /* index of the matching command in the other frame or -1 */
+    int match;
+    /* hidden behind later opaque content, see tpSetOcclusionCulling */
+    tpBool bCulled;
+} _tpGLCommand;
+
+#define _TARP_ARRAY_T _tpGLCommandArray
+#define _TARP_ITEM_T _tpGLCommand
+#define _TARP_COMPARATOR_T 0
+#include <Tarp/TarpArray.h>
+
+typedef struct TARP_LOCAL
+{
+    /* the path or layer of the command */
+    const void * object;
+    _tpGLCommandType type;
+    int index;
+} _tpGLCommandKey;
+
+#define _TARP_ARRAY_T _tpGLCommandKeyArray
+#define _TARP_ITEM_T _tpGLCommandKey
+#define _TARP_COMPARATOR_T 0
+#include <Tarp/TarpArray.h>
+
+/* determines the order draw commands are submitted in with depth ordering (see tpSetDepthOrdering) */
+typedef struct TARP_LOCAL
+{
+    int index;
+    /* the depth slot of the command, it defines the painter's order */
+    int slot;
+    tpBool bOpaque;
+    /* opaque commands that share the same gradient are drawn after each other */
+    const void * paint;
+} _tpGLDepthKey;
+
+#define _TARP_ARRAY_T _tpGLDepthKeyArray
+#define _TARP_ITEM_T _tpGLDepthKey
+#define _TARP_COMPARATOR_T 0
+#include <Tarp/TarpArray.h>
+
+/* a convex polygon in window pixels that is covered by an opaque fill (see tpSetOcclusionCulling) */
+typedef struct TARP_LOCAL
+{
+    _tpGLRect bounds;
+    int pointOffset;
+    int pointCount;
+    /* the sign of the polygon's area */
+    tpFloat orientation;
+} _tpGLOccluder;
+
+typedef struct TARP_LOCAL
+{
+    _tpGLCommandArray commands;
+    /* the dash arrays of the recorded styles */
+    _tpFloatArray dashes;
+    /* the glyphs of the recorded glyph runs */
+    _tpGlyphInstanceArray glyphs;
+    int clippingDepth;
+    int clipSignatures[TARP_GL_MAX_CLIPPING_STACK_DEPTH + 1];
+    /* if true, the command bounds are in window pixels, otherwise in the space the list is recorded in */
+    tpBool bWindowBounds;
+} _tpGLCommandList;
+
+struct _tpGLLayer
+{
+    _tpGLCommandList list;
+    /* the bounds of the content in layer space */
+    _tpGLRect bounds;
+    /* changes whenever the content changes */
+    int version;
+    /* the texture needs to be rendered again */
+    tpBool bDirty;
+
+    /* the texture and the multisampled framebuffer it is resolved from */
+    GLuint texture;
+    GLuint fbo;
+    GLuint msaaFbo;
+    GLuint msaaColor;
+    GLuint msaaStencil;
+    int width, height;
+    /* the power of two scale the texture was rendered at and the layer space rect it covers */
+    int rasterBucket;
+    _tpGLRect rasterBounds;
+
+    /* the tile of a pattern, its bounds are the tile and the texture covers exactly those so it repeats */
+    tpBool bTile;
+};
 typedef struct TARP_LOCAL
 {
     GLuint vao;
@@ -1204,6 +2364,8 @@ typedef struct TARP_LOCAL
     GLenum activeTexture;
     GLboolean depthTest;
     GLboolean depthMask;
+    GLenum depthFunc;
+    GLfloat clearDepth;
     GLboolean multisample;
     GLboolean stencilTest;
     GLuint stencilMask;
@@ -1224,18 +2386,38 @@ typedef struct TARP_LOCAL
     GLuint vao;
     GLuint vbo;
     GLuint program;
+    GLboolean scissorTest;
+    GLint scissorBox[4];
+    GLfloat clearColor[4];
 } _tpGLStateBackup;
 
 struct _tpGLContext
 {
+    /* unique for the lifetime of the process, never 0 (see _tpGLBufferRef) */
+    int id;
+    _tpGLContext * nextContext;
+    /* the buffers of paths and glyph caches drawn in this context and the indices of the ones that are free */
+    _tpGLBufferArray buffers;
+    _tpIntArray freeBuffers;
+
     GLuint program;
     GLuint textureProgram;
+    GLuint layerProgram;
+    GLuint glyphProgram;
+    GLuint patternProgram;
     GLuint tpLoc;
     GLuint tpTextureLoc;
+    GLuint tpLayerLoc;
+    GLuint tpGlyphLoc;
+    GLuint tpPatternLoc;
     GLuint meshColorLoc;
+    GLuint glyphScaleLoc;
+    GLuint glyphOffsetsLoc;
+    GLuint patternTransformLoc;
 
     _tpGLVAO vao;
     _tpGLVAO textureVao;
+    _tpGLVAO layerVao;
 
     _tpGLPath * clippingStack[TARP_GL_MAX_CLIPPING_STACK_DEPTH];
     int clippingStackDepth;
@@ -1260,21 +2442,207 @@ struct _tpGLContext
 
     _tpColorStopArray tmpColorStops;
 
+    /* the glyphs of the current run sorted by glyph */
+    _tpGlyphInstanceArray tmpGlyphs;
+
+    /* the pixel buffer dirty ramps are uploaded through and the gradients of the current batch */
+    GLuint rampPbo;
+    _tpGLGradientPtrArray tmpRamps;
+    void (*parallelFor)(void * _userData, int _count, void (*_job)(void * _jobData, int _index), void * _jobData);
+    void * parallelForUserData;
+
     _tpGLStateBackup stateBackup;
+
+    /* the program binary cache (see tpContextOptions), a header followed by one entry per program */
+    tpBool bProgramCache;
+    tpBool bProgramCacheDirty;
+    unsigned int driverHash;
+    char * programCacheDirectory;
+    _tpCharArray programCache;
+
+    /*
+    the debug message callback (see tpContextOptions.bDebugOutput) and the one it replaced. The pass and
+    object tarp is currently drawing are included in the messages, as the callback is synchronous.
+    */
+    tpBool bDebugOutput;
+    GLDEBUGPROC previousDebugCallback;
+    const void * previousDebugUserParam;
+    const char * debugPass;
+    const void * debugObject;
+
+    /* the list draw calls are recorded to instead of drawing them right away, NULL if there is none */
+    _tpGLCommandList * recordList;
+    _tpGLLayer * currentLayer;
+    /* the list the current layer recorded last time and the list that was recorded to before it began */
+    _tpGLCommandList previousLayerList;
+    _tpGLCommandList * layerParentList;
+
+    /* retained mode, the commands of the current and the previous frame (see tpSetRetainedMode) */
+    tpBool bRetained;
+    tpBool bRetainedFullRedraw;
+    tpColor retainedClearColor;
+    _tpGLCommandList frame;
+    _tpGLCommandList lastFrame;
+    _tpGLCommandKeyArray tmpKeys;
+    _tpGLCommandKeyArray tmpLastKeys;
+
+    /* depth ordering (see tpSetDepthOrdering), depth is the normalized depth the current draw is done at */
+    tpBool bDepthOrdering;
+    tpBool bDepthTest;
+    tpBool bDepthWrite;
+    tpFloat depth;
+    _tpGLDepthKeyArray tmpDepthKeys;
+
+    /* occlusion culling, the occluders of the current run of draws (see tpSetOcclusionCulling) */
+    tpBool bOcclusionCulling;
+    _tpGLOccluder occluders[TARP_GL_MAX_OCCLUDERS];
+    int occluderCount;
+    _tpVec2Array tmpOccluderPoints;
+
+    /* the screen size below which paths are skipped or approximated (see tpSetMinimumPathSize) */
+    tpFloat minimumPathSize;
+    tpSmallPathMode smallPathMode;
+
+    GLint viewport[4];
+    GLint lastViewport[4];
+    /* the regions redrawn by the last retained frame, one more than the max to merge new ones */
+    _tpGLRect damage[TARP_GL_MAX_DAMAGE_RECTS + 1];
+    int damageCount;
 };
 
+/* all live contexts, so buffers can be released by context id (see _tpGLReleaseBuffer) */
+TARP_LOCAL _tpGLContext * __g_contexts;
+
+/*
+the context between tpPrepareDrawing and tpFinishDrawing, or while it is created. Only its debug output
+setting decides if glGetError is called, other contexts might not have a debug callback installed.
+*/
+TARP_LOCAL _tpGLContext * __g_activeContext;
+
+TARP_LOCAL tpBool _tpGLIsDebugOutputActive()
+{
+    return (tpBool)(__g_activeContext && __g_activeContext->bDebugOutput);
+}
+
+/*
+gives a buffer back to the context it belongs to for reuse. This doesn't call into OpenGL, so paths and
+glyph caches can be destroyed without a current context. If the context is gone, so is the buffer.
+*/
+TARP_LOCAL void _tpGLReleaseBuffer(_tpGLBufferRef * _ref)
+{
+    _tpGLContext * ctx;
+
+    if (!_ref->contextID)
+        return;
+
+    for (ctx = __g_contexts; ctx; ctx = ctx->nextContext)
+    {
+        if (ctx->id == _ref->contextID)
+        {
+            _tpIntArrayAppend(&ctx->freeBuffers, _ref->index);
+            break;
+        }
+    }
+    _ref->contextID = 0;
+}
+
+/*
+binds the buffer _ref refers to in _ctx to GL_ARRAY_BUFFER. If it has none in _ctx, the one it has in another
+context is released and a free or new buffer of _ctx is claimed. _bOutClaimed is set in that case, as the
+contents of the buffer are undefined.
+*/
+TARP_LOCAL tpBool _tpGLBindBuffer(_tpGLContext * _ctx, _tpGLBufferRef * _ref,
+                                  const char * _label, const void * _object, tpBool * _bOutClaimed)
+{
+    _tpGLBuffer buffer;
+
+    *_bOutClaimed = _ref->contextID != _ctx->id ? tpTrue : tpFalse;
+    if (*_bOutClaimed)
+    {
+        _tpGLReleaseBuffer(_ref);
+        if (_ctx->freeBuffers.count)
+        {
+            _ref->index = _tpIntArrayLast(&_ctx->freeBuffers);
+            _ctx->freeBuffers.count--;
+        }
+        else
+        {
+            buffer.vertexCapacity = 0;
+            _TARP_ASSERT_NO_GL_ERROR(glGenBuffers(1, &buffer.vbo));
+            if (_tpGLBufferArrayAppendPtr(&_ctx->buffers, &buffer))
+            {
+                glDeleteBuffers(1, &buffer.vbo);
+                _tpGLSetErrorMessage("Could not allocate memory for a vertex buffer.");
+                return tpTrue;
+            }
+            _ref->index = _ctx->buffers.count - 1;
+        }
+        _ref->contextID = _ctx->id;
+    }
+
+    _TARP_ASSERT_NO_GL_ERROR(glBindBuffer(GL_ARRAY_BUFFER, _ctx->buffers.array[_ref->index].vbo));
+    if (*_bOutClaimed)
+        _tpGLObjectLabel(GL_BUFFER, _ctx->buffers.array[_ref->index].vbo, _label, _object);
+    return tpFalse;
+}
+
 typedef struct TARP_LOCAL
 {
     char message[TARP_GL_ERROR_MESSAGE_SIZE];
     int length;
 } _ErrorMessage;
 
+typedef struct TARP_LOCAL
+{
+    unsigned int magic;
+    /* programs are only valid for the driver they were created with */
+    unsigned int driverHash;
+} _tpGLProgramCacheHeader;
+
+typedef struct TARP_LOCAL
+{
+    /* the hash of the shader sources */
+    unsigned int key;
+    unsigned int format;
+    /* followed by this many bytes of binary, padded to a multiple of four */
+    int length;
+} _tpGLProgramCacheEntry;
+
+TARP_LOCAL void _tpGLCommandListInit(_tpGLCommandList * _list, tpBool _bWindowBounds)
+{
+    memset(_list, 0, sizeof(_tpGLCommandList));
+    _list->bWindowBounds = _bWindowBounds;
+}
+
+/* draw commands, as opposed to clipping commands, can be skipped, reordered and culled */
+TARP_LOCAL tpBool _tpGLCommandIsDraw(const _tpGLCommand * _cmd)
+{
+    return (tpBool)(_cmd->type == _kTpGLCommandDrawPath || _cmd->type == _kTpGLCommandDrawLayer ||
+                    _cmd->type == _kTpGLCommandDrawGlyphRun);
+}
+
+TARP_LOCAL void _tpGLCommandListClear(_tpGLCommandList * _list)
+{
+    _tpGLCommandArrayClear(&_list->commands);
+    _tpFloatArrayClear(&_list->dashes);
+    _tpGlyphInstanceArrayClear(&_list->glyphs);
+    _list->clippingDepth = 0;
+}
+
+TARP_LOCAL void _tpGLCommandListDeallocate(_tpGLCommandList * _list)
+{
+    _tpGLCommandArrayDeallocate(&_list->commands);
+    _tpFloatArrayDeallocate(&_list->dashes);
+    _tpGlyphInstanceArrayDeallocate(&_list->glyphs);
+}
+
 TARP_LOCAL void _tpGLGradientCacheDataInit(_tpGLGradientCacheData * _gd, _tpGLRect * _bounds)
 {
     _gd->lastGradientID = -1;
     _gd->bounds = _bounds;
     _gd->vertexOffset = 0;
     _gd->vertexCount = 0;
+    _gd->primitive = GL_TRIANGLE_FAN;
 }
 
 /* @TODO: Get rid of all the _ErrorMessage things and call _tpGLSetErrorMessage instead? */
@@ -1310,11 +2678,235 @@ TARP_LOCAL tpBool _compileShader(const char * _shaderCode, GLenum _shaderType, G
     return tpFalse;
 }
 
-TARP_LOCAL tpBool _createProgram(const char * _vertexShader, const char * _fragmentShader, int _bTexProgram, GLuint * _outHandle, _ErrorMessage * _outError)
+TARP_LOCAL unsigned int _tpGLHashString(unsigned int _hash, const char * _str)
 {
-    GLuint vertexShader, fragmentShader, program;
-    GLint state, infologLength;
-    tpBool err;
+    while (_str && *_str)
+        _hash = (_hash ^ (unsigned char)*_str++) * 16777619u;
+    return _hash;
+}
+
+/* the file a program cache directory stores the programs of the current driver in */
+TARP_LOCAL char * _tpGLProgramCacheFilePath(_tpGLContext * _ctx)
+{
+    size_t len = strlen(_ctx->programCacheDirectory);
+    char * ret = (char *)TARP_MALLOC(len + 32);
+    if (ret)
+        sprintf(ret, "%s/tarp_programs_%08x.bin", _ctx->programCacheDirectory, _ctx->driverHash);
+    return ret;
+}
+
+TARP_LOCAL void _tpGLProgramCacheInit(_tpGLContext * _ctx, const tpContextOptions * _options)
+{
+    FILE * f;
+    long size;
+    char * path;
+    GLint formatCount = 0;
+    _tpGLProgramCacheHeader header;
+
+    _ctx->bProgramCache = tpFalse;
+    _ctx->bProgramCacheDirty = tpFalse;
+    _ctx->programCacheDirectory = NULL;
+    memset(&_ctx->programCache, 0, sizeof(_ctx->programCache));
+
+    if (!_options || (!_options->programCacheDirectory && !_options->programCacheData))
+        return;
+
+    /* program binaries need OpenGL 4.1 or ARB_get_program_binary */
+    if (!glGetProgramBinary || !glProgramBinary)
+        return;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+    if (formatCount <= 0)
+        return;
+
+    _ctx->bProgramCache = tpTrue;
+    _ctx->driverHash = _tpGLHashString(2166136261u, (const char *)glGetString(GL_VENDOR));
+    _ctx->driverHash = _tpGLHashString(_ctx->driverHash, (const char *)glGetString(GL_RENDERER));
+    _ctx->driverHash = _tpGLHashString(_ctx->driverHash, (const char *)glGetString(GL_VERSION));
+
+    if (_options->programCacheDirectory)
+    {
+        _ctx->programCacheDirectory = (char *)TARP_MALLOC(strlen(_options->programCacheDirectory) + 1);
+        if (_ctx->programCacheDirectory)
+            strcpy(_ctx->programCacheDirectory, _options->programCacheDirectory);
+    }
+
+    if (_ctx->programCacheDirectory)
+    {
+        path = _tpGLProgramCacheFilePath(_ctx);
+        f = path ? fopen(path, "rb") : NULL;
+        if (f)
+        {
+            fseek(f, 0, SEEK_END);
+            size = ftell(f);
+            fseek(f, 0, SEEK_SET);
+            if (size > 0 && !_tpCharArrayReserve(&_ctx->programCache, (int)size))
+                _ctx->programCache.count = (int)fread(_ctx->programCache.array, 1, size, f);
+            fclose(f);
+        }
+        if (path)
+            TARP_FREE(path);
+    }
+    else if (_options->programCacheSize > 0)
+    {
+        _tpCharArrayAppendArray(&_ctx->programCache, (char *)_options->programCacheData, _options->programCacheSize);
+    }
+
+    /* start over if the cache is invalid or was created with a different driver */
+    if (_ctx->programCache.count >= (int)sizeof(header))
+        memcpy(&header, _ctx->programCache.array, sizeof(header));
+    if (_ctx->programCache.count < (int)sizeof(header) || header.magic != 0x54505243 || header.driverHash != _ctx->driverHash)
+    {
+        header.magic = 0x54505243;
+        header.driverHash = _ctx->driverHash;
+        _tpCharArrayClear(&_ctx->programCache);
+        _tpCharArrayAppendArray(&_ctx->programCache, (char *)&header, sizeof(header));
+    }
+}
+
+/* tries to create a program from the cache, returns tpTrue if it is not cached or the driver rejected it */
+/*
+checks if the driver supports a binary format. glProgramBinary raises an error for formats it doesn't know,
+which we would rather not leave behind, while it only fails to link binaries it can't use otherwise.
+*/
+TARP_LOCAL tpBool _tpGLIsProgramBinaryFormatSupported(GLenum _format)
+{
+    GLint i, count = 0;
+    GLint * formats;
+    tpBool ret = tpFalse;
+
+    _TARP_ASSERT_NO_GL_ERROR(glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &count));
+    if (count <= 0)
+        return tpFalse;
+    formats = (GLint *)TARP_MALLOC(sizeof(GLint) * count);
+    if (!formats)
+        return tpFalse;
+    _TARP_ASSERT_NO_GL_ERROR(glGetIntegerv(GL_PROGRAM_BINARY_FORMATS, formats));
+    for (i = 0; i < count && !ret; ++i)
+        ret = (tpBool)((GLenum)formats[i] == _format);
+    TARP_FREE(formats);
+    return ret;
+}
+
+TARP_LOCAL tpBool _tpGLProgramCacheLoad(_tpGLContext * _ctx, unsigned int _key, GLuint * _outHandle)
+{
+    int offset, length;
+    GLint state;
+    GLuint program;
+    _tpGLProgramCacheEntry entry;
+
+    for (offset = sizeof(_tpGLProgramCacheHeader); offset + (int)sizeof(entry) <= _ctx->programCache.count;
+            offset += sizeof(entry) + ((entry.length + 3) & ~3))
+    {
+        memcpy(&entry, _ctx->programCache.array + offset, sizeof(entry));
+        if (entry.length < 0 || offset + (int)sizeof(entry) + entry.length > _ctx->programCache.count)
+            break;
+        if (entry.key != _key)
+            continue;
+
+        if (_tpGLIsProgramBinaryFormatSupported(entry.format))
+        {
+            program = glCreateProgram();
+            _TARP_ASSERT_NO_GL_ERROR(glProgramBinary(program, entry.format, _ctx->programCache.array + offset + sizeof(entry), entry.length));
+            _TARP_ASSERT_NO_GL_ERROR(glGetProgramiv(program, GL_LINK_STATUS, &state));
+            if (state == GL_TRUE)
+            {
+                *_outHandle = program;
+                return tpFalse;
+            }
+            glDeleteProgram(program);
+        }
+
+        /* remove the stale entry, the program gets compiled and stored again */
+        length = sizeof(entry) + ((entry.length + 3) & ~3);
+        memmove(_ctx->programCache.array + offset, _ctx->programCache.array + offset + length,
+                _ctx->programCache.count - offset - length);
+        _ctx->programCache.count -= length;
+        _ctx->bProgramCacheDirty = tpTrue;
+        break;
+    }
+    return tpTrue;
+}
+
+TARP_LOCAL void _tpGLProgramCacheStore(_tpGLContext * _ctx, unsigned int _key, GLuint _program)
+{
+    GLint length = 0;
+    GLenum format;
+    int offset, padded;
+    _tpGLProgramCacheEntry entry;
+
+    _TARP_ASSERT_NO_GL_ERROR(glGetProgramiv(_program, GL_PROGRAM_BINARY_LENGTH, &length));
+    if (length <= 0)
+        return;
+
+    /* entries are padded to keep them aligned */
+    padded = (length + 3) & ~3;
+    offset = _ctx->programCache.count;
+    if (_ctx->programCache.capacity < offset + (int)sizeof(entry) + padded &&
+            _tpCharArrayReserve(&_ctx->programCache, (offset + (int)sizeof(entry) + padded) * 2))
+        return;
+
+    /* the cache is written to disk as is, so don't leave the padding uninitialized */
+    memset(_ctx->programCache.array + offset, 0, sizeof(entry) + padded);
+    _TARP_ASSERT_NO_GL_ERROR(glGetProgramBinary(_program, length, &length, &format,
+                             _ctx->programCache.array + offset + sizeof(entry)));
+    memset(&entry, 0, sizeof(entry));
+    entry.key = _key;
+    entry.format = format;
+    entry.length = length;
+    memcpy(_ctx->programCache.array + offset, &entry, sizeof(entry));
+    _ctx->programCache.count = offset + sizeof(entry) + ((length + 3) & ~3);
+    _ctx->bProgramCacheDirty = tpTrue;
+}
+
+/*
+writes the program cache to the cache directory if programs were added to it. It is written to a temporary
+file that is renamed over the cache, so that other processes never read a partially written cache.
+*/
+TARP_LOCAL void _tpGLProgramCacheWrite(_tpGLContext * _ctx)
+{
+    FILE * f;
+    char * path, * tmpPath;
+    tpBool bWritten;
+
+    if (!_ctx->bProgramCacheDirty || !_ctx->programCacheDirectory)
+        return;
+
+    _ctx->bProgramCacheDirty = tpFalse;
+    path = _tpGLProgramCacheFilePath(_ctx);
+    if (!path)
+        return;
+
+    /* the time and context make the name unique among processes and contexts writing at the same time */
+    tmpPath = (char *)TARP_MALLOC(strlen(path) + 48);
+    if (tmpPath)
+    {
+        sprintf(tmpPath, "%s.%lx.%lx.tmp", path, (unsigned long)time(NULL), (unsigned long)(size_t)_ctx);
+        f = fopen(tmpPath, "wb");
+        if (f)
+        {
+            bWritten = (tpBool)(fwrite(_ctx->programCache.array, 1, _ctx->programCache.count, f) == (size_t)_ctx->programCache.count);
+            bWritten = (tpBool)(!fclose(f) && bWritten);
+
+            /* rename doesn't replace existing files on windows */
+            if (bWritten && rename(tmpPath, path) && (remove(path) || rename(tmpPath, path)))
+                bWritten = tpFalse;
+            if (!bWritten)
+                remove(tmpPath);
+        }
+        TARP_FREE(tmpPath);
+    }
+    TARP_FREE(path);
+}
+
+TARP_LOCAL tpBool _createProgram(_tpGLContext * _ctx, const char * _vertexShader, const char * _fragmentShader, int _bTexProgram, GLuint * _outHandle, _ErrorMessage * _outError)
+{
+    GLuint vertexShader, fragmentShader, program;
+    GLint state, infologLength;
+    tpBool err;
+    unsigned int key = _tpGLHashString(_tpGLHashString(2166136261u, _vertexShader), _fragmentShader);
+
+    if (_ctx->bProgramCache && !_tpGLProgramCacheLoad(_ctx, key, _outHandle))
+        return tpFalse;
 
     err = _compileShader(_vertexShader, GL_VERTEX_SHADER, &vertexShader, _outError);
     if (err) return err;
@@ -1330,6 +2922,8 @@ TARP_LOCAL tpBool _createProgram(const char * _vertexShader, const char * _fragm
     if (_bTexProgram)
         _TARP_ASSERT_NO_GL_ERROR(glBindAttribLocation(program, 1, "tc"));
 
+    if (_ctx->bProgramCache)
+        _TARP_ASSERT_NO_GL_ERROR(glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE));
     _TARP_ASSERT_NO_GL_ERROR(glLinkProgram(program));
 
     /* check if we had success */
@@ -1358,37 +2952,233 @@ TARP_LOCAL tpBool _createProgram(const char * _vertexShader, const char * _fragm
     else
     {
         *_outHandle = program;
+        if (_ctx->bProgramCache)
+            _tpGLProgramCacheStore(_ctx, key, program);
     }
 
     return tpFalse;
 }
 
 TARP_API tpContext tpContextCreate()
+{
+    return tpContextCreateWithOptions(NULL);
+}
+
+TARP_API tpContextOptions tpContextOptionsMake()
+{
+    tpContextOptions ret;
+    ret.programCacheDirectory = NULL;
+    ret.programCacheData = NULL;
+    ret.programCacheSize = 0;
+    ret.vertexCapacityHint = 0;
+    ret.bDebugOutput = tpFalse;
+    ret.parallelFor = NULL;
+    ret.parallelForUserData = NULL;
+    return ret;
+}
+
+/*
+creates a program and a vertex array with a position and a texture coordinate attribute of _tcSize
+components. Used for the gradient and layer programs, which are created on first use.
+*/
+TARP_LOCAL tpBool _tpGLCreateTexturedProgram(_tpGLContext * _ctx, const char * _vertexShader, const char * _fragmentShader,
+        int _tcSize, const char * _label, GLuint * _outProgram, GLuint * _outTpLoc, _tpGLVAO * _outVao)
+{
+    _ErrorMessage msg;
+
+    if (_createProgram(_ctx, _vertexShader, _fragmentShader, 1, _outProgram, &msg))
+    {
+        _tpGLSetErrorMessage(msg.message);
+        return tpTrue;
+    }
+    *_outTpLoc = glGetUniformLocation(*_outProgram, "transformProjection");
+    _tpGLProgramCacheWrite(_ctx);
+    _tpGLObjectLabel(GL_PROGRAM, *_outProgram, _label, NULL);
+
+    _TARP_ASSERT_NO_GL_ERROR(glGenVertexArrays(1, &_outVao->vao));
+    _TARP_ASSERT_NO_GL_ERROR(glBindVertexArray(_outVao->vao));
+    _TARP_ASSERT_NO_GL_ERROR(glGenBuffers(1, &_outVao->vbo));
+    _outVao->vboSize = 0;
+    _TARP_ASSERT_NO_GL_ERROR(glBindBuffer(GL_ARRAY_BUFFER, _outVao->vbo));
+    _TARP_ASSERT_NO_GL_ERROR(glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(tpFloat), ((char *)0)));
+    _TARP_ASSERT_NO_GL_ERROR(glEnableVertexAttribArray(0));
+    _TARP_ASSERT_NO_GL_ERROR(glVertexAttribPointer(1, _tcSize, GL_FLOAT, GL_FALSE, 4 * sizeof(tpFloat), ((char *)(2 * sizeof(float)))));
+    _TARP_ASSERT_NO_GL_ERROR(glEnableVertexAttribArray(1));
+
+    /* we might be in the middle of drawing */
+    _TARP_ASSERT_NO_GL_ERROR(glBindVertexArray(_ctx->vao.vao));
+    return tpFalse;
+}
+
+TARP_LOCAL tpBool _tpGLEnsureTextureProgram(_tpGLContext * _ctx)
+{
+    if (_ctx->textureProgram)
+        return tpFalse;
+    return _tpGLCreateTexturedProgram(_ctx, _vertexShaderCodeTexture, _fragmentShaderCodeTexture, 1, "tarp gradient program",
+                                      &_ctx->textureProgram, &_ctx->tpTextureLoc, &_ctx->textureVao);
+}
+
+TARP_LOCAL tpBool _tpGLEnsureLayerProgram(_tpGLContext * _ctx)
+{
+    if (_ctx->layerProgram)
+        return tpFalse;
+    return _tpGLCreateTexturedProgram(_ctx, _vertexShaderCodeLayer, _fragmentShaderCodeLayer, 2, "tarp layer program",
+                                      &_ctx->layerProgram, &_ctx->tpLayerLoc, &_ctx->layerVao);
+}
+
+/* the glyph program sources its vertices from the glyph caches through the regular vertex array */
+TARP_LOCAL tpBool _tpGLEnsureGlyphProgram(_tpGLContext * _ctx)
+{
+    _ErrorMessage msg;
+
+    if (_ctx->glyphProgram)
+        return tpFalse;
+
+    if (_createProgram(_ctx, _vertexShaderCodeGlyph, _fragmentShaderCode, 0, &_ctx->glyphProgram, &msg))
+    {
+        _tpGLSetErrorMessage(msg.message);
+        return tpTrue;
+    }
+    _ctx->tpGlyphLoc = glGetUniformLocation(_ctx->glyphProgram, "transformProjection");
+    _ctx->glyphScaleLoc = glGetUniformLocation(_ctx->glyphProgram, "glyphScale");
+    _ctx->glyphOffsetsLoc = glGetUniformLocation(_ctx->glyphProgram, "glyphOffsets");
+    _tpGLProgramCacheWrite(_ctx);
+    _tpGLObjectLabel(GL_PROGRAM, _ctx->glyphProgram, "tarp glyph program", NULL);
+    return tpFalse;
+}
+
+/* the pattern program sources its vertices from the path's bounds through the regular vertex array */
+TARP_LOCAL tpBool _tpGLEnsurePatternProgram(_tpGLContext * _ctx)
+{
+    _ErrorMessage msg;
+
+    if (_ctx->patternProgram)
+        return tpFalse;
+
+    if (_createProgram(_ctx, _vertexShaderCodePattern, _fragmentShaderCodeLayer, 0, &_ctx->patternProgram, &msg))
+    {
+        _tpGLSetErrorMessage(msg.message);
+        return tpTrue;
+    }
+    _ctx->tpPatternLoc = glGetUniformLocation(_ctx->patternProgram, "transformProjection");
+    _ctx->patternTransformLoc = glGetUniformLocation(_ctx->patternProgram, "patternTransform");
+    _tpGLProgramCacheWrite(_ctx);
+    _tpGLObjectLabel(GL_PROGRAM, _ctx->patternProgram, "tarp pattern program", NULL);
+    return tpFalse;
+}
+
+TARP_LOCAL void APIENTRY _tpGLDebugCallback(GLenum _source, GLenum _type, GLuint _id, GLenum _severity,
+        GLsizei _length, const GLchar * _message, const void * _userParam)
+{
+    _tpGLContext * ctx = (_tpGLContext *)_userParam;
+
+    if (_type == GL_DEBUG_TYPE_ERROR)
+    {
+        if (ctx->debugPass)
+            fprintf(stderr, "Tarp OpenGL error while drawing the %s of %p: %s\n", ctx->debugPass, ctx->debugObject, _message);
+        else
+            fprintf(stderr, "Tarp OpenGL error: %s\n", _message);
+    }
+
+    if (ctx->previousDebugCallback)
+        ctx->previousDebugCallback(_source, _type, _id, _severity, _length, _message, ctx->previousDebugUserParam);
+}
+
+TARP_LOCAL void _tpGLDebugOutputInit(_tpGLContext * _ctx, const tpContextOptions * _options)
+{
+    GLint flags = 0;
+
+    _ctx->bDebugOutput = tpFalse;
+    _ctx->previousDebugCallback = NULL;
+    _ctx->previousDebugUserParam = NULL;
+    _ctx->debugPass = NULL;
+    _ctx->debugObject = NULL;
+
+    if (!_options || !_options->bDebugOutput || !glDebugMessageCallback || !glObjectLabel)
+        return;
+
+    /* non debug contexts are not required to report anything */
+    glGetIntegerv(GL_CONTEXT_FLAGS, &flags);
+    if (!(flags & GL_CONTEXT_FLAG_DEBUG_BIT))
+        return;
+
+    glGetPointerv(GL_DEBUG_CALLBACK_FUNCTION, (void **)&_ctx->previousDebugCallback);
+    glGetPointerv(GL_DEBUG_CALLBACK_USER_PARAM, (void **)&_ctx->previousDebugUserParam);
+
+    /* synchronous, so that the message is reported while we still know what caused it */
+    glEnable(GL_DEBUG_OUTPUT);
+    glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+    glDebugMessageCallback(_tpGLDebugCallback, _ctx);
+    _ctx->bDebugOutput = tpTrue;
+}
+
+/*
+takes the callback of a context out of the chain of debug callbacks. If it is still the installed one,
+the callback it replaced is reinstalled. Otherwise a later tarp context sharing the OpenGL context chains
+to it, and is made to chain to the callback it replaced instead.
+*/
+TARP_LOCAL void _tpGLDebugOutputDeallocate(_tpGLContext * _ctx)
+{
+    GLDEBUGPROC callback = NULL;
+    void * userParam = NULL;
+    _tpGLContext * ctx;
+
+    if (!_ctx->bDebugOutput)
+        return;
+
+    glGetPointerv(GL_DEBUG_CALLBACK_FUNCTION, (void **)&callback);
+    glGetPointerv(GL_DEBUG_CALLBACK_USER_PARAM, &userParam);
+    if (callback == _tpGLDebugCallback && userParam == _ctx)
+    {
+        glDebugMessageCallback(_ctx->previousDebugCallback, _ctx->previousDebugUserParam);
+        return;
+    }
+
+    for (ctx = __g_contexts; ctx; ctx = ctx->nextContext)
+    {
+        if (ctx->bDebugOutput && ctx->previousDebugCallback == _tpGLDebugCallback && ctx->previousDebugUserParam == _ctx)
+        {
+            ctx->previousDebugCallback = _ctx->previousDebugCallback;
+            ctx->previousDebugUserParam = _ctx->previousDebugUserParam;
+        }
+    }
+}
+
+TARP_API tpContext tpContextCreateWithOptions(const tpContextOptions * _options)
 {
     _ErrorMessage msg;
     _tpGLContext * ctx;
     tpBool err;
     tpContext ret = tpContextInvalidHandle();
+    _tpGLContext * activeContext = __g_activeContext;
 
     ctx = (_tpGLContext *)TARP_MALLOC(sizeof(_tpGLContext));
     assert(ctx);
 
-    err = _createProgram(_vertexShaderCode, _fragmentShaderCode, 0, &ctx->program, &msg);
-    if (err)
-    {
-        _tpGLSetErrorMessage(msg.message);
-        return ret;
-    }
-    err = _createProgram(_vertexShaderCodeTexture, _fragmentShaderCodeTexture, 1, &ctx->textureProgram, &msg);
+    _tpGLProgramCacheInit(ctx, _options);
+    _tpGLDebugOutputInit(ctx, _options);
+    __g_activeContext = ctx;
+
+    err = _createProgram(ctx, _vertexShaderCode, _fragmentShaderCode, 0, &ctx->program, &msg);
     if (err)
     {
+        __g_activeContext = activeContext;
         _tpGLSetErrorMessage(msg.message);
         return ret;
     }
 
     ctx->tpLoc = glGetUniformLocation(ctx->program, "transformProjection");
     ctx->meshColorLoc = glGetUniformLocation(ctx->program, "meshColor");
-    ctx->tpTextureLoc = glGetUniformLocation(ctx->textureProgram, "transformProjection");
+    _tpGLProgramCacheWrite(ctx);
+    _tpGLObjectLabel(GL_PROGRAM, ctx->program, "tarp color program", NULL);
+
+    /* the gradient, layer, glyph and pattern programs are only created once they are needed */
+    ctx->textureProgram = 0;
+    ctx->layerProgram = 0;
+    ctx->glyphProgram = 0;
+    ctx->patternProgram = 0;
+    memset(&ctx->textureVao, 0, sizeof(ctx->textureVao));
+    memset(&ctx->layerVao, 0, sizeof(ctx->layerVao));
 
     _TARP_ASSERT_NO_GL_ERROR(glGenVertexArrays(1, &ctx->vao.vao));
     _TARP_ASSERT_NO_GL_ERROR(glBindVertexArray(ctx->vao.vao));
@@ -1397,16 +3187,7 @@ TARP_API tpContext tpContextCreate()
     _TARP_ASSERT_NO_GL_ERROR(glBindBuffer(GL_ARRAY_BUFFER, ctx->vao.vbo));
     _TARP_ASSERT_NO_GL_ERROR(glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, ((char *)0)));
     _TARP_ASSERT_NO_GL_ERROR(glEnableVertexAttribArray(0));
-
-    _TARP_ASSERT_NO_GL_ERROR(glGenVertexArrays(1, &ctx->textureVao.vao));
-    _TARP_ASSERT_NO_GL_ERROR(glBindVertexArray(ctx->textureVao.vao));
-    _TARP_ASSERT_NO_GL_ERROR(glGenBuffers(1, &ctx->textureVao.vbo));
-    ctx->textureVao.vboSize = 0;
-    _TARP_ASSERT_NO_GL_ERROR(glBindBuffer(GL_ARRAY_BUFFER, ctx->textureVao.vbo));
-    _TARP_ASSERT_NO_GL_ERROR(glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(tpFloat), ((char *)0)));
-    _TARP_ASSERT_NO_GL_ERROR(glEnableVertexAttribArray(0));
-    _TARP_ASSERT_NO_GL_ERROR(glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, 4 * sizeof(tpFloat), ((char *)(2 * sizeof(float)))));
-    _TARP_ASSERT_NO_GL_ERROR(glEnableVertexAttribArray(1));
+    _tpGLObjectLabel(GL_VERTEX_ARRAY, ctx->vao.vao, "tarp vertex array", NULL);
 
     ctx->clippingStackDepth = 0;
     ctx->currentClipStencilPlane = _kTpGLClippingStencilPlaneOne;
@@ -1420,18 +3201,68 @@ TARP_API tpContext tpContextCreate()
     ctx->bTransformProjDirty = tpFalse;
     ctx->transformProjection = tpMat4MakeIdentity();
 
-    _tpVec2ArrayInit(&ctx->tmpVertices, 512);
-    _tpBoolArrayInit(&ctx->tmpJoints, 256);
-    _tpGLTextureVertexArrayInit(&ctx->tmpTexVertices, 64);
-    _tpColorStopArrayInit(&ctx->tmpColorStops, 16);
+    /* empty arrays don't allocate until something is added to them */
+    memset(&ctx->tmpVertices, 0, sizeof(ctx->tmpVertices));
+    memset(&ctx->tmpJoints, 0, sizeof(ctx->tmpJoints));
+    memset(&ctx->tmpTexVertices, 0, sizeof(ctx->tmpTexVertices));
+    memset(&ctx->tmpColorStops, 0, sizeof(ctx->tmpColorStops));
+    memset(&ctx->tmpGlyphs, 0, sizeof(ctx->tmpGlyphs));
+    memset(&ctx->tmpRamps, 0, sizeof(ctx->tmpRamps));
+    ctx->rampPbo = 0;
+    ctx->parallelFor = _options ? _options->parallelFor : NULL;
+    ctx->parallelForUserData = _options ? _options->parallelForUserData : NULL;
+    if (_options && _options->vertexCapacityHint > 0)
+    {
+        _tpVec2ArrayReserve(&ctx->tmpVertices, _options->vertexCapacityHint);
+        _tpBoolArrayReserve(&ctx->tmpJoints, _options->vertexCapacityHint);
+    }
 
     ctx->clippingStyle = tpStyleMake();
     ctx->clippingStyle.stroke.type = kTpPaintTypeNone;
 
+    ctx->bRetained = tpFalse;
+    ctx->bRetainedFullRedraw = tpTrue;
+    ctx->recordList = NULL;
+    ctx->currentLayer = NULL;
+    ctx->layerParentList = NULL;
+    _tpGLCommandListInit(&ctx->previousLayerList, tpFalse);
+    _tpGLCommandListInit(&ctx->frame, tpTrue);
+    _tpGLCommandListInit(&ctx->lastFrame, tpTrue);
+    memset(&ctx->tmpKeys, 0, sizeof(ctx->tmpKeys));
+    memset(&ctx->tmpLastKeys, 0, sizeof(ctx->tmpLastKeys));
+    ctx->bDepthOrdering = tpFalse;
+    ctx->bDepthTest = tpFalse;
+    ctx->bDepthWrite = tpFalse;
+    ctx->depth = 0;
+    memset(&ctx->tmpDepthKeys, 0, sizeof(ctx->tmpDepthKeys));
+    ctx->bOcclusionCulling = tpFalse;
+    ctx->minimumPathSize = 0;
+    ctx->smallPathMode = kTpSmallPathModeSkip;
+    ctx->occluderCount = 0;
+    memset(&ctx->tmpOccluderPoints, 0, sizeof(ctx->tmpOccluderPoints));
+    ctx->damageCount = 0;
+
+    ctx->id = _tpGLNextVersion();
+    memset(&ctx->buffers, 0, sizeof(ctx->buffers));
+    memset(&ctx->freeBuffers, 0, sizeof(ctx->freeBuffers));
+    ctx->nextContext = __g_contexts;
+    __g_contexts = ctx;
+    __g_activeContext = activeContext;
+
     ret.pointer = ctx;
     return ret;
 }
 
+TARP_API int tpContextProgramCache(tpContext _ctx, void * _outData, int _maxSize)
+{
+    _tpGLContext * ctx = (_tpGLContext *)_ctx.pointer;
+    if (!ctx->bProgramCache)
+        return 0;
+    if (_outData && _maxSize >= ctx->programCache.count)
+        memcpy(_outData, ctx->programCache.array, ctx->programCache.count);
+    return ctx->programCache.count;
+}
+
 TARP_API const char * tpErrorMessage()
 {
     return __g_error;
@@ -1445,23 +3276,89 @@ TARP_API const char * tpImplementationName()
 TARP_API void tpContextDestroy(tpContext _ctx)
 {
     _tpGLContext * ctx = (_tpGLContext *)_ctx.pointer;
+    _tpGLContext ** it;
+    int i;
+
+    /* paths and glyph caches that still refer to buffers of this context won't find it anymore */
+    for (it = &__g_contexts; *it; it = &(*it)->nextContext)
+    {
+        if (*it == ctx)
+        {
+            *it = ctx->nextContext;
+            break;
+        }
+    }
 
     /* free all opengl resources */
+    for (i = 0; i < ctx->buffers.count; ++i)
+        glDeleteBuffers(1, &ctx->buffers.array[i].vbo);
     glDeleteProgram(ctx->program);
     glDeleteBuffers(1, &ctx->vao.vbo);
     glDeleteVertexArrays(1, &ctx->vao.vao);
-    glDeleteProgram(ctx->textureProgram);
-    glDeleteBuffers(1, &ctx->textureVao.vbo);
-    glDeleteVertexArrays(1, &ctx->textureVao.vao);
-
+    if (ctx->textureProgram)
+    {
+        glDeleteProgram(ctx->textureProgram);
+        glDeleteBuffers(1, &ctx->textureVao.vbo);
+        glDeleteVertexArrays(1, &ctx->textureVao.vao);
+    }
+    if (ctx->layerProgram)
+    {
+        glDeleteProgram(ctx->layerProgram);
+        glDeleteBuffers(1, &ctx->layerVao.vbo);
+        glDeleteVertexArrays(1, &ctx->layerVao.vao);
+    }
+    if (ctx->glyphProgram)
+        glDeleteProgram(ctx->glyphProgram);
+    if (ctx->patternProgram)
+        glDeleteProgram(ctx->patternProgram);
+    if (ctx->rampPbo)
+        glDeleteBuffers(1, &ctx->rampPbo);
+    _tpGLDebugOutputDeallocate(ctx);
+    if (__g_activeContext == ctx)
+        __g_activeContext = NULL;
+
+    _tpGLBufferArrayDeallocate(&ctx->buffers);
+    _tpIntArrayDeallocate(&ctx->freeBuffers);
     _tpBoolArrayDeallocate(&ctx->tmpJoints);
     _tpVec2ArrayDeallocate(&ctx->tmpVertices);
     _tpGLTextureVertexArrayDeallocate(&ctx->tmpTexVertices);
     _tpColorStopArrayDeallocate(&ctx->tmpColorStops);
+    _tpGlyphInstanceArrayDeallocate(&ctx->tmpGlyphs);
+    _tpGLGradientPtrArrayDeallocate(&ctx->tmpRamps);
+    _tpGLCommandListDeallocate(&ctx->frame);
+    _tpGLCommandListDeallocate(&ctx->lastFrame);
+    _tpGLCommandListDeallocate(&ctx->previousLayerList);
+    _tpGLCommandKeyArrayDeallocate(&ctx->tmpKeys);
+    _tpGLCommandKeyArrayDeallocate(&ctx->tmpLastKeys);
+    _tpGLDepthKeyArrayDeallocate(&ctx->tmpDepthKeys);
+    _tpVec2ArrayDeallocate(&ctx->tmpOccluderPoints);
+    _tpCharArrayDeallocate(&ctx->programCache);
+    if (ctx->programCacheDirectory)
+        TARP_FREE(ctx->programCacheDirectory);
 
     TARP_FREE(ctx);
 }
 
+TARP_LOCAL void _tpGLHitGridInit(_tpGLHitGrid * _grid)
+{
+    memset(_grid, 0, sizeof(_tpGLHitGrid));
+    _grid->version = -1;
+}
+
+TARP_LOCAL void _tpGLHitGridDeallocate(_tpGLHitGrid * _grid)
+{
+    _tpIntArrayDeallocate(&_grid->cellStarts);
+    _tpIntArrayDeallocate(&_grid->items);
+}
+
+TARP_LOCAL void _tpGLContourDeallocate(_tpGLContour * _c)
+{
+    _tpGLSegmentBufferDeallocate(&_c->segments);
+    _tpVec2ArrayDeallocate(&_c->points);
+    _tpFloatArrayDeallocate(&_c->frozenParameters);
+    _tpIntArrayDeallocate(&_c->frozenCurveCounts);
+}
+
 TARP_API tpPath tpPathCreate()
 {
     tpPath ret;
@@ -1470,16 +3367,50 @@ TARP_API tpPath tpPathCreate()
     _tpGLContourArrayInit(&path->contours, 4);
     path->currentContourIndex = -1;
     path->transform = tpTransformMakeIdentity();
+    path->transformScale = 1;
+    path->bHasTransform = tpFalse;
 
     _tpVec2ArrayInit(&path->geometryCache, 128);
     _tpGLTextureVertexArrayInit(&path->textureGeometryCache, 32);
     _tpBoolArrayInit(&path->jointCache, 128);
     path->bPathGeometryDirty = tpTrue;
+    path->bPathGeometryAppended = tpFalse;
     path->lastTransformScale = 1.0;
+    path->simplifyTolerance = 0;
+    path->simplifyBucket = 0;
+    path->quality = tpQualityHintsMake();
+    path->bFrozenTopology = tpFalse;
 
     path->strokeVertexOffset = 0;
     path->strokeVertexCount = 0;
     path->boundsVertexOffset = 0;
+    path->coverVertexCount = 0;
+    path->fillVertexGap = 0;
+
+    /* the stroke data is only used once the geometry was built, but make sure it's in a defined state */
+    memset(&path->lastStroke, 0, sizeof(path->lastStroke));
+    path->lastStroke.strokeType = kTpPaintTypeNone;
+    path->lastStroke.scaleStroke = tpTrue;
+    path->lastStyleVersion = 0;
+
+    path->geometryVersion = 0;
+    path->version = _tpGLNextVersion();
+    path->convexVersion = -1;
+    path->bConvex = tpFalse;
+    memset(&path->hitEdges, 0, sizeof(path->hitEdges));
+    memset(&path->transformedSegments, 0, sizeof(path->transformedSegments));
+    memset(&path->fillFirsts, 0, sizeof(path->fillFirsts));
+    memset(&path->fillCounts, 0, sizeof(path->fillCounts));
+    path->fillRangesVersion = -1;
+    _tpGLHitGridInit(&path->fillHitGrid);
+    _tpGLHitGridInit(&path->strokeHitGrid);
+    path->hitTestPath = tpPathInvalidHandle();
+    path->hitTestVersion = -1;
+
+    path->buffer.contextID = 0;
+    path->buffer.index = 0;
+    path->bUploadAll = tpTrue;
+    path->uploadRangeCount = 0;
 
     _tpGLGradientCacheDataInit(&path->fillGradientData, &path->boundsCache);
     _tpGLGradientCacheDataInit(&path->strokeGradientData, &path->strokeBoundsCache);
@@ -1514,8 +3445,20 @@ TARP_API tpPath tpPathClone(tpPath _path)
         {
             _tpGLContour contour;
             _tpGLContour * fromCont = _tpGLContourArrayAtPtr(&from->contours, i);
-            _tpSegmentArrayInit(&contour.segments, fromCont->segments.count);
-            _tpSegmentArrayAppendArray(&contour.segments, fromCont->segments.array, fromCont->segments.count);
+            _tpGLSegmentBufferInit(&contour.segments);
+            memset(&contour.points, 0, sizeof(contour.points));
+            memset(&contour.frozenParameters, 0, sizeof(contour.frozenParameters));
+            memset(&contour.frozenCurveCounts, 0, sizeof(contour.frozenCurveCounts));
+            contour.frozenTolerance = 0;
+            contour.bFrozenClosed = tpFalse;
+            _tpGLSegmentBufferAppendArray(&contour.segments, _tpGLSegmentBufferData(&fromCont->segments), fromCont->segments.count);
+            if (fromCont->points.count)
+            {
+                _tpVec2ArrayInit(&contour.points, fromCont->points.count);
+                _tpVec2ArrayAppendArray(&contour.points, fromCont->points.array, fromCont->points.count);
+            }
+            contour.bIsPolyline = fromCont->bIsPolyline;
+            contour.lastSegmentIndex = fromCont->lastSegmentIndex;
             contour.bDirty = fromCont->bDirty;
             contour.bIsClosed = fromCont->bIsClosed;
             contour.bLengthDirty = fromCont->bLengthDirty;
@@ -1523,6 +3466,8 @@ TARP_API tpPath tpPathClone(tpPath _path)
             contour.fillVertexCount = fromCont->fillVertexCount;
             contour.strokeVertexOffset = fromCont->strokeVertexOffset;
             contour.strokeVertexCount = fromCont->strokeVertexCount;
+            contour.flattenedSegmentCount = fromCont->flattenedSegmentCount;
+            contour.strokeCapOffset = fromCont->strokeCapOffset;
             contour.bounds = fromCont->bounds;
             contour.length = fromCont->length;
             _tpGLContourArrayAppendPtr(&path->contours, &contour);
@@ -1531,6 +3476,8 @@ TARP_API tpPath tpPathClone(tpPath _path)
 
     path->currentContourIndex = from->currentContourIndex;
     path->transform = from->transform;
+    path->transformScale = from->transformScale;
+    path->bHasTransform = from->bHasTransform;
     if (from->geometryCache.count)
         _tpVec2ArrayAppendArray(&path->geometryCache, from->geometryCache.array, from->geometryCache.count);
     if (from->textureGeometryCache.count)
@@ -1539,11 +3486,22 @@ TARP_API tpPath tpPathClone(tpPath _path)
         _tpBoolArrayAppendArray(&path->jointCache, from->jointCache.array, from->jointCache.count);
 
     path->bPathGeometryDirty = from->bPathGeometryDirty;
+    path->bPathGeometryAppended = from->bPathGeometryAppended;
     path->lastTransformScale = from->lastTransformScale;
+    path->simplifyTolerance = from->simplifyTolerance;
+    path->simplifyBucket = from->simplifyBucket;
+    path->quality = from->quality;
+    path->bFrozenTopology = from->bFrozenTopology;
 
     path->strokeVertexOffset = from->strokeVertexOffset;
     path->strokeVertexCount = from->strokeVertexCount;
     path->boundsVertexOffset = from->boundsVertexOffset;
+    path->coverVertexCount = from->coverVertexCount;
+    path->fillVertexGap = from->fillVertexGap;
+    path->lastStroke = from->lastStroke;
+    path->lastStyleVersion = from->lastStyleVersion;
+    path->geometryVersion = from->geometryVersion;
+    path->version = _tpGLNextVersion();
 
     path->boundsCache = from->boundsCache;
     path->strokeBoundsCache = from->strokeBoundsCache;
@@ -1552,11 +3510,13 @@ TARP_API tpPath tpPathClone(tpPath _path)
     path->fillGradientData.lastGradientID = from->fillGradientData.lastGradientID;
     path->fillGradientData.vertexOffset = from->fillGradientData.vertexOffset;
     path->fillGradientData.vertexCount = from->fillGradientData.vertexCount;
+    path->fillGradientData.primitive = from->fillGradientData.primitive;
 
     path->strokeGradientData.bounds = &path->strokeBoundsCache;
     path->strokeGradientData.lastGradientID = from->strokeGradientData.lastGradientID;
     path->strokeGradientData.vertexOffset = from->strokeGradientData.vertexOffset;
     path->strokeGradientData.vertexCount = from->strokeGradientData.vertexCount;
+    path->strokeGradientData.primitive = from->strokeGradientData.primitive;
 
     path->fillPaintTransform = from->fillPaintTransform;
     path->strokePaintTransform = from->strokePaintTransform;
@@ -1575,12 +3535,20 @@ TARP_API void tpPathDestroy(tpPath _path)
     _tpGLPath * p = (_tpGLPath *)_path.pointer;
     if (p)
     {
+        _tpGLReleaseBuffer(&p->buffer);
+        tpPathDestroy(p->hitTestPath);
+        _tpIntArrayDeallocate(&p->hitEdges);
+        _tpGLHitGridDeallocate(&p->fillHitGrid);
+        _tpGLHitGridDeallocate(&p->strokeHitGrid);
         _tpVec2ArrayDeallocate(&p->geometryCache);
         _tpGLTextureVertexArrayDeallocate(&p->textureGeometryCache);
         _tpBoolArrayDeallocate(&p->jointCache);
+        _tpSegmentArrayDeallocate(&p->transformedSegments);
+        _tpIntArrayDeallocate(&p->fillFirsts);
+        _tpIntArrayDeallocate(&p->fillCounts);
         for (i = 0; i < p->contours.count; ++i)
         {
-            _tpSegmentArrayDeallocate(&_tpGLContourArrayAtPtr(&p->contours, i)->segments);
+            _tpGLContourDeallocate(_tpGLContourArrayAtPtr(&p->contours, i));
         }
         _tpGLContourArrayDeallocate(&p->contours);
         TARP_FREE(p);
@@ -1597,7 +3565,9 @@ TARP_LOCAL _tpGLContour * _tpGLCurrentContour(_tpGLPath * _p)
 TARP_LOCAL _tpGLContour * _tpGLPathCreateNextContour(_tpGLPath * _p)
 {
     _tpGLContour contour;
-    _tpSegmentArrayInit(&contour.segments, 8);
+    _tpGLSegmentBufferInit(&contour.segments);
+    memset(&contour.points, 0, sizeof(contour.points));
+    contour.bIsPolyline = tpFalse;
     contour.bDirty = tpTrue;
     contour.lastSegmentIndex = -1;
     contour.bIsClosed = tpFalse;
@@ -1605,16 +3575,81 @@ TARP_LOCAL _tpGLContour * _tpGLPathCreateNextContour(_tpGLPath * _p)
     contour.fillVertexCount = 0;
     contour.strokeVertexOffset = 0;
     contour.strokeVertexCount = 0;
+    contour.flattenedSegmentCount = 0;
+    contour.strokeCapOffset = -1;
     contour.bLengthDirty = tpTrue;
+    memset(&contour.frozenParameters, 0, sizeof(contour.frozenParameters));
+    memset(&contour.frozenCurveCounts, 0, sizeof(contour.frozenCurveCounts));
+    contour.frozenTolerance = 0;
+    contour.bFrozenClosed = tpFalse;
     _p->currentContourIndex = _p->contours.count;
     _tpGLContourArrayAppendPtr(&_p->contours, &contour);
     return _tpGLContourArrayAtPtr(&_p->contours, _p->currentContourIndex);
 }
 
+/* returns the number of segments or points in case of a polyline contour */
+TARP_LOCAL int _tpGLContourSegmentCount(const _tpGLContour * _c)
+{
+    return _c->bIsPolyline ? _c->points.count : _c->segments.count;
+}
+
+/*
+turns a polyline contour into a regular segment contour. This is needed if any
+operation that requires the full segment representation is performed on it.
+*/
+TARP_LOCAL tpBool _tpGLContourMakeSegments(_tpGLContour * _c)
+{
+    int i;
+    tpVec2 * pt;
+    tpSegment * segments;
+
+    if (!_c->bIsPolyline)
+        return tpFalse;
+
+    _tpGLSegmentBufferDeallocate(&_c->segments);
+    if (_tpGLSegmentBufferReserve(&_c->segments, _c->points.count))
+    {
+        _tpGLSetErrorMessage("Could not allocate memory for segments.");
+        return tpTrue;
+    }
+
+    segments = _tpGLSegmentBufferData(&_c->segments);
+    for (i = 0; i < _c->points.count; ++i)
+    {
+        pt = _tpVec2ArrayAtPtr(&_c->points, i);
+        segments[i] = tpSegmentMake(pt->x, pt->y, pt->x, pt->y, pt->x, pt->y);
+    }
+    _c->segments.count = _c->points.count;
+
+    _tpVec2ArrayDeallocate(&_c->points);
+    _c->bIsPolyline = tpFalse;
+    _c->bDirty = tpTrue;
+    return tpFalse;
+}
+
+/*
+marks the geometry of a contour that had segments appended to it as out of date.
+If it is the last, open contour of the path and its geometry is otherwise up to date,
+only the new tail has to be flattened and stroked (see _tpGLPathAppendGeometry).
+*/
+TARP_LOCAL void _tpGLContourMarkAppended(_tpGLPath * _p, _tpGLContour * _c)
+{
+    if (_c->bDirty || _c->bIsClosed || _c != _tpGLContourArrayLastPtr(&_p->contours))
+    {
+        _c->bDirty = tpTrue;
+        _p->bPathGeometryDirty = tpTrue;
+    }
+    else
+    {
+        _p->bPathGeometryAppended = tpTrue;
+    }
+    _p->version = _tpGLNextVersion();
+}
+
 TARP_LOCAL _tpGLContour * _tpGLPathNextEmptyContour(_tpGLPath * _path)
 {
     _tpGLContour * c = _tpGLCurrentContour(_path);
-    if (!c || c->segments.count)
+    if (!c || _tpGLContourSegmentCount(c))
     {
         c = _tpGLPathCreateNextContour(_path);
     }
@@ -1623,7 +3658,11 @@ TARP_LOCAL _tpGLContour * _tpGLPathNextEmptyContour(_tpGLPath * _path)
 
 TARP_LOCAL tpBool _tpGLContourAddSegments(_tpGLPath * _p, _tpGLContour * _c, tpSegment * _segments, int count)
 {
-    int err = _tpSegmentArrayAppendArray(&_c->segments, _segments, count);
+    int err;
+    if (_tpGLContourMakeSegments(_c))
+        return tpTrue;
+
+    err = _tpGLSegmentBufferAppendArray(&_c->segments, _segments, count);
     if (err)
     {
         _tpGLSetErrorMessage("Could not allocate memory for segments.");
@@ -1631,8 +3670,7 @@ TARP_LOCAL tpBool _tpGLContourAddSegments(_tpGLPath * _p, _tpGLContour * _c, tpS
     }
 
     _c->lastSegmentIndex = _c->segments.count - 1;
-    _c->bDirty = tpTrue;
-    _p->bPathGeometryDirty = tpTrue;
+    _tpGLContourMarkAppended(_p, _c);
 
     return tpFalse;
 }
@@ -1673,6 +3711,19 @@ TARP_API tpBool tpPathLineTo(tpPath _path, tpFloat _x, tpFloat _y)
         return tpTrue;
     }
 
+    if (c->bIsPolyline)
+    {
+        tpVec2 pt = tpVec2Make(_x, _y);
+        if (_tpVec2ArrayAppendPtr(&c->points, &pt))
+        {
+            _tpGLSetErrorMessage("Could not allocate memory for polyline points.");
+            return tpTrue;
+        }
+        c->lastSegmentIndex = c->points.count - 1;
+        _tpGLContourMarkAppended(p, c);
+        return tpFalse;
+    }
+
     return _tpGLContourAddSegment(p, c, _x, _y, _x, _y, _x, _y);
 }
 
@@ -1691,10 +3742,11 @@ TARP_API tpBool tpPathClear(tpPath _path)
     p->currentContourIndex = -1;
     for (i = 0; i < p->contours.count; ++i)
     {
-        _tpSegmentArrayDeallocate(&_tpGLContourArrayAtPtr(&p->contours, i)->segments);
+        _tpGLContourDeallocate(_tpGLContourArrayAtPtr(&p->contours, i));
     }
     _tpGLContourArrayClear(&p->contours);
     p->bPathGeometryDirty = tpTrue;
+    p->version = _tpGLNextVersion();
 
     return tpFalse;
 }
@@ -1714,8 +3766,11 @@ TARP_API tpBool tpPathCubicCurveTo(tpPath _path, tpFloat _h0x, tpFloat _h0y, tpF
         return tpTrue;
     }
 
-    _tpSegmentArrayAtPtr(&c->segments, c->lastSegmentIndex)->handleOut = tpVec2Make(_h0x, _h0y);
-    return _tpGLContourAddSegment(p, c, _h1x, _h1y, _px, _py, _px, _py);
+    if (_tpGLContourMakeSegments(c))
+        return tpTrue;
+
+    _tpGLSegmentBufferAtPtr(&c->segments, c->lastSegmentIndex)->handleOut = tpVec2Make(_h0x, _h0y);
+    return _tpGLContourAddSegment(p, c, _h1x, _h1y, _px, _py, _px, _py);
 }
 
 TARP_API tpBool tpPathQuadraticCurveTo(tpPath _path, tpFloat _hx, tpFloat _hy, tpFloat _px, tpFloat _py)
@@ -1728,7 +3783,10 @@ TARP_API tpBool tpPathQuadraticCurveTo(tpPath _path, tpFloat _hx, tpFloat _hy, t
         return tpTrue;
     }
 
-    _tpSegmentArrayAtPtr(&c->segments, c->lastSegmentIndex)->handleOut = tpVec2Make(_hx, _hy);
+    if (_tpGLContourMakeSegments(c))
+        return tpTrue;
+
+    _tpGLSegmentBufferAtPtr(&c->segments, c->lastSegmentIndex)->handleOut = tpVec2Make(_hx, _hy);
     return _tpGLContourAddSegment(p, c, _hx, _hy, _px, _py, _px, _py);
 }
 
@@ -1736,12 +3794,13 @@ TARP_API tpBool tpPathClose(tpPath _path)
 {
     _tpGLPath * p = (_tpGLPath *)_path.pointer;
     _tpGLContour * c = _tpGLCurrentContour(p);
-    if (c && c->segments.count > 1)
+    if (c && _tpGLContourSegmentCount(c) > 1)
     {
         c->bIsClosed = tpTrue;
         c->bDirty = tpTrue;
         p->currentContourIndex = -1;
         p->bPathGeometryDirty = tpTrue;
+        p->version = _tpGLNextVersion();
     }
     else
     {
@@ -1754,9 +3813,10 @@ TARP_API tpBool tpPathRemoveContour(tpPath _path, int _index)
 {
     _tpGLPath * p = (_tpGLPath *)_path.pointer;
     _tpGLContour * c = _tpGLContourArrayAtPtr(&p->contours, _index);
-    _tpSegmentArrayDeallocate(&c->segments);
+    _tpGLContourDeallocate(c);
     _tpGLContourArrayRemove(&p->contours, _index);
     p->bPathGeometryDirty = tpTrue;
+    p->version = _tpGLNextVersion();
     p->currentContourIndex = p->contours.count - 1;
     return tpFalse;
 }
@@ -1765,8 +3825,13 @@ TARP_API tpBool tpPathRemoveSegment(tpPath _path, int _contourIndex, int _index)
 {
     _tpGLPath * p = (_tpGLPath *)_path.pointer;
     _tpGLContour * c = _tpGLContourArrayAtPtr(&p->contours, _contourIndex);
-    _tpSegmentArrayRemove(&c->segments, _index);
+    if (c->bIsPolyline)
+        _tpVec2ArrayRemove(&c->points, _index);
+    else
+        _tpGLSegmentBufferRemoveRange(&c->segments, _index, _index + 1);
+    c->lastSegmentIndex = _tpGLContourSegmentCount(c) - 1;
     p->bPathGeometryDirty = tpTrue;
+    p->version = _tpGLNextVersion();
     c->bDirty = tpTrue;
     return tpFalse;
 }
@@ -1775,15 +3840,24 @@ TARP_API tpBool tpPathRemoveSegments(tpPath _path, int _contourIndex, int _from,
 {
     _tpGLPath * p = (_tpGLPath *)_path.pointer;
     _tpGLContour * c = _tpGLContourArrayAtPtr(&p->contours, _contourIndex);
-    _tpSegmentArrayRemoveRange(&c->segments, _from, _to);
+    if (c->bIsPolyline)
+        _tpVec2ArrayRemoveRange(&c->points, _from, _to);
+    else
+        _tpGLSegmentBufferRemoveRange(&c->segments, _from, _to);
+    c->lastSegmentIndex = _tpGLContourSegmentCount(c) - 1;
     p->bPathGeometryDirty = tpTrue;
+    p->version = _tpGLNextVersion();
     c->bDirty = tpTrue;
     return tpFalse;
 }
 
 TARP_LOCAL tpBool _tpGLPathAddSegmentsToCurrentContour(_tpGLPath * _p, _tpGLContour * _c, tpSegment * _segments, int _count)
 {
-    int err = _tpSegmentArrayAppendArray(&_c->segments, _segments, _count);
+    int err;
+    if (_tpGLContourMakeSegments(_c))
+        return tpTrue;
+
+    err = _tpGLSegmentBufferAppendArray(&_c->segments, _segments, _count);
     if (err)
     {
         _tpGLSetErrorMessage("Could not allocate memory for segments.");
@@ -1791,8 +3865,7 @@ TARP_LOCAL tpBool _tpGLPathAddSegmentsToCurrentContour(_tpGLPath * _p, _tpGLCont
     }
 
     _c->lastSegmentIndex = _c->segments.count - 1;
-    _c->bDirty = tpTrue;
-    _p->bPathGeometryDirty = tpTrue;
+    _tpGLContourMarkAppended(_p, _c);
     return tpFalse;
 }
 
@@ -1830,18 +3903,152 @@ TARP_API tpBool tpPathSetContour(tpPath _path, int _contourIndex, tpSegment * _s
     if (_contourIndex < p->contours.count)
     {
         _tpGLContour * c = _tpGLContourArrayAtPtr(&p->contours, _contourIndex);
-        _tpSegmentArrayClear(&c->segments);
-        _tpSegmentArrayAppendArray(&c->segments, _segments, _count);
+        if (_tpGLContourMakeSegments(c))
+            return tpTrue;
+        c->segments.count = 0;
+        if (_tpGLSegmentBufferAppendArray(&c->segments, _segments, _count))
+        {
+            _tpGLSetErrorMessage("Could not allocate memory for segments.");
+            return tpTrue;
+        }
         c->lastSegmentIndex = c->segments.count - 1;
-        c->bIsClosed = tpTrue;
+        c->bIsClosed = _bClosed;
         c->bDirty = tpTrue;
+        c->bLengthDirty = tpTrue;
         p->bPathGeometryDirty = tpTrue;
+        p->version = _tpGLNextVersion();
         return tpFalse;
     }
     else
         return tpPathAddContour(_path, _segments, _count, _bClosed);
 }
 
+TARP_API tpBool tpPathAddPolyline(tpPath _path, const tpFloat * _xy, int _count, tpBool _bClosed)
+{
+    _tpGLPath * p = (_tpGLPath *)_path.pointer;
+    _tpGLContour * c;
+
+    if (!_xy || _count < 1)
+    {
+        _tpGLSetErrorMessage("tpPathAddPolyline needs at least one point.");
+        return tpTrue;
+    }
+
+    c = _tpGLPathNextEmptyContour(p);
+
+    /* the current contour is empty, so we can simply swap its (empty) segment storage for points */
+    _tpGLSegmentBufferDeallocate(&c->segments);
+    _tpVec2ArrayDeallocate(&c->points);
+    c->bIsPolyline = tpTrue;
+
+    /* tpVec2 is two tightly packed floats, so we can copy the xy array as is */
+    if (_tpVec2ArrayInit(&c->points, _count) ||
+            _tpVec2ArrayAppendArray(&c->points, (tpVec2 *)_xy, _count))
+    {
+        _tpGLSetErrorMessage("Could not allocate memory for polyline points.");
+        return tpTrue;
+    }
+
+    c->lastSegmentIndex = c->points.count - 1;
+    c->bDirty = tpTrue;
+    p->bPathGeometryDirty = tpTrue;
+    p->version = _tpGLNextVersion();
+
+    if (_bClosed)
+        return tpPathClose(_path);
+    return tpFalse;
+}
+
+TARP_API tpBool tpPathAddCommands(tpPath _path, const tpPathCommand * _commands, int _commandCount,
+                                  const tpFloat * _coords, int _coordCount)
+{
+    static const int s_coordCounts[] = {2, 2, 4, 6, 0};
+
+    int i, n;
+    tpPathCommand cmd;
+    tpSegment seg;
+    tpVec2 pt;
+    const tpFloat * v = _coords;
+    _tpGLPath * p = (_tpGLPath *)_path.pointer;
+    _tpGLContour * c = _tpGLCurrentContour(p);
+
+    for (i = 0; i < _commandCount; ++i, v += n)
+    {
+        cmd = _commands[i];
+        if ((int)cmd < kTpPathCommandMoveTo || cmd > kTpPathCommandClose)
+        {
+            _tpGLSetErrorMessage("tpPathAddCommands encountered an invalid command.");
+            return tpTrue;
+        }
+
+        n = s_coordCounts[cmd];
+        if ((int)(v - _coords) + n > _coordCount)
+        {
+            _tpGLSetErrorMessage("tpPathAddCommands ran out of coordinates.");
+            return tpTrue;
+        }
+
+        if (cmd == kTpPathCommandClose)
+        {
+            if (tpPathClose(_path))
+                return tpTrue;
+            c = NULL;
+            continue;
+        }
+
+        if (cmd == kTpPathCommandMoveTo)
+        {
+            c = _tpGLPathNextEmptyContour(p);
+        }
+        else if (!c || c->lastSegmentIndex == -1)
+        {
+            _tpGLSetErrorMessage("You have to start a contour before issuing this command (see tpPathMoveTo).");
+            return tpTrue;
+        }
+        else if (cmd == kTpPathCommandLineTo && c->bIsPolyline)
+        {
+            pt = tpVec2Make(v[0], v[1]);
+            if (_tpVec2ArrayAppendPtr(&c->points, &pt))
+            {
+                _tpGLSetErrorMessage("Could not allocate memory for polyline points.");
+                return tpTrue;
+            }
+            c->lastSegmentIndex = c->points.count - 1;
+            _tpGLContourMarkAppended(p, c);
+            continue;
+        }
+
+        if (_tpGLContourMakeSegments(c))
+            return tpTrue;
+
+        /* the handles of curve commands are stored in the previous and the new segment */
+        if (cmd == kTpPathCommandQuadraticCurveTo)
+        {
+            _tpGLSegmentBufferAtPtr(&c->segments, c->lastSegmentIndex)->handleOut = tpVec2Make(v[0], v[1]);
+            seg = tpSegmentMake(v[0], v[1], v[2], v[3], v[2], v[3]);
+        }
+        else if (cmd == kTpPathCommandCubicCurveTo)
+        {
+            _tpGLSegmentBufferAtPtr(&c->segments, c->lastSegmentIndex)->handleOut = tpVec2Make(v[0], v[1]);
+            seg = tpSegmentMake(v[2], v[3], v[4], v[5], v[4], v[5]);
+        }
+        else
+        {
+            seg = tpSegmentMake(v[0], v[1], v[0], v[1], v[0], v[1]);
+        }
+
+        if (_tpGLSegmentBufferAppendArray(&c->segments, &seg, 1))
+        {
+            _tpGLSetErrorMessage("Could not allocate memory for segments.");
+            return tpTrue;
+        }
+        c->lastSegmentIndex = c->segments.count - 1;
+        _tpGLContourMarkAppended(p, c);
+    }
+
+    return tpFalse;
+}
+
 TARP_API tpBool tpPathAddCircle(tpPath _path, tpFloat _x, tpFloat _y, tpFloat _r)
 {
     tpFloat dr = _r * 2.0;
@@ -1930,6 +4137,7 @@ TARP_API tpBool tpPathSetFillPaintTransform(tpPath _path, const tpTransform * _t
     _tpGLPath * p = (_tpGLPath *)_path.pointer;
     p->fillPaintTransform = *_transform;
     p->bFillPaintTransformDirty = tpTrue;
+    p->version = _tpGLNextVersion();
     return tpFalse;
 }
 
@@ -1938,9 +4146,103 @@ TARP_API tpBool tpPathSetStrokePaintTransform(tpPath _path, const tpTransform *
     _tpGLPath * p = (_tpGLPath *)_path.pointer;
     p->strokePaintTransform = *_transform;
     p->bStrokePaintTransformDirty = tpTrue;
+    p->version = _tpGLNextVersion();
+    return tpFalse;
+}
+
+TARP_API tpBool tpPathSetTransform(tpPath _path, const tpTransform * _transform)
+{
+    tpTransform identity;
+    const tpFloat * m = _transform->m.v;
+    _tpGLPath * p = (_tpGLPath *)_path.pointer;
+
+    if (tpTransformEquals(&p->transform, _transform))
+        return tpFalse;
+
+    identity = tpTransformMakeIdentity();
+    p->transform = *_transform;
+    p->transformScale = TARP_MAX(sqrt(m[0] * m[0] + m[1] * m[1]), sqrt(m[2] * m[2] + m[3] * m[3]));
+    p->bHasTransform = (tpBool)!tpTransformEquals(_transform, &identity);
+
+    /* makes the next draw check if the geometry is still detailed enough */
+    p->lastDrawContext = NULL;
+    p->version = _tpGLNextVersion();
+    return tpFalse;
+}
+
+TARP_API tpBool tpPathSetSimplifyTolerance(tpPath _path, tpFloat _tolerance)
+{
+    _tpGLPath * p = (_tpGLPath *)_path.pointer;
+    if (_tolerance < 0)
+    {
+        _tpGLSetErrorMessage("The simplify tolerance can't be negative.");
+        return tpTrue;
+    }
+    if (p->simplifyTolerance != _tolerance)
+    {
+        p->simplifyTolerance = _tolerance;
+        _tpGLMarkPathGeometryDirty(p);
+        p->version = _tpGLNextVersion();
+    }
+    return tpFalse;
+}
+
+TARP_API tpBool tpPathSetQualityHints(tpPath _path, const tpQualityHints * _hints)
+{
+    _tpGLPath * p = (_tpGLPath *)_path.pointer;
+    if (_hints->curveQuality <= 0 || _hints->roundQuality <= 0 || _hints->gradientQuality <= 0)
+    {
+        _tpGLSetErrorMessage("Quality hints have to be bigger than zero.");
+        return tpTrue;
+    }
+
+    /* the flattening changes all of the geometry, round joins and caps are checked against lastStroke */
+    if (p->quality.curveQuality != _hints->curveQuality)
+        _tpGLMarkPathGeometryDirty(p);
+    if (p->quality.gradientQuality != _hints->gradientQuality)
+    {
+        p->fillGradientData.lastGradientID = -1;
+        p->strokeGradientData.lastGradientID = -1;
+    }
+    if (memcmp(&p->quality, _hints, sizeof(tpQualityHints)) != 0)
+    {
+        p->quality = *_hints;
+        p->version = _tpGLNextVersion();
+    }
+    return tpFalse;
+}
+
+TARP_API tpBool tpPathSetFrozenTopology(tpPath _path, tpBool _bFrozen)
+{
+    int i;
+    _tpGLContour * c;
+    _tpGLPath * p = (_tpGLPath *)_path.pointer;
+
+    if (p->bFrozenTopology == _bFrozen)
+        return tpFalse;
+
+    /* once unfrozen, the curves are subdivided adaptively again */
+    p->bFrozenTopology = _bFrozen;
+    for (i = 0; i < p->contours.count; ++i)
+    {
+        c = _tpGLContourArrayAtPtr(&p->contours, i);
+        _tpFloatArrayClear(&c->frozenParameters);
+        _tpIntArrayClear(&c->frozenCurveCounts);
+    }
+    _tpGLMarkPathGeometryDirty(p);
+    p->version = _tpGLNextVersion();
     return tpFalse;
 }
 
+TARP_API tpQualityHints tpQualityHintsMake()
+{
+    tpQualityHints ret;
+    ret.curveQuality = 1;
+    ret.roundQuality = 1;
+    ret.gradientQuality = 1;
+    return ret;
+}
+
 TARP_API tpStyle tpStyleMake()
 {
     tpStyle ret;
@@ -1961,6 +4263,199 @@ TARP_API tpStyle tpStyleMake()
     return ret;
 }
 
+/* every change of a style handle gets a new version so that paths notice it (see _tpGLPathUpdateGeometry) */
+TARP_LOCAL void _tpGLStyleChanged(_tpGLStyle * _style)
+{
+    _style->style.dashArray = _style->dashes;
+    _style->version = _tpGLNextVersion();
+}
+
+TARP_API tpStyleHandle tpStyleCreate()
+{
+    tpStyle style = tpStyleMake();
+    style.dashArray = NULL;
+    return tpStyleCreateFrom(&style);
+}
+
+TARP_API tpStyleHandle tpStyleCreateFrom(const tpStyle * _style)
+{
+    tpStyleHandle ret = {NULL};
+    _tpGLStyle * style;
+
+    style = (_tpGLStyle *)TARP_MALLOC(sizeof(_tpGLStyle));
+    if (!style)
+        return ret;
+    ret.pointer = style;
+
+    if (tpStyleSet(ret, _style))
+    {
+        TARP_FREE(style);
+        ret.pointer = NULL;
+    }
+    return ret;
+}
+
+TARP_API tpStyleHandle tpStyleClone(tpStyleHandle _style)
+{
+    return tpStyleCreateFrom(&((_tpGLStyle *)_style.pointer)->style);
+}
+
+TARP_API void tpStyleDestroy(tpStyleHandle _style)
+{
+    if (_style.pointer)
+        TARP_FREE(_style.pointer);
+}
+
+TARP_API tpBool tpStyleSet(tpStyleHandle _style, const tpStyle * _from)
+{
+    _tpGLStyle * style = (_tpGLStyle *)_style.pointer;
+
+    if (_from->dashCount < 0 || _from->dashCount > TARP_MAX_DASH_ARRAY_SIZE)
+    {
+        _tpGLSetErrorMessage("The dash array of a style can't have more than TARP_MAX_DASH_ARRAY_SIZE entries.");
+        return tpTrue;
+    }
+
+    style->style = *_from;
+    if (_from->dashCount)
+        memmove(style->dashes, _from->dashArray, sizeof(tpFloat) * _from->dashCount);
+    _tpGLStyleChanged(style);
+    return tpFalse;
+}
+
+TARP_API tpStyle tpStyleGet(tpStyleHandle _style)
+{
+    return ((_tpGLStyle *)_style.pointer)->style;
+}
+
+TARP_API void tpStyleSetFill(tpStyleHandle _style, tpPaint _paint)
+{
+    _tpGLStyle * style = (_tpGLStyle *)_style.pointer;
+    style->style.fill = _paint;
+    _tpGLStyleChanged(style);
+}
+
+TARP_API void tpStyleSetFillColor(tpStyleHandle _style, tpFloat _r, tpFloat _g, tpFloat _b, tpFloat _a)
+{
+    tpStyleSetFill(_style, tpPaintMakeColor(_r, _g, _b, _a));
+}
+
+TARP_API void tpStyleSetFillGradient(tpStyleHandle _style, tpGradient _gradient)
+{
+    tpStyleSetFill(_style, tpPaintMakeGradient(_gradient));
+}
+
+TARP_API void tpStyleSetFillRule(tpStyleHandle _style, tpFillRule _fillRule)
+{
+    _tpGLStyle * style = (_tpGLStyle *)_style.pointer;
+    style->style.fillRule = _fillRule;
+    _tpGLStyleChanged(style);
+}
+
+TARP_API void tpStyleSetStroke(tpStyleHandle _style, tpPaint _paint)
+{
+    _tpGLStyle * style = (_tpGLStyle *)_style.pointer;
+    style->style.stroke = _paint;
+    _tpGLStyleChanged(style);
+}
+
+TARP_API void tpStyleSetStrokeColor(tpStyleHandle _style, tpFloat _r, tpFloat _g, tpFloat _b, tpFloat _a)
+{
+    tpStyleSetStroke(_style, tpPaintMakeColor(_r, _g, _b, _a));
+}
+
+TARP_API void tpStyleSetStrokeGradient(tpStyleHandle _style, tpGradient _gradient)
+{
+    tpStyleSetStroke(_style, tpPaintMakeGradient(_gradient));
+}
+
+TARP_API void tpStyleSetStrokeWidth(tpStyleHandle _style, tpFloat _width)
+{
+    _tpGLStyle * style = (_tpGLStyle *)_style.pointer;
+    style->style.strokeWidth = _width;
+    _tpGLStyleChanged(style);
+}
+
+TARP_API void tpStyleSetStrokeJoin(tpStyleHandle _style, tpStrokeJoin _join)
+{
+    _tpGLStyle * style = (_tpGLStyle *)_style.pointer;
+    style->style.strokeJoin = _join;
+    _tpGLStyleChanged(style);
+}
+
+TARP_API void tpStyleSetStrokeCap(tpStyleHandle _style, tpStrokeCap _cap)
+{
+    _tpGLStyle * style = (_tpGLStyle *)_style.pointer;
+    style->style.strokeCap = _cap;
+    _tpGLStyleChanged(style);
+}
+
+TARP_API void tpStyleSetMiterLimit(tpStyleHandle _style, tpFloat _limit)
+{
+    _tpGLStyle * style = (_tpGLStyle *)_style.pointer;
+    style->style.miterLimit = _limit;
+    _tpGLStyleChanged(style);
+}
+
+TARP_API void tpStyleSetScaleStroke(tpStyleHandle _style, tpBool _bScaleStroke)
+{
+    _tpGLStyle * style = (_tpGLStyle *)_style.pointer;
+    style->style.scaleStroke = _bScaleStroke;
+    _tpGLStyleChanged(style);
+}
+
+TARP_API tpBool tpStyleSetDashArray(tpStyleHandle _style, const tpFloat * _dashArray, int _count)
+{
+    _tpGLStyle * style = (_tpGLStyle *)_style.pointer;
+
+    if (_count < 0 || _count > TARP_MAX_DASH_ARRAY_SIZE || (_count && !_dashArray))
+    {
+        _tpGLSetErrorMessage("tpStyleSetDashArray failed because of invalid arguments.");
+        return tpTrue;
+    }
+
+    if (_count)
+        memcpy(style->dashes, _dashArray, sizeof(tpFloat) * _count);
+    style->style.dashCount = _count;
+    _tpGLStyleChanged(style);
+    return tpFalse;
+}
+
+TARP_API void tpStyleSetDashOffset(tpStyleHandle _style, tpFloat _offset)
+{
+    _tpGLStyle * style = (_tpGLStyle *)_style.pointer;
+    style->style.dashOffset = _offset;
+    _tpGLStyleChanged(style);
+}
+
+/* queues the ramp texture of a gradient to be regenerated (see _tpGLUploadDirtyRamps) */
+TARP_LOCAL void _tpGLGradientMarkRampDirty(_tpGLGradient * _grad)
+{
+    if (_grad->bRampDirty)
+        return;
+    _grad->bRampDirty = tpTrue;
+    _grad->prevDirtyRamp = NULL;
+    _grad->nextDirtyRamp = __g_dirtyRamps;
+    if (__g_dirtyRamps)
+        __g_dirtyRamps->prevDirtyRamp = _grad;
+    __g_dirtyRamps = _grad;
+}
+
+TARP_LOCAL void _tpGLGradientUnlinkDirtyRamp(_tpGLGradient * _grad)
+{
+    if (!_grad->bRampDirty)
+        return;
+    if (_grad->prevDirtyRamp)
+        _grad->prevDirtyRamp->nextDirtyRamp = _grad->nextDirtyRamp;
+    else
+        __g_dirtyRamps = _grad->nextDirtyRamp;
+    if (_grad->nextDirtyRamp)
+        _grad->nextDirtyRamp->prevDirtyRamp = _grad->prevDirtyRamp;
+    _grad->bRampDirty = tpFalse;
+    _grad->prevDirtyRamp = NULL;
+    _grad->nextDirtyRamp = NULL;
+}
+
 TARP_LOCAL _tpGLGradient * tpGradientCreate()
 {
     static int s_id = 0;
@@ -1972,6 +4467,11 @@ TARP_LOCAL _tpGLGradient * tpGradientCreate()
     thread local storage will most likely be the nicest way to make this thread safe
     */
     ret->gradientID = s_id++;
+    ret->version = _tpGLNextVersion();
+    ret->bRampDirty = tpFalse;
+    ret->prevDirtyRamp = NULL;
+    ret->nextDirtyRamp = NULL;
+    _tpGLGradientMarkRampDirty(ret);
 
     _TARP_ASSERT_NO_GL_ERROR(glGenTextures(1, &ret->rampTexture));
     _TARP_ASSERT_NO_GL_ERROR(glBindTexture(GL_TEXTURE_1D, ret->rampTexture));
@@ -2025,9 +4525,17 @@ TARP_API tpGradient tpGradientClone(tpGradient _gradient)
     _tpGLGradient * ret = tpGradientCreate();
     _tpGLGradient * grad = (_tpGLGradient *)_gradient.pointer;
     int id = ret->gradientID;
+    GLuint rampTexture = ret->rampTexture;
 
+    /* the clone keeps its own ramp texture and dirty list links */
+    _tpGLGradientUnlinkDirtyRamp(ret);
     *ret = *grad;
     ret->gradientID = id;
+    ret->rampTexture = rampTexture;
+    ret->bDirty = tpTrue;
+    ret->bRampDirty = tpFalse;
+    _tpGLGradientMarkRampDirty(ret);
+    ret->version = _tpGLNextVersion();
     _tpColorStopArrayInit(&ret->stops, grad->stops.count);
     _tpColorStopArrayAppendArray(&ret->stops, grad->stops.array, grad->stops.count);
 
@@ -2041,6 +4549,7 @@ TARP_API void tpGradientSetPositions(tpGradient _gradient, tpFloat _x0, tpFloat
     g->origin = tpVec2Make(_x0, _y0);
     g->destination = tpVec2Make(_x1, _y1);
     g->bDirty = tpTrue;
+    g->version = _tpGLNextVersion();
 }
 
 TARP_API void tpGradientSetFocalPointOffset(tpGradient _gradient, tpFloat _x, tpFloat _y)
@@ -2048,6 +4557,7 @@ TARP_API void tpGradientSetFocalPointOffset(tpGradient _gradient, tpFloat _x, tp
     _tpGLGradient * g = (_tpGLGradient *)_gradient.pointer;
     g->focal_point_offset = tpVec2Make(_x, _y);
     g->bDirty = tpTrue;
+    g->version = _tpGLNextVersion();
 }
 
 TARP_API void tpGradientSetRatio(tpGradient _gradient, tpFloat _ratio)
@@ -2055,6 +4565,7 @@ TARP_API void tpGradientSetRatio(tpGradient _gradient, tpFloat _ratio)
     _tpGLGradient * g = (_tpGLGradient *)_gradient.pointer;
     g->ratio = _ratio;
     g->bDirty = tpTrue;
+    g->version = _tpGLNextVersion();
 }
 
 TARP_API void tpGradientAddColorStop(tpGradient _gradient, tpFloat _r, tpFloat _g, tpFloat _b, tpFloat _a, tpFloat _offset)
@@ -2064,14 +4575,16 @@ TARP_API void tpGradientAddColorStop(tpGradient _gradient, tpFloat _r, tpFloat _
     stop.color = tpColorMake(_r, _g, _b, _a);
     stop.offset = _offset;
     _tpColorStopArrayAppendPtr(&g->stops, &stop);
-    g->bDirty = tpTrue;
+    _tpGLGradientMarkRampDirty(g);
+    g->version = _tpGLNextVersion();
 }
 
 TARP_API void tpGradientClearColorStops(tpGradient _gradient)
 {
     _tpGLGradient * g = (_tpGLGradient *)_gradient.pointer;
     _tpColorStopArrayClear(&g->stops);
-    g->bDirty = tpTrue;
+    _tpGLGradientMarkRampDirty(g);
+    g->version = _tpGLNextVersion();
 }
 
 TARP_API void tpGradientDestroy(tpGradient _gradient)
@@ -2079,6 +4592,7 @@ TARP_API void tpGradientDestroy(tpGradient _gradient)
     _tpGLGradient * g = (_tpGLGradient *)_gradient.pointer;
     if (g)
     {
+        _tpGLGradientUnlinkDirtyRamp(g);
         _TARP_ASSERT_NO_GL_ERROR(glDeleteTextures(1, &g->rampTexture));
         _tpColorStopArrayDeallocate(&g->stops);
         TARP_FREE(g);
@@ -2150,6 +4664,19 @@ TARP_LOCAL void _tpGLEvaluatePointForBounds(tpVec2 _vec, _tpGLRect * _bounds)
     _bounds->max.y = TARP_MAX(_vec.y, _bounds->max.y);
 }
 
+/* merges the bounds of _count points into _bounds (see tpVec2ArrayBounds) */
+TARP_LOCAL void _tpGLEvaluatePointsForBounds(const tpVec2 * _points, int _count, _tpGLRect * _bounds)
+{
+    _tpGLRect r;
+    if (_count <= 0)
+        return;
+    tpVec2ArrayBounds(_points, _count, &r.min, &r.max);
+    _bounds->min.x = TARP_MIN(r.min.x, _bounds->min.x);
+    _bounds->min.y = TARP_MIN(r.min.y, _bounds->min.y);
+    _bounds->max.x = TARP_MAX(r.max.x, _bounds->max.x);
+    _bounds->max.y = TARP_MAX(r.max.y, _bounds->max.y);
+}
+
 tpFloat _tpGLShortestAngle(tpVec2 _d0, tpVec2 _d1)
 {
     tpFloat theta = acos(_d0.x * _d1.x + _d0.y * _d1.y);
@@ -2184,8 +4711,8 @@ TARP_LOCAL void _tpGLMakeCircleSector(tpVec2 _center, tpVec2 _r0, tpVec2 _r1, tp
     tpVec2 r, current, last;
     tpFloat stepSize;
 
-    /* @TODO: The step size should depend on _levelOfDetail. */
-    stepSize = TARP_PI / 16;
+    /* 16 steps per half circle at a level of detail of 1 (see tpQualityHints.roundQuality) */
+    stepSize = TARP_PI / TARP_MAX(2.0f, 16 * _levelOfDetail);
     rot = tpMat2MakeRotation(stepSize);
     r = _r0;
     last = tpVec2Add(_center, r);
@@ -2250,18 +4777,18 @@ TARP_LOCAL void _tpGLMakeJoin(tpStrokeJoin _type,
                               tpVec2 _lePrev, tpVec2 _rePrev,
                               tpVec2 _le, tpVec2 _re,
                               tpFloat _cross, tpFloat _miterLimit,
+                              tpFloat _levelOfDetail,
                               _tpVec2Array * _outVertices)
 {
     tpVec2 nperp0, nperp1;
-    tpFloat miterLen, theta, levelOfDetail;
+    tpFloat miterLen, theta;
 
     switch (_type)
     {
         case kTpStrokeJoinRound:
-            levelOfDetail = 0; /* TODO: levelOfDetail should depend on the stroke width and the transform */
             if (_cross < 0.0f)
             {
-                _tpGLMakeCircleSector(_p, _perp0, _perp1, levelOfDetail, _outVertices);
+                _tpGLMakeCircleSector(_p, _perp0, _perp1, _levelOfDetail, _outVertices);
             }
             else
             {
@@ -2269,7 +4796,7 @@ TARP_LOCAL void _tpGLMakeJoin(tpStrokeJoin _type,
                 tpVec2 flippedPerp0, flippedPerp1;
                 flippedPerp0 = tpVec2Make(-_perp0.x, -_perp0.y);
                 flippedPerp1 = tpVec2Make(-_perp1.x, -_perp1.y);
-                _tpGLMakeCircleSector(_p, flippedPerp1, flippedPerp0, levelOfDetail, _outVertices);
+                _tpGLMakeCircleSector(_p, flippedPerp1, flippedPerp0, _levelOfDetail, _outVertices);
             }
             break;
         case kTpStrokeJoinMiter:
@@ -2320,17 +4847,15 @@ TARP_LOCAL void _tpGLMakeCap(tpStrokeCap _type,
                              tpVec2 _perp,
                              tpVec2 _le, tpVec2 _re,
                              tpBool _bStart,
+                             tpFloat _levelOfDetail,
                              _tpVec2Array * _outVertices)
 {
-    tpFloat levelOfDetail;
     tpVec2 flippedPerp;
     switch (_type)
     {
         case kTpStrokeCapRound:
-            /* TODO: levelOfDetail should depend on the stroke width and the transform */
-            levelOfDetail = 0;
             flippedPerp = tpVec2Make(-_perp.x, -_perp.y);
-            _tpGLMakeCircleSector(_p, _perp, flippedPerp, levelOfDetail, _outVertices);
+            _tpGLMakeCircleSector(_p, _perp, flippedPerp, _levelOfDetail, _outVertices);
             break;
         case kTpStrokeCapSquare:
             _tpGLMakeCapSquare(_p, _dir, _le, _re, _outVertices);
@@ -2341,118 +4866,138 @@ TARP_LOCAL void _tpGLMakeCap(tpStrokeCap _type,
     }
 }
 
-TARP_LOCAL void _tpGLContinousStrokeGeometry(_tpGLPath * _path, const tpStyle * _style, _tpVec2Array * _vertices, _tpBoolArray * _joints)
+TARP_LOCAL void _tpGLContinousStrokeContour(_tpGLContour * _c, const tpStyle * _style, tpFloat _levelOfDetail, int _startVertex, _tpVec2Array * _vertices, _tpBoolArray * _joints)
 {
-    int i, j, voff;
-    _tpGLContour * c;
+    int j;
     tpVec2 p0, p1, dir, perp, dirPrev, perpPrev;
     tpVec2 le0, le1, re0, re1, lePrev, rePrev;
     tpVec2 firstDir, firstPerp, firstLe, firstRe;
     tpFloat cross, halfSw;
 
-    assert(_vertices->count == _joints->count);
-
     halfSw = _style->strokeWidth * 0.5;
+    _c->strokeCapOffset = -1;
 
-    /* generate the stroke geometry for each contour */
-    for (i = 0; i < _path->contours.count; ++i)
+    if (_c->fillVertexCount <= 1)
+        return;
+
+    /*
+    if we don't start at the beginning of the contour (i.e. when continuing the stroke
+    of appended geometry), recover the state of the previous segment for the join.
+    */
+    if (_startVertex > _c->fillVertexOffset)
     {
-        voff = _vertices->count;
-        c = _tpGLContourArrayAtPtr(&_path->contours, i);
-        c->strokeVertexOffset = voff;
-        if (c->fillVertexCount <= 1)
-        {
-            c->strokeVertexCount = 0;
-            continue;
-        }
+        p0 = _tpVec2ArrayAt(_vertices, _startVertex - 1);
+        p1 = _tpVec2ArrayAt(_vertices, _startVertex);
+        dirPrev = tpVec2Sub(p1, p0);
+        tpVec2NormalizeSelf(&dirPrev);
+        perpPrev.x = dirPrev.y * halfSw;
+        perpPrev.y = -dirPrev.x * halfSw;
+        lePrev = tpVec2Add(p1, perpPrev);
+        rePrev = tpVec2Sub(p1, perpPrev);
+    }
 
-        for (j = c->fillVertexOffset; j < c->fillVertexOffset + c->fillVertexCount - 1; ++j)
+    for (j = _startVertex; j < _c->fillVertexOffset + _c->fillVertexCount - 1; ++j)
+    {
+        p0 = _tpVec2ArrayAt(_vertices, j);
+        p1 = _tpVec2ArrayAt(_vertices, j + 1);
+        dir = tpVec2Sub(p1, p0);
+        tpVec2NormalizeSelf(&dir);
+        perp.x = dir.y * halfSw;
+        perp.y = -dir.x * halfSw;
+
+        le0 = tpVec2Add(p0, perp);
+        re0 = tpVec2Sub(p0, perp);
+        le1 = tpVec2Add(p1, perp);
+        re1 = tpVec2Sub(p1, perp);
+
+        /* check if this is the first segment / dash start */
+        if (j == _c->fillVertexOffset)
         {
-            p0 = _tpVec2ArrayAt(_vertices, j);
-            p1 = _tpVec2ArrayAt(_vertices, j + 1);
-            dir = tpVec2Sub(p1, p0);
-            tpVec2NormalizeSelf(&dir);
-            perp.x = dir.y * halfSw;
-            perp.y = -dir.x * halfSw;
-
-            le0 = tpVec2Add(p0, perp);
-            re0 = tpVec2Sub(p0, perp);
-            le1 = tpVec2Add(p1, perp);
-            re1 = tpVec2Sub(p1, perp);
-
-            /* check if this is the first segment / dash start */
-            if (j == c->fillVertexOffset)
+            if (!_c->bIsClosed)
             {
-                if (!c->bIsClosed)
-                {
-                    /* start cap? */
-                    firstDir = tpVec2MultScalar(dir, -1 * halfSw);
-                    firstPerp.x = firstDir.y;
-                    firstPerp.y = -firstDir.x;
-                    _tpGLMakeCap(_style->strokeCap, p0, firstDir, firstPerp, le0, re0, tpTrue, _vertices);
-                }
-                else if (j == c->fillVertexOffset)
-                {
-                    /*
-                    if the contour is closed, we cache the directions and edges
-                    to be used for the last segments stroke calculations
-                    */
-                    firstDir = dir;
-                    firstPerp = perp;
-                    firstLe = le0;
-                    firstRe = re0;
-                }
+                /* start cap? */
+                firstDir = tpVec2MultScalar(dir, -1 * halfSw);
+                firstPerp.x = firstDir.y;
+                firstPerp.y = -firstDir.x;
+                _tpGLMakeCap(_style->strokeCap, p0, firstDir, firstPerp, le0, re0, tpTrue, _levelOfDetail, _vertices);
+            }
+            else if (j == _c->fillVertexOffset)
+            {
+                /*
+                if the contour is closed, we cache the directions and edges
+                to be used for the last segments stroke calculations
+                */
+                firstDir = dir;
+                firstPerp = perp;
+                firstLe = le0;
+                firstRe = re0;
+            }
+        }
+        else
+        {
+            cross = tpVec2Cross(perp, perpPrev);
+            /* check if this is a joint */
+            if (_tpBoolArrayAt(_joints, j))
+            {
+                _tpGLMakeJoin(_style->strokeJoin, p0,
+                              dirPrev, dir,
+                              perpPrev, perp,
+                              lePrev, rePrev, le0, re0,
+                              cross, _style->miterLimit, _levelOfDetail, _vertices);
             }
             else
             {
-                cross = tpVec2Cross(perp, perpPrev);
-                /* check if this is a joint */
-                if (_tpBoolArrayAt(_joints, j))
-                {
-                    _tpGLMakeJoin(_style->strokeJoin, p0,
-                                  dirPrev, dir,
-                                  perpPrev, perp,
-                                  lePrev, rePrev, le0, re0,
-                                  cross, _style->miterLimit, _vertices);
-                }
-                else
-                {
-                    /* by default we join consecutive segment quads with a bevel */
-                    _tpGLMakeJoinBevel(lePrev, rePrev, le0, re0, cross, _vertices);
-                }
+                /* by default we join consecutive segment quads with a bevel */
+                _tpGLMakeJoinBevel(lePrev, rePrev, le0, re0, cross, _vertices);
             }
+        }
 
-            /* add the quad for the current segment */
-            _tpGLPushQuad(_vertices, le1, le0, re0, re1);
+        /* add the quad for the current segment */
+        _tpGLPushQuad(_vertices, le1, le0, re0, re1);
 
-            /* check if we need to do the end cap / join */
-            if (j == c->fillVertexOffset + c->fillVertexCount - 2 ||
-                    c->fillVertexCount == 2)
+        /* check if we need to do the end cap / join */
+        if (j == _c->fillVertexOffset + _c->fillVertexCount - 2 ||
+                _c->fillVertexCount == 2)
+        {
+            if (_tpBoolArrayAt(_joints, j + 1) && _c->bIsClosed)
             {
-                if (_tpBoolArrayAt(_joints, j + 1) && c->bIsClosed)
-                {
-                    /* last join */
-                    cross = tpVec2Cross(firstPerp, perp);
-                    _tpGLMakeJoin(_style->strokeJoin, p1, dir, firstDir,
-                                  perp, firstPerp,
-                                  le1, re1, firstLe, firstRe, cross,
-                                  _style->miterLimit, _vertices);
-                }
-                else
-                {
-                    /* end cap */
-                    firstDir = tpVec2MultScalar(dir, halfSw);
-                    _tpGLMakeCap(_style->strokeCap, p1, firstDir, perp, le1, re1, tpFalse, _vertices);
-                }
+                /* last join */
+                cross = tpVec2Cross(firstPerp, perp);
+                _tpGLMakeJoin(_style->strokeJoin, p1, dir, firstDir,
+                              perp, firstPerp,
+                              le1, re1, firstLe, firstRe, cross,
+                              _style->miterLimit, _levelOfDetail, _vertices);
+            }
+            else
+            {
+                /* end cap, remember where it starts so appended geometry can replace it */
+                _c->strokeCapOffset = _vertices->count;
+                firstDir = tpVec2MultScalar(dir, halfSw);
+                _tpGLMakeCap(_style->strokeCap, p1, firstDir, perp, le1, re1, tpFalse, _levelOfDetail, _vertices);
             }
-
-            perpPrev = perp;
-            dirPrev = dir;
-            lePrev = le1;
-            rePrev = re1;
         }
 
-        c->strokeVertexCount = _vertices->count - voff;
+        perpPrev = perp;
+        dirPrev = dir;
+        lePrev = le1;
+        rePrev = re1;
+    }
+}
+
+TARP_LOCAL void _tpGLContinousStrokeGeometry(_tpGLPath * _path, const tpStyle * _style, _tpVec2Array * _vertices, _tpBoolArray * _joints)
+{
+    int i;
+    _tpGLContour * c;
+
+    assert(_vertices->count == _joints->count);
+
+    /* generate the stroke geometry for each contour */
+    for (i = 0; i < _path->contours.count; ++i)
+    {
+        c = _tpGLContourArrayAtPtr(&_path->contours, i);
+        c->strokeVertexOffset = _vertices->count;
+        _tpGLContinousStrokeContour(c, _style, _path->quality.roundQuality, c->fillVertexOffset, _vertices, _joints);
+        c->strokeVertexCount = _vertices->count - c->strokeVertexOffset;
         _path->strokeVertexCount += c->strokeVertexCount;
     }
 }
@@ -2561,7 +5106,7 @@ TARP_LOCAL void _tpGLDashedStrokeGeometry(_tpGLPath * _path, const tpStyle * _st
                               dirPrev, dir,
                               perpPrev, perp,
                               lePrev, rePrev, le0, re0,
-                              cross, _style->miterLimit, _vertices);
+                              cross, _style->miterLimit, _path->quality.roundQuality, _vertices);
             }
 
             do
@@ -2589,7 +5134,7 @@ TARP_LOCAL void _tpGLDashedStrokeGeometry(_tpGLPath * _path, const tpStyle * _st
                         tmpDir = tpVec2MultScalar(dir, -1 * halfSw);
                         tmpPerp.x = tmpDir.y;
                         tmpPerp.y = -tmpDir.x;
-                        _tpGLMakeCap(_style->strokeCap, p0, tmpDir, tmpPerp, le0, re0, tpTrue, _vertices);
+                        _tpGLMakeCap(_style->strokeCap, p0, tmpDir, tmpPerp, le0, re0, tpTrue, _path->quality.roundQuality, _vertices);
                     }
                     /*
                     ...otherwise cache the initial values for the cap computation and mark that the contour
@@ -2626,7 +5171,7 @@ TARP_LOCAL void _tpGLDashedStrokeGeometry(_tpGLPath * _path, const tpStyle * _st
                         /* dont make cap if the first and last dash of the contour touch and the last dash is not finished. */
                         if (!bFirstDashMightNeedJoin || !bLastSegment || segmentLen - segmentOff > 0)
                         {
-                            _tpGLMakeCap(_style->strokeCap, p1, dir, perp, le1, re1, tpFalse, _vertices);
+                            _tpGLMakeCap(_style->strokeCap, p1, dir, perp, le1, re1, tpFalse, _path->quality.roundQuality, _vertices);
                         }
                         else
                         {
@@ -2654,7 +5199,7 @@ TARP_LOCAL void _tpGLDashedStrokeGeometry(_tpGLPath * _path, const tpStyle * _st
                         _tpGLMakeJoin(_style->strokeJoin, p1, dir, firstDir,
                                       perp, firstPerp,
                                       le1, re1, firstLe, firstRe, cross,
-                                      _style->miterLimit, _vertices);
+                                      _style->miterLimit, _path->quality.roundQuality, _vertices);
                     }
                     else
                     {
@@ -2663,13 +5208,13 @@ TARP_LOCAL void _tpGLDashedStrokeGeometry(_tpGLPath * _path, const tpStyle * _st
                         tmpDir = tpVec2MultScalar(firstDir, -1 * halfSw);
                         tmpPerp.x = tmpDir.y;
                         tmpPerp.y = -tmpDir.x;
-                        _tpGLMakeCap(_style->strokeCap, p1, tmpDir, tmpPerp, firstRe, firstLe, tpFalse, _vertices);
+                        _tpGLMakeCap(_style->strokeCap, p1, tmpDir, tmpPerp, firstRe, firstLe, tpFalse, _path->quality.roundQuality, _vertices);
 
                     }
                 }
                 else if (dashOffset > 0 && bOnDash)
                 {
-                    _tpGLMakeCap(_style->strokeCap, p1, dir, perp, le1, re1, tpFalse, _vertices);
+                    _tpGLMakeCap(_style->strokeCap, p1, dir, perp, le1, re1, tpFalse, _path->quality.roundQuality, _vertices);
                 }
             }
 
@@ -2690,6 +5235,9 @@ TARP_LOCAL void _tpGLDashedStrokeGeometry(_tpGLPath * _path, const tpStyle * _st
 TARP_LOCAL void _tpGLStroke(_tpGLPath * _path, const tpStyle * _style, _tpVec2Array * _vertices, _tpBoolArray * _joints)
 {
     _path->strokeVertexCount = 0;
+    _path->strokeVertexOffset = _vertices->count;
+    if (!_path->contours.count)
+        return;
 
     if (_style->dashCount)
     {
@@ -2710,7 +5258,9 @@ TARP_LOCAL void _tpGLStroke(_tpGLPath * _path, const tpStyle * _style, _tpVec2Ar
     _path->lastStroke.dashCount = _style->dashCount;
     _path->lastStroke.join = _style->strokeJoin;
     _path->lastStroke.cap = _style->strokeCap;
+    _path->lastStroke.miterLimit = _style->miterLimit;
     _path->lastStroke.scaleStroke = _style->scaleStroke;
+    _path->lastStroke.roundQuality = _path->quality.roundQuality;
 }
 
 TARP_LOCAL void _tpGLFlattenCurve(_tpGLPath * _path,
@@ -2722,13 +5272,20 @@ TARP_LOCAL void _tpGLFlattenCurve(_tpGLPath * _path,
                                   _tpVec2Array * _outVertices,
                                   _tpBoolArray * _outJoints,
                                   _tpGLRect * _bounds,
-                                  int * _vertexCount)
+                                  int * _vertexCount,
+                                  _tpFloatArray * _outParameters)
 {
     _tpGLCurve stack[TARP_MAX_CURVE_SUBDIVISIONS];
+    /* the parameter range of each curve on the stack, only needed if _outParameters is not NULL */
+    tpFloat stackFrom[TARP_MAX_CURVE_SUBDIVISIONS];
+    tpFloat stackTo[TARP_MAX_CURVE_SUBDIVISIONS];
     _tpGLCurvePair cp;
     _tpGLCurve * current;
     int stackIndex = 0;
+    int start = _outVertices->count;
     stack[0] = *_curve;
+    stackFrom[0] = 0;
+    stackTo[0] = 1;
 
     while (stackIndex >= 0)
     {
@@ -2743,9 +5300,19 @@ TARP_LOCAL void _tpGLFlattenCurve(_tpGLPath * _path,
             _tpGLSubdivideCurve(current, 0.5, &cp);
             *current = cp.second;
             stack[++stackIndex] = cp.first;
+            stackTo[stackIndex] = (stackFrom[stackIndex - 1] + stackTo[stackIndex - 1]) * 0.5f;
+            stackFrom[stackIndex] = stackFrom[stackIndex - 1];
+            stackFrom[stackIndex - 1] = stackTo[stackIndex];
         }
         else
         {
+            if (_outParameters)
+            {
+                if (_bFirstCurve)
+                    _tpFloatArrayAppend(_outParameters, stackFrom[stackIndex]);
+                _tpFloatArrayAppend(_outParameters, stackTo[stackIndex]);
+            }
+
             /* for the first curve we also add its first segment */
             if (_bFirstCurve)
             {
@@ -2754,8 +5321,6 @@ TARP_LOCAL void _tpGLFlattenCurve(_tpGLPath * _path,
 
                 _tpBoolArrayAppend(_outJoints, tpFalse);
                 _tpBoolArrayAppend(_outJoints, (tpBool)(tpVec2Equals(current->p1, _curve->p1) && !_bLastCurve));
-                _tpGLEvaluatePointForBounds(current->p0, _bounds);
-                _tpGLEvaluatePointForBounds(current->p1, _bounds);
                 *_vertexCount += 2;
 
                 /* we don't want to do this for the following subdivisions */
@@ -2767,12 +5332,64 @@ TARP_LOCAL void _tpGLFlattenCurve(_tpGLPath * _path,
 
                 _tpBoolArrayAppend(_outJoints, (tpBool)(_bIsClosed ? tpVec2Equals(current->p1, _curve->p1) :
                                                         (tpVec2Equals(current->p1, _curve->p1) && !_bLastCurve)));
-                _tpGLEvaluatePointForBounds(current->p1, _bounds);
                 (*_vertexCount)++;
             }
             stackIndex--;
         }
     }
+
+    /* the bounds of all new vertices are merged in one go */
+    _tpGLEvaluatePointsForBounds(_outVertices->array + start, _outVertices->count - start, _bounds);
+}
+
+/*
+evaluates a curve at the parameters _tpGLFlattenCurve recorded for it (see tpPathSetFrozenTopology). The
+Bernstein weights of all parameters are computed in one branchless loop, which compilers vectorize.
+*/
+TARP_LOCAL void _tpGLEvaluateCurve(const _tpGLCurve * _curve,
+                                   const tpFloat * _parameters,
+                                   int _count,
+                                   _tpVec2Array * _outVertices,
+                                   _tpBoolArray * _outJoints,
+                                   _tpGLRect * _bounds,
+                                   int * _vertexCount)
+{
+    int i;
+    tpFloat t, mt, b0, b1, b2, b3;
+    tpVec2 * vertices;
+    tpBool * joints;
+
+    if (_count <= 0)
+        return;
+    if (_outVertices->capacity - _outVertices->count < _count &&
+            _tpVec2ArrayReserve(_outVertices, TARP_MAX(_outVertices->capacity * 2, _outVertices->count + _count)))
+        return;
+    if (_outJoints->capacity - _outJoints->count < _count &&
+            _tpBoolArrayReserve(_outJoints, TARP_MAX(_outJoints->capacity * 2, _outJoints->count + _count)))
+        return;
+
+    vertices = _outVertices->array + _outVertices->count;
+    for (i = 0; i < _count; ++i)
+    {
+        t = _parameters[i];
+        mt = 1.0f - t;
+        b0 = mt * mt * mt;
+        b1 = 3.0f * mt * mt * t;
+        b2 = 3.0f * mt * t * t;
+        b3 = t * t * t;
+        vertices[i].x = b0 * _curve->p0.x + b1 * _curve->h0.x + b2 * _curve->h1.x + b3 * _curve->p1.x;
+        vertices[i].y = b0 * _curve->p0.y + b1 * _curve->h0.y + b2 * _curve->h1.y + b3 * _curve->p1.y;
+    }
+
+    /* same as _tpGLFlattenCurve, the end of each curve is a joint */
+    joints = _outJoints->array + _outJoints->count;
+    for (i = 0; i < _count; ++i)
+        joints[i] = (tpBool)(_parameters[i] == 1.0f);
+    _tpGLEvaluatePointsForBounds(vertices, _count, _bounds);
+
+    _outVertices->count += _count;
+    _outJoints->count += _count;
+    *_vertexCount += _count;
 }
 
 TARP_LOCAL void _tpGLInitBounds(_tpGLRect * _bounds)
@@ -2789,24 +5406,195 @@ TARP_LOCAL void _tpGLMergeBounds(_tpGLRect * _a, const _tpGLRect * _b)
     _tpGLEvaluatePointForBounds(_b->max, _a);
 }
 
-TARP_LOCAL int _tpGLFlattenPath(_tpGLPath * _path,
-                                tpFloat _angleTolerance,
-                                const tpTransform * _transform,
-                                _tpVec2Array * _outVertices,
-                                _tpBoolArray * _outJoints,
-                                _tpGLRect * _outBounds)
+/*
+Douglas-Peucker simplification of _count flattened vertices (and their joint flags) in place.
+The first and last vertex are always kept. Returns the new vertex count.
+*/
+TARP_LOCAL int _tpGLSimplifyVertices(tpVec2 * _vertices, tpBool * _joints, int _count, tpFloat _tolerance)
+{
+    int stack[TARP_MAX_SIMPLIFY_DEPTH * 2];
+    int stackIndex, a, b, i, maxIndex, out;
+    tpFloat tolSq, maxDistSq, distSq, lenSq, t;
+    tpVec2 ab, ap, d;
+
+    if (_count < 3)
+        return _count;
+
+    tolSq = _tolerance * _tolerance;
+    out = 1;
+    stack[0] = 0;
+    stack[1] = _count - 1;
+    stackIndex = 0;
+
+    /*
+    the ranges are processed from left to right, so the kept vertices can be written to the
+    front of the array without overwriting anything that is still needed.
+    */
+    while (stackIndex >= 0)
+    {
+        a = stack[stackIndex * 2];
+        b = stack[stackIndex * 2 + 1];
+        stackIndex--;
+
+        /* find the vertex furthest away from the segment a -> b */
+        ab = tpVec2Sub(_vertices[b], _vertices[a]);
+        lenSq = tpVec2Dot(ab, ab);
+        maxDistSq = 0;
+        maxIndex = -1;
+        for (i = a + 1; i < b; ++i)
+        {
+            ap = tpVec2Sub(_vertices[i], _vertices[a]);
+            t = lenSq > 0 ? TARP_CLAMP(tpVec2Dot(ap, ab) / lenSq, 0.0f, 1.0f) : 0.0f;
+            d = tpVec2Sub(ap, tpVec2MultScalar(ab, t));
+            distSq = tpVec2Dot(d, d);
+            if (distSq > maxDistSq)
+            {
+                maxDistSq = distSq;
+                maxIndex = i;
+            }
+        }
+
+        if (maxDistSq > tolSq)
+        {
+            if (stackIndex + 2 < TARP_MAX_SIMPLIFY_DEPTH)
+            {
+                stack[(stackIndex + 1) * 2] = maxIndex;
+                stack[(stackIndex + 1) * 2 + 1] = b;
+                stack[(stackIndex + 2) * 2] = a;
+                stack[(stackIndex + 2) * 2 + 1] = maxIndex;
+                stackIndex += 2;
+                continue;
+            }
+
+            /* we ran out of stack, keep the whole range */
+            for (i = a + 1; i < b; ++i, ++out)
+            {
+                _vertices[out] = _vertices[i];
+                _joints[out] = _joints[i];
+            }
+        }
+
+        _vertices[out] = _vertices[b];
+        _joints[out] = _joints[b];
+        ++out;
+    }
+
+    return out;
+}
+
+/*
+returns the segments _from to _to of a contour. If _transform is not NULL, they are transformed in one go
+into the scratch array of the path, which stays valid until the next call. Returns NULL if the scratch
+array can't be allocated.
+*/
+TARP_LOCAL tpSegment * _tpGLPathTransformedSegments(_tpGLPath * _path, _tpGLContour * _c, int _from, int _to,
+        const tpTransform * _transform)
+{
+    int count = _to - _from;
+    if (!_transform || count <= 0)
+        return _tpGLSegmentBufferData(&_c->segments) + _from;
+
+    if (_path->transformedSegments.capacity < count &&
+            _tpSegmentArrayReserve(&_path->transformedSegments, TARP_MAX(count, _path->transformedSegments.capacity * 2)))
+    {
+        _tpGLSetErrorMessage("Could not allocate memory for the transformed segments.");
+        return NULL;
+    }
+
+    /* a segment is three tightly packed tpVec2 */
+    tpTransformApplyArray(_transform, (const tpVec2 *)(_tpGLSegmentBufferData(&_c->segments) + _from),
+                          (tpVec2 *)_path->transformedSegments.array, count * 3);
+    _path->transformedSegments.count = count;
+    return _path->transformedSegments.array;
+}
+
+/*
+polylines don't need any subdivision, so we simply copy (and potentially transform) their points.
+Consecutive duplicates are skipped as they would produce degenerate stroke geometry. Returns the number
+of vertices added or -1 if the output arrays can't be allocated.
+*/
+TARP_LOCAL int _tpGLFlattenPolyline(_tpGLContour * _c,
+                                    const tpTransform * _transform,
+                                    _tpVec2Array * _outVertices,
+                                    _tpBoolArray * _outJoints,
+                                    _tpGLRect * _bounds)
+{
+    int i, vcount;
+    const tpVec2 * src;
+    tpVec2 * dst;
+    tpBool * joints;
+
+    if (!_c->points.count)
+        return 0;
+
+    /* make sure there is enough room for all points and the closing point */
+    if ((_outVertices->capacity < _outVertices->count + _c->points.count + 1 &&
+            _tpVec2ArrayReserve(_outVertices, (_outVertices->count + _c->points.count + 1) * 2)) ||
+            (_outJoints->capacity < _outJoints->count + _c->points.count + 1 &&
+             _tpBoolArrayReserve(_outJoints, (_outJoints->count + _c->points.count + 1) * 2)))
+    {
+        _tpGLSetErrorMessage("Could not allocate memory for the flattened polyline.");
+        return -1;
+    }
+
+    src = _c->points.array;
+    dst = _outVertices->array + _outVertices->count;
+    joints = _outJoints->array + _outJoints->count;
+
+    /* transform all points in one go, the duplicates are then removed in place */
+    if (_transform)
+    {
+        tpTransformApplyArray(_transform, src, dst, _c->points.count);
+        src = dst;
+    }
+
+    vcount = 0;
+    for (i = 0; i < _c->points.count; ++i)
+    {
+        if (vcount && tpVec2Equals(src[i], dst[vcount - 1]))
+            continue;
+
+        dst[vcount] = src[i];
+        joints[vcount] = (tpBool)(vcount > 0);
+        ++vcount;
+    }
+    _tpGLEvaluatePointsForBounds(dst, vcount, _bounds);
+
+    /* add the closing line */
+    if (_c->bIsClosed && vcount > 1 && tpVec2Distance(dst[0], dst[vcount - 1]) > FLT_EPSILON)
+    {
+        dst[vcount] = dst[0];
+        joints[vcount] = tpTrue;
+        ++vcount;
+    }
+
+    _outVertices->count += vcount;
+    _outJoints->count += vcount;
+    return vcount;
+}
+
+TARP_LOCAL tpBool _tpGLFlattenPath(_tpGLPath * _path,
+                                   tpFloat _angleTolerance,
+                                   tpFloat _simplifyTolerance,
+                                   const tpTransform * _transform,
+                                   _tpVec2Array * _outVertices,
+                                   _tpBoolArray * _outJoints,
+                                   _tpGLRect * _outBounds)
 {
     /* @TODO: clean up dis mess */
     _tpGLRect contourBounds;
     int i = 0;
     int j = 0;
-    int vcount;
+    int vcount, start;
     int off = 0;
     _tpGLContour * c = NULL;
     tpSegment * last = NULL, *current = NULL;
     /* int recursionDepth = 0; */
     _tpGLCurve curve;
-    tpVec2 lastTransformedPos;
+    tpSegment * segments;
+    tpBool bEvaluate;
+    int curveStart, parameterOffset;
+    _tpFloatArray * parameters;
 
     _tpGLInitBounds(_outBounds);
 
@@ -2815,74 +5603,129 @@ TARP_LOCAL int _tpGLFlattenPath(_tpGLPath * _path,
         c = _tpGLContourArrayAtPtr(&_path->contours, i);
         _tpGLInitBounds(&contourBounds);
 
-        if (c->bDirty)
+        /* a contour that had segments appended is treated as dirty, too */
+        if (c->bDirty || c->flattenedSegmentCount != _tpGLContourSegmentCount(c))
         {
             /* if the contour is dirty, flatten it */
             c->bDirty = tpFalse;
-            last = _tpSegmentArrayAtPtr(&c->segments, 0);
-
-            vcount = 0;
-            for (j = 1; j < c->segments.count; ++j)
+            c->flattenedSegmentCount = _tpGLContourSegmentCount(c);
+            start = _outVertices->count;
+            if (c->bIsPolyline)
             {
-                current = _tpSegmentArrayAtPtr(&c->segments, j);
-
-                curve.p0 = tpVec2Make(last->position.x, last->position.y);
-                curve.h0 = tpVec2Make(last->handleOut.x, last->handleOut.y);
-                curve.h1 = tpVec2Make(current->handleIn.x, current->handleIn.y);
-                curve.p1 = tpVec2Make(current->position.x, current->position.y);
+                vcount = _tpGLFlattenPolyline(c, _transform, _outVertices, _outJoints, &contourBounds);
+                if (vcount < 0)
+                {
+                    /* flatten it again next time */
+                    c->bDirty = tpTrue;
+                    return tpTrue;
+                }
+            }
+            else
+            {
+                /*
+                a frozen contour with the same curves and tolerance is only evaluated at the recorded
+                parameters, otherwise they are recorded while flattening (see tpPathSetFrozenTopology).
+                */
+                bEvaluate = (tpBool)(_path->bFrozenTopology && c->frozenTolerance == _angleTolerance && c->segments.count > 1 &&
+                                     c->bFrozenClosed == c->bIsClosed &&
+                                     (c->frozenCurveCounts.count == c->segments.count - 1 ||
+                                      (c->bIsClosed && c->frozenCurveCounts.count == c->segments.count)));
+                parameters = NULL;
+                if (_path->bFrozenTopology && !bEvaluate)
+                {
+                    _tpFloatArrayClear(&c->frozenParameters);
+                    _tpIntArrayClear(&c->frozenCurveCounts);
+                    c->frozenTolerance = _angleTolerance;
+                    c->bFrozenClosed = c->bIsClosed;
+                    parameters = &c->frozenParameters;
+                }
+                parameterOffset = 0;
 
-                if (_transform)
+                segments = _tpGLPathTransformedSegments(_path, c, 0, c->segments.count, _transform);
+                if (!segments)
                 {
-                    curve.p0 = j > 1 ? lastTransformedPos : tpTransformApply(_transform, curve.p0);
-                    curve.h0 = tpTransformApply(_transform, curve.h0);
-                    curve.h1 = tpTransformApply(_transform, curve.h1);
-                    curve.p1 = tpTransformApply(_transform, curve.p1);
-                    lastTransformedPos = curve.p1;
+                    /* flatten it again next time */
+                    c->bDirty = tpTrue;
+                    return tpTrue;
                 }
+                last = &segments[0];
 
-                _tpGLFlattenCurve(_path,
-                                  &curve,
-                                  _angleTolerance,
-                                  c->bIsClosed,
-                                  j == 1,
-                                  tpFalse,
-                                  _outVertices,
-                                  _outJoints,
-                                  &contourBounds, &vcount);
-
-                last = current;
-            }
+                vcount = 0;
+                for (j = 1; j < c->segments.count; ++j)
+                {
+                    current = &segments[j];
 
-            /* if the contour is closed, flatten the last closing curve */
-            if (c->bIsClosed && c->segments.count &&
-                    tpVec2Distance(_tpSegmentArrayAtPtr(&c->segments, 0)->position,
-                                   _tpSegmentArrayAtPtr(&c->segments, c->segments.count - 1)->position) > FLT_EPSILON)
-            {
-                tpSegment * fs = _tpSegmentArrayAtPtr(&c->segments, 0);
+                    curve.p0 = last->position;
+                    curve.h0 = last->handleOut;
+                    curve.h1 = current->handleIn;
+                    curve.p1 = current->position;
+
+                    curveStart = vcount;
+                    if (bEvaluate)
+                    {
+                        _tpGLEvaluateCurve(&curve, c->frozenParameters.array + parameterOffset, c->frozenCurveCounts.array[j - 1],
+                                           _outVertices, _outJoints, &contourBounds, &vcount);
+                        parameterOffset += c->frozenCurveCounts.array[j - 1];
+                    }
+                    else
+                    {
+                        _tpGLFlattenCurve(_path,
+                                          &curve,
+                                          _angleTolerance,
+                                          c->bIsClosed,
+                                          j == 1,
+                                          tpFalse,
+                                          _outVertices,
+                                          _outJoints,
+                                          &contourBounds, &vcount, parameters);
+                        if (parameters)
+                            _tpIntArrayAppend(&c->frozenCurveCounts, vcount - curveStart);
+                    }
 
-                curve.p0 = tpVec2Make(last->position.x, last->position.y);
-                curve.h0 = tpVec2Make(last->handleOut.x, last->handleOut.y);
-                curve.h1 = tpVec2Make(fs->handleIn.x, fs->handleIn.y);
-                curve.p1 = tpVec2Make(fs->position.x, fs->position.y);
+                    last = current;
+                }
 
-                if (_transform)
+                /* if the contour is closed, flatten the last closing curve */
+                if (bEvaluate ? c->frozenCurveCounts.count == c->segments.count :
+                        (c->bIsClosed && c->segments.count &&
+                         tpVec2Distance(segments[0].position, segments[c->segments.count - 1].position) > FLT_EPSILON))
                 {
-                    /* @TODO: are there cases were lastTransformedPos can still be uninitialized?!?! */
-                    curve.p0 = lastTransformedPos;
-                    curve.h0 = tpTransformApply(_transform, curve.h0);
-                    curve.h1 = tpTransformApply(_transform, curve.h1);
-                    curve.p1 = tpTransformApply(_transform, curve.p1);
+                    tpSegment * fs = &segments[0];
+
+                    curve.p0 = last->position;
+                    curve.h0 = last->handleOut;
+                    curve.h1 = fs->handleIn;
+                    curve.p1 = fs->position;
+
+                    curveStart = vcount;
+                    if (bEvaluate)
+                    {
+                        _tpGLEvaluateCurve(&curve, c->frozenParameters.array + parameterOffset, c->frozenCurveCounts.array[j - 1],
+                                           _outVertices, _outJoints, &contourBounds, &vcount);
+                    }
+                    else
+                    {
+                        _tpGLFlattenCurve(_path,
+                                          &curve,
+                                          _angleTolerance,
+                                          c->bIsClosed,
+                                          tpFalse,
+                                          tpTrue,
+                                          _outVertices,
+                                          _outJoints,
+                                          &contourBounds, &vcount, parameters);
+                        if (parameters)
+                            _tpIntArrayAppend(&c->frozenCurveCounts, vcount - curveStart);
+                    }
                 }
+            }
 
-                _tpGLFlattenCurve(_path,
-                                  &curve,
-                                  _angleTolerance,
-                                  c->bIsClosed,
-                                  tpFalse,
-                                  tpTrue,
-                                  _outVertices,
-                                  _outJoints,
-                                  &contourBounds, &vcount);
+            if (_simplifyTolerance > 0 && vcount > 2 && !_path->bFrozenTopology)
+            {
+                j = _tpGLSimplifyVertices(_outVertices->array + start, _outJoints->array + start, vcount, _simplifyTolerance);
+                _outVertices->count -= vcount - j;
+                _outJoints->count -= vcount - j;
+                vcount = j;
             }
 
             c->fillVertexOffset = off;
@@ -2894,10 +5737,13 @@ TARP_LOCAL int _tpGLFlattenPath(_tpGLPath * _path,
         }
         else
         {
-            c->fillVertexOffset = off;
             /* otherwise we just copy the contour to the tmpbuffer... */
-            _tpVec2ArrayAppendArray(_outVertices, _tpVec2ArrayAtPtr(&_path->geometryCache, c->fillVertexOffset), c->fillVertexCount);
-            _tpBoolArrayAppendArray(_outJoints, _tpBoolArrayAtPtr(&_path->jointCache, c->fillVertexOffset), c->fillVertexCount);
+            if (c->fillVertexCount)
+            {
+                _tpVec2ArrayAppendArray(_outVertices, _tpVec2ArrayAtPtr(&_path->geometryCache, c->fillVertexOffset), c->fillVertexCount);
+                _tpBoolArrayAppendArray(_outJoints, _tpBoolArrayAtPtr(&_path->jointCache, c->fillVertexOffset), c->fillVertexCount);
+            }
+            c->fillVertexOffset = off;
 
             /* ...and merge the cached contour bounds with the path bounds */
             _tpGLMergeBounds(_outBounds, &c->bounds);
@@ -2905,7 +5751,7 @@ TARP_LOCAL int _tpGLFlattenPath(_tpGLPath * _path,
         }
     }
 
-    return 0;
+    return tpFalse;
 }
 
 TARP_LOCAL int _tpGLColorStopComp(const void * _a, const void * _b)
@@ -2983,13 +5829,16 @@ TARP_LOCAL void _tpGLFinalizeColorStops(_tpGLContext * _ctx, _tpGLGradient * _gr
     }
 }
 
-TARP_LOCAL void _tpGLUpdateRampTexture(_tpGLGradient * _grad)
+/* interpolates the (finalized) color stops of a gradient into the TARP_GL_RAMP_TEXTURE_SIZE pixels of its ramp */
+TARP_LOCAL void _tpGLGenerateRamp(const _tpGLGradient * _grad, tpColor * _outPixels)
 {
-    tpColor pixels[TARP_GL_RAMP_TEXTURE_SIZE] = {0};
     int xStart, xEnd, diff, i, j;
     tpFloat mixFact;
     tpColor mixColor;
     tpColorStop * stop1, * stop2;
+    tpColor * pixels = _outPixels;
+
+    memset(pixels, 0, sizeof(tpColor) * TARP_GL_RAMP_TEXTURE_SIZE);
 
     /* generate the ramp texture */
     xStart = 0;
@@ -2997,12 +5846,12 @@ TARP_LOCAL void _tpGLUpdateRampTexture(_tpGLGradient * _grad)
 
     if (_grad->stops.count)
     {
-        stop1 = _tpColorStopArrayAtPtr(&_grad->stops, 0);
+        stop1 = &_grad->stops.array[0];
         pixels[0] = stop1->color;
 
         for (i = 1; i < _grad->stops.count; ++i)
         {
-            stop2 = _tpColorStopArrayAtPtr(&_grad->stops, i);
+            stop2 = &_grad->stops.array[i];
             xEnd = (int)(stop2->offset * (TARP_GL_RAMP_TEXTURE_SIZE - 1));
 
             assert(xStart >= 0 && xStart < TARP_GL_RAMP_TEXTURE_SIZE &&
@@ -3027,12 +5876,125 @@ TARP_LOCAL void _tpGLUpdateRampTexture(_tpGLGradient * _grad)
             xStart = xEnd;
         }
     }
+}
+
+typedef struct TARP_LOCAL
+{
+    _tpGLGradient ** gradients;
+    tpColor * pixels;
+} _tpGLRampJobData;
+
+/* generates the ramp of one gradient of a batch, see tpContextOptions.parallelFor */
+TARP_LOCAL void _tpGLRampJob(void * _jobData, int _index)
+{
+    _tpGLRampJobData * job = (_tpGLRampJobData *)_jobData;
+    _tpGLGenerateRamp(job->gradients[_index], job->pixels + _index * TARP_GL_RAMP_TEXTURE_SIZE);
+}
+
+/*
+regenerates the ramp textures of all gradients whose color stops changed. The ramps are written to a
+pixel buffer in one go and each texture is then updated from its part of the buffer, which keeps
+the texture uploads out of the stencil work of the individual draws. The pixel buffer binding and
+unpack alignment of the application are restored afterwards.
+*/
+TARP_LOCAL void _tpGLUploadDirtyRamps(_tpGLContext * _ctx)
+{
+    int i, count;
+    _tpGLGradient * grad;
+    _tpGLRampJobData job;
+    GLboolean bUnmapped;
+    GLint previousPbo, previousAlignment;
+    tpColor pixels[TARP_GL_RAMP_TEXTURE_SIZE];
+    const char * pass = _ctx->debugPass;
+
+    /* the color stops are finalized on this thread as they share the context's scratch array */
+    _tpGLGradientPtrArrayClear(&_ctx->tmpRamps);
+    while (__g_dirtyRamps)
+    {
+        grad = __g_dirtyRamps;
+        _tpGLGradientUnlinkDirtyRamp(grad);
+        _tpGLFinalizeColorStops(_ctx, grad);
+        if (_tpGLGradientPtrArrayAppend(&_ctx->tmpRamps, grad))
+        {
+            _tpGLGradientMarkRampDirty(grad);
+            break;
+        }
+    }
+
+    count = _ctx->tmpRamps.count;
+    if (!count)
+        return;
+
+    _ctx->debugPass = "gradient ramps";
+    _ctx->debugObject = NULL;
+
+    _TARP_ASSERT_NO_GL_ERROR(glGetIntegerv(GL_PIXEL_UNPACK_BUFFER_BINDING, &previousPbo));
+    _TARP_ASSERT_NO_GL_ERROR(glGetIntegerv(GL_UNPACK_ALIGNMENT, &previousAlignment));
+
+    if (!_ctx->rampPbo)
+    {
+        _TARP_ASSERT_NO_GL_ERROR(glGenBuffers(1, &_ctx->rampPbo));
+        _TARP_ASSERT_NO_GL_ERROR(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _ctx->rampPbo));
+        _tpGLObjectLabel(GL_BUFFER, _ctx->rampPbo, "tarp gradient ramp upload", NULL);
+    }
+    else
+    {
+        _TARP_ASSERT_NO_GL_ERROR(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _ctx->rampPbo));
+    }
+
+    /* orphan the buffer so that the driver can still read the previous batch */
+    _TARP_ASSERT_NO_GL_ERROR(glBufferData(GL_PIXEL_UNPACK_BUFFER, sizeof(tpColor) * TARP_GL_RAMP_TEXTURE_SIZE * count,
+                                          NULL, GL_STREAM_DRAW));
+    _TARP_ASSERT_NO_GL_ERROR(job.pixels = (tpColor *)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0,
+                                          sizeof(tpColor) * TARP_GL_RAMP_TEXTURE_SIZE * count,
+                                          GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+    bUnmapped = GL_FALSE;
+    if (job.pixels)
+    {
+        job.gradients = _ctx->tmpRamps.array;
+        if (_ctx->parallelFor)
+        {
+            _ctx->parallelFor(_ctx->parallelForUserData, count, _tpGLRampJob, &job);
+        }
+        else
+        {
+            for (i = 0; i < count; ++i)
+                _tpGLRampJob(&job, i);
+        }
+        _TARP_ASSERT_NO_GL_ERROR(bUnmapped = glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER));
+    }
 
     _TARP_ASSERT_NO_GL_ERROR(glActiveTexture(GL_TEXTURE0));
-    _TARP_ASSERT_NO_GL_ERROR(glBindTexture(GL_TEXTURE_1D, _grad->rampTexture));
     _TARP_ASSERT_NO_GL_ERROR(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
-    _TARP_ASSERT_NO_GL_ERROR(glTexSubImage1D(GL_TEXTURE_1D, 0, 0, TARP_GL_RAMP_TEXTURE_SIZE,
-                             GL_RGBA, GL_FLOAT, &pixels[0].r));
+    if (bUnmapped)
+    {
+        /* with a pixel buffer bound, the data pointer is an offset into it */
+        for (i = 0; i < count; ++i)
+        {
+            _TARP_ASSERT_NO_GL_ERROR(glBindTexture(GL_TEXTURE_1D, _ctx->tmpRamps.array[i]->rampTexture));
+            _tpGLObjectLabel(GL_TEXTURE, _ctx->tmpRamps.array[i]->rampTexture, "tarp gradient ramp", _ctx->tmpRamps.array[i]);
+            _TARP_ASSERT_NO_GL_ERROR(glTexSubImage1D(GL_TEXTURE_1D, 0, 0, TARP_GL_RAMP_TEXTURE_SIZE, GL_RGBA, GL_FLOAT,
+                                     (const void *)(sizeof(tpColor) * TARP_GL_RAMP_TEXTURE_SIZE * i)));
+        }
+    }
+    else
+    {
+        /* the buffer could not be mapped (or its contents got lost), upload the ramps one by one */
+        _TARP_ASSERT_NO_GL_ERROR(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+        for (i = 0; i < count; ++i)
+        {
+            _tpGLGenerateRamp(_ctx->tmpRamps.array[i], pixels);
+            _TARP_ASSERT_NO_GL_ERROR(glBindTexture(GL_TEXTURE_1D, _ctx->tmpRamps.array[i]->rampTexture));
+            _tpGLObjectLabel(GL_TEXTURE, _ctx->tmpRamps.array[i]->rampTexture, "tarp gradient ramp", _ctx->tmpRamps.array[i]);
+            _TARP_ASSERT_NO_GL_ERROR(glTexSubImage1D(GL_TEXTURE_1D, 0, 0, TARP_GL_RAMP_TEXTURE_SIZE,
+                                     GL_RGBA, GL_FLOAT, &pixels[0].r));
+        }
+    }
+
+    _TARP_ASSERT_NO_GL_ERROR(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, (GLuint)previousPbo));
+    _TARP_ASSERT_NO_GL_ERROR(glPixelStorei(GL_UNPACK_ALIGNMENT, previousAlignment));
+
+    _ctx->debugPass = pass;
 }
 
 TARP_LOCAL void _tpGLUpdateVAO(_tpGLVAO * _vao, void * _data, int _byteCount)
@@ -3050,54 +6012,293 @@ TARP_LOCAL void _tpGLUpdateVAO(_tpGLVAO * _vao, void * _data, int _byteCount)
     }
 }
 
-TARP_LOCAL void _tpGLDrawPaint(_tpGLContext * _ctx, _tpGLPath * _path,
-                               const tpPaint * _paint, const _tpGLGradientCacheData * _gradCache)
+/*
+uploads a transform projection matrix. With a depth test, the z row is replaced so that every vertex
+ends up at the depth of the current draw, regardless of w.
+*/
+TARP_LOCAL void _tpGLUploadMatrix(_tpGLContext * _ctx, GLint _location, const tpMat4 * _matrix)
+{
+    tpMat4 m;
+    if (!_ctx->bDepthTest)
+    {
+        _TARP_ASSERT_NO_GL_ERROR(glUniformMatrix4fv(_location, 1, GL_FALSE, &_matrix->v[0]));
+        return;
+    }
+    m = *_matrix;
+    m.v[2] = m.v[3] * _ctx->depth;
+    m.v[6] = m.v[7] * _ctx->depth;
+    m.v[10] = m.v[11] * _ctx->depth;
+    m.v[14] = m.v[15] * _ctx->depth;
+    _TARP_ASSERT_NO_GL_ERROR(glUniformMatrix4fv(_location, 1, GL_FALSE, &m.v[0]));
+}
+
+/* draws the quads covering a path, which are the bounds or the cover quads of a sparse path */
+TARP_LOCAL void _tpGLDrawCover(_tpGLPath * _path)
+{
+    if (_path->coverVertexCount)
+        _TARP_ASSERT_NO_GL_ERROR(glDrawArrays(GL_TRIANGLES, _path->boundsVertexOffset + 4, _path->coverVertexCount));
+    else
+        _TARP_ASSERT_NO_GL_ERROR(glDrawArrays(GL_TRIANGLE_STRIP, _path->boundsVertexOffset, 4));
+}
+
+/*
+covers a path with a paint. _mvp is the matrix the geometry of the path is drawn with and _vertexPaintTransform
+maps the paint space to the space of its vertices, which is the window for non scaling strokes.
+*/
+TARP_LOCAL void _tpGLDrawPaint(_tpGLContext * _ctx, _tpGLPath * _path, const tpPaint * _paint,
+                               const _tpGLGradientCacheData * _gradCache, const tpTransform * _vertexPaintTransform,
+                               const tpMat4 * _mvp, const tpMat4 * _transformProjection)
 {
+    /* opaque covers write their depth so that anything below them is rejected early */
+    if (_ctx->bDepthTest && _ctx->bDepthWrite)
+        _TARP_ASSERT_NO_GL_ERROR(glDepthMask(GL_TRUE));
+
     if (_paint->type == kTpPaintTypeColor)
     {
         /* @TODO: Cache the uniform loc */
         _TARP_ASSERT_NO_GL_ERROR(glUniform4fv(_ctx->meshColorLoc, 1, &_paint->data.color.r));
-        _TARP_ASSERT_NO_GL_ERROR(glDrawArrays(GL_TRIANGLE_STRIP, _path->boundsVertexOffset, 4));
+        _tpGLDrawCover(_path);
     }
     else if (_paint->type == kTpPaintTypeGradient)
     {
         _tpGLGradient * grad = (_tpGLGradient *)_paint->data.gradient.pointer;
 
+        /* the first gradient drawn after any color stops changed uploads all of their ramps */
+        if (__g_dirtyRamps)
+            _tpGLUploadDirtyRamps(_ctx);
+
         /* bind the gradient's texture */
         _TARP_ASSERT_NO_GL_ERROR(glActiveTexture(GL_TEXTURE0));
         _TARP_ASSERT_NO_GL_ERROR(glBindTexture(GL_TEXTURE_1D, grad->rampTexture));
 
         _TARP_ASSERT_NO_GL_ERROR(glUseProgram(_ctx->textureProgram));
-        _TARP_ASSERT_NO_GL_ERROR(glUniformMatrix4fv(_ctx->tpTextureLoc, 1, GL_FALSE, &_ctx->transformProjection.v[0]));
+        _tpGLUploadMatrix(_ctx, _ctx->tpTextureLoc, _transformProjection);
         _TARP_ASSERT_NO_GL_ERROR(glBindVertexArray(_ctx->textureVao.vao));
-        _TARP_ASSERT_NO_GL_ERROR(glDrawArrays(GL_TRIANGLE_FAN, _gradCache->vertexOffset, _gradCache->vertexCount));
+        _TARP_ASSERT_NO_GL_ERROR(glDrawArrays(_gradCache->primitive, _gradCache->vertexOffset, _gradCache->vertexCount));
         _TARP_ASSERT_NO_GL_ERROR(glUseProgram(_ctx->program));
         _TARP_ASSERT_NO_GL_ERROR(glBindVertexArray(_ctx->vao.vao));
     }
+    else if (_paint->type == kTpPaintTypePattern)
+    {
+        /* the tile was rendered by _tpGLPreparePattern, the bounds are mapped from vertex space to tiles */
+        _tpGLLayer * tile = (_tpGLLayer *)_paint->data.pattern.pointer;
+        tpTransform inv = tpTransformInvert(_vertexPaintTransform);
+        tpFloat w = tile->bounds.max.x - tile->bounds.min.x;
+        tpFloat h = tile->bounds.max.y - tile->bounds.min.y;
+        GLfloat patternTransform[9];
+
+        patternTransform[0] = inv.m.v[0] / w; patternTransform[1] = inv.m.v[1] / h; patternTransform[2] = 0;
+        patternTransform[3] = inv.m.v[2] / w; patternTransform[4] = inv.m.v[3] / h; patternTransform[5] = 0;
+        patternTransform[6] = inv.t.x / w; patternTransform[7] = inv.t.y / h; patternTransform[8] = 1;
+
+        _TARP_ASSERT_NO_GL_ERROR(glActiveTexture(GL_TEXTURE0));
+        _TARP_ASSERT_NO_GL_ERROR(glBindTexture(GL_TEXTURE_2D, tile->texture));
+        _TARP_ASSERT_NO_GL_ERROR(glUseProgram(_ctx->patternProgram));
+        _tpGLUploadMatrix(_ctx, _ctx->tpPatternLoc, _mvp);
+        _TARP_ASSERT_NO_GL_ERROR(glUniformMatrix3fv(_ctx->patternTransformLoc, 1, GL_FALSE, patternTransform));
+
+        /* the tile holds premultiplied colors */
+        _TARP_ASSERT_NO_GL_ERROR(glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA));
+        _tpGLDrawCover(_path);
+        _TARP_ASSERT_NO_GL_ERROR(glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
+        _TARP_ASSERT_NO_GL_ERROR(glUseProgram(_ctx->program));
+    }
+
+    if (_ctx->bDepthTest && _ctx->bDepthWrite)
+        _TARP_ASSERT_NO_GL_ERROR(glDepthMask(GL_FALSE));
 }
 
-TARP_LOCAL void _tpGLCacheBoundsGeometry(_tpGLPath * _path, const tpStyle * _style)
+/*
+the amount the stroke of a style can extend beyond the flattened path.
+For miter we don't calculate a tight bounding box but instead increase it to cover the worst case based
+on the stroke width and miter limit.
+@TODO: Make sure that this is actually good enough of a solution
+*/
+TARP_LOCAL tpFloat _tpGLStrokeBoundsPadding(const tpStyle * _style)
 {
-    _tpGLRect bounds;
-    _tpGLRect * bptr;
-    tpVec2 boundsData[4];
+    if (_style->stroke.type == kTpPaintTypeNone)
+        return 0;
+    return _style->strokeJoin == kTpStrokeJoinMiter ? _style->miterLimit * _style->strokeWidth * 0.5f : _style->strokeWidth;
+}
 
-    _path->boundsVertexOffset = _path->geometryCache.count;
+/*
+computes the bounds of the path drawn with _style under _transform (which may be NULL). The cached
+bounds are used if the geometry is up to date, otherwise the control points of the path are used,
+which yields slightly bigger but still conservative bounds.
+*/
+TARP_LOCAL void _tpGLPathTransformedBounds(_tpGLPath * _path, const tpStyle * _style, const tpTransform * _transform, _tpGLRect * _outBounds)
+{
+    int i, j;
+    tpFloat padding;
+    tpSegment * seg;
+    _tpGLContour * c;
+    _tpGLRect b;
+    tpVec2 corners[4];
+    tpTransform transform;
 
-    /*
-    add the bounds geometry to the end of the geometry cache.
+    /* the transform of the path is applied first */
+    if (_path->bHasTransform)
+    {
+        transform = _transform ? tpTransformCombine(_transform, &_path->transform) : _path->transform;
+        _transform = &transform;
+    }
+
+    if (!_path->bPathGeometryDirty && !_path->bPathGeometryAppended && _path->lastStroke.scaleStroke)
+    {
+        b = _path->boundsCache;
+    }
+    else
+    {
+        _tpGLInitBounds(&b);
+        for (i = 0; i < _path->contours.count; ++i)
+        {
+            c = _tpGLContourArrayAtPtr(&_path->contours, i);
+            if (c->bIsPolyline)
+            {
+                for (j = 0; j < c->points.count; ++j)
+                    _tpGLEvaluatePointForBounds(c->points.array[j], &b);
+            }
+            else
+            {
+                for (j = 0; j < c->segments.count; ++j)
+                {
+                    seg = _tpGLSegmentBufferAtPtr(&c->segments, j);
+                    _tpGLEvaluatePointForBounds(seg->handleIn, &b);
+                    _tpGLEvaluatePointForBounds(seg->position, &b);
+                    _tpGLEvaluatePointForBounds(seg->handleOut, &b);
+                }
+            }
+        }
+    }
+
+    _tpGLInitBounds(_outBounds);
+    if (b.min.x > b.max.x)
+        return;
+
+    /* non scaling strokes are padded after the transformation */
+    padding = _tpGLStrokeBoundsPadding(_style);
+    if (_style->scaleStroke)
+    {
+        b.min = tpVec2Sub(b.min, tpVec2Make(padding, padding));
+        b.max = tpVec2Add(b.max, tpVec2Make(padding, padding));
+    }
+
+    corners[0] = b.min;
+    corners[1] = tpVec2Make(b.min.x, b.max.y);
+    corners[2] = tpVec2Make(b.max.x, b.min.y);
+    corners[3] = b.max;
+    for (i = 0; i < 4; ++i)
+        _tpGLEvaluatePointForBounds(_transform ? tpTransformApply(_transform, corners[i]) : corners[i], _outBounds);
+
+    if (!_style->scaleStroke)
+    {
+        _outBounds->min = tpVec2Sub(_outBounds->min, tpVec2Make(padding, padding));
+        _outBounds->max = tpVec2Add(_outBounds->max, tpVec2Make(padding, padding));
+    }
+}
+
+/*
+A path made of a few contours scattered far apart would cover all the pixels in between with a single
+bounds quad. We split the bounds into a grid and cover each cell with the bounds of the contours in it,
+cut to the cell. These quads are only used if they cover a lot less than the bounds. They never overlap,
+which matters, as the nonzero fill rule would draw pixels covered twice twice.
+*/
+TARP_LOCAL void _tpGLCacheCoverGeometry(_tpGLPath * _path, const _tpGLRect * _bounds, tpFloat _padding)
+{
+    _tpGLRect cells[TARP_GL_COVER_GRID_SIZE * TARP_GL_COVER_GRID_SIZE];
+    _tpGLRect r, cell, * q;
+    _tpGLContour * c;
+    tpVec2 size, quad[6];
+    tpFloat area;
+    int i, x, y, x0, y0, x1, y1;
+    const int grid = TARP_GL_COVER_GRID_SIZE;
+
+    _path->coverVertexCount = 0;
+    if (_path->contours.count < 2)
+        return;
+
+    size = tpVec2MultScalar(tpVec2Sub(_bounds->max, _bounds->min), 1.0f / grid);
+    if (size.x <= 0 || size.y <= 0)
+        return;
+
+    for (i = 0; i < grid * grid; ++i)
+    {
+        cells[i].min = tpVec2Make(FLT_MAX, FLT_MAX);
+        cells[i].max = tpVec2Make(-FLT_MAX, -FLT_MAX);
+    }
+
+    for (i = 0; i < _path->contours.count; ++i)
+    {
+        c = _tpGLContourArrayAtPtr(&_path->contours, i);
+        if (!c->fillVertexCount)
+            continue;
+
+        r.min = tpVec2Make(c->bounds.min.x - _padding, c->bounds.min.y - _padding);
+        r.max = tpVec2Make(c->bounds.max.x + _padding, c->bounds.max.y + _padding);
+        x0 = TARP_CLAMP((int)((r.min.x - _bounds->min.x) / size.x), 0, grid - 1);
+        y0 = TARP_CLAMP((int)((r.min.y - _bounds->min.y) / size.y), 0, grid - 1);
+        x1 = TARP_CLAMP((int)((r.max.x - _bounds->min.x) / size.x), 0, grid - 1);
+        y1 = TARP_CLAMP((int)((r.max.y - _bounds->min.y) / size.y), 0, grid - 1);
+
+        for (y = y0; y <= y1; ++y)
+        {
+            for (x = x0; x <= x1; ++x)
+            {
+                /* neighboring cells compute their shared edge the same way, so their quads don't overlap */
+                cell.min = tpVec2Make(_bounds->min.x + x * size.x, _bounds->min.y + y * size.y);
+                cell.max = tpVec2Make(x == grid - 1 ? _bounds->max.x : _bounds->min.x + (x + 1) * size.x,
+                                      y == grid - 1 ? _bounds->max.y : _bounds->min.y + (y + 1) * size.y);
+                q = &cells[y * grid + x];
+                q->min.x = TARP_MIN(q->min.x, TARP_MAX(r.min.x, cell.min.x));
+                q->min.y = TARP_MIN(q->min.y, TARP_MAX(r.min.y, cell.min.y));
+                q->max.x = TARP_MAX(q->max.x, TARP_MIN(r.max.x, cell.max.x));
+                q->max.y = TARP_MAX(q->max.y, TARP_MIN(r.max.y, cell.max.y));
+            }
+        }
+    }
+
+    area = 0;
+    for (i = 0; i < grid * grid; ++i)
+    {
+        if (cells[i].min.x < cells[i].max.x && cells[i].min.y < cells[i].max.y)
+            area += (cells[i].max.x - cells[i].min.x) * (cells[i].max.y - cells[i].min.y);
+    }
+    if (area >= (_bounds->max.x - _bounds->min.x) * (_bounds->max.y - _bounds->min.y) * TARP_GL_SPARSE_COVER_RATIO)
+        return;
+
+    for (i = 0; i < grid * grid; ++i)
+    {
+        q = &cells[i];
+        if (q->min.x >= q->max.x || q->min.y >= q->max.y)
+            continue;
+        quad[0] = q->min;
+        quad[1] = tpVec2Make(q->min.x, q->max.y);
+        quad[2] = tpVec2Make(q->max.x, q->min.y);
+        quad[3] = quad[2];
+        quad[4] = quad[1];
+        quad[5] = q->max;
+        _tpVec2ArrayAppendArray(&_path->geometryCache, quad, 6);
+        _path->coverVertexCount += 6;
+    }
+}
+
+TARP_LOCAL void _tpGLCacheBoundsGeometry(_tpGLPath * _path, const tpStyle * _style)
+{
+    _tpGLRect bounds;
+    _tpGLRect * bptr;
+    tpVec2 boundsData[4];
+    tpFloat adder = 0;
+
+    _path->boundsVertexOffset = _path->geometryCache.count;
+
+    /*
+    add the bounds geometry to the end of the geometry cache.
     If there is a stroke, upload the stroke bounds instead
     */
     if (_style->stroke.type != kTpPaintTypeNone)
     {
-        tpFloat adder;
         bounds = _path->boundsCache;
-        /*
-        for miter we don't calculate a tight bounding box but instead increase it to cover the worst case based
-        on the stroke width and miter limit.
-        @TODO: Make sure that this is actually good enough of a solution
-        */
-        adder = _style->strokeJoin == kTpStrokeJoinMiter ? _style->miterLimit * _style->strokeWidth * 0.5f : _style->strokeWidth;
+        adder = _tpGLStrokeBoundsPadding(_style);
         bounds.min.x -= adder;
         bounds.min.y -= adder;
         bounds.max.x += adder;
@@ -3117,25 +6318,34 @@ TARP_LOCAL void _tpGLCacheBoundsGeometry(_tpGLPath * _path, const tpStyle * _sty
     boundsData[3] = bptr->max;
 
     _tpVec2ArrayAppendArray(&_path->geometryCache, boundsData, 4);
+    _tpGLCacheCoverGeometry(_path, bptr, adder);
 }
 
+
 typedef struct TARP_LOCAL
 {
     tpVec2 vertex;
     tpFloat tc;
 } TexVertex;
 
+/*
+the texture coordinate of a linear gradient is linear in the position, so instead of the bounds it can
+be drawn over the _coverCount vertices in _cover, which are the cover quads of a sparse path.
+*/
 TARP_LOCAL void _tpGLGradientLinearGeometry(
     _tpGLContext * _ctx,
     _tpGLGradient * _grad,
     const tpTransform * _paintTransform,
     const _tpGLRect * _bounds,
+    const tpVec2 * _cover,
+    int _coverCount,
     _tpGLTextureVertexArray * _vertices,
     int * _outVertexOffset,
     int * _outVertexCount)
 {
     /* regenerate the geometry for this path/gradient combo */
     _tpGLTextureVertex vertices[4];
+    _tpGLTextureVertex vertex;
     tpVec2 dir, ndir, dest, origin;
     tpVec2 tmp;
     tpFloat len2;
@@ -3147,6 +6357,20 @@ TARP_LOCAL void _tpGLGradientLinearGeometry(
     len2 = tpVec2LengthSquared(dir);
     ndir = tpVec2MultScalar(dir, 1 / len2);
 
+    if (_coverCount)
+    {
+        *_outVertexOffset = _vertices->count;
+        *_outVertexCount = _coverCount;
+        for (i = 0; i < _coverCount; ++i)
+        {
+            vertex.vertex = _cover[i];
+            vertex.tc.x = tpVec2Dot(tpVec2Sub(_cover[i], origin), ndir);
+            vertex.tc.y = 0;
+            _tpGLTextureVertexArrayAppendPtr(_vertices, &vertex);
+        }
+        return;
+    }
+
     vertices[0].vertex = _bounds->min;
     vertices[1].vertex = tpVec2Make(_bounds->max.x, _bounds->min.y);
     vertices[2].vertex = _bounds->max;
@@ -3193,12 +6417,13 @@ TARP_LOCAL void _tpGLGradientRadialGeometry(
     _tpGLGradient * _grad,
     const tpTransform * _paintTransform,
     const _tpGLRect * _bounds,
+    tpFloat _quality,
     _tpGLTextureVertexArray * _vertices,
     int * _outVertexOffset,
     int * _outVertexCount)
 {
     /* regenerate the geometry for this path/gradient combo */
-    _tpGLTextureVertex vertices[TARP_RADIAL_GRADIENT_SLICES + 7];
+    _tpGLTextureVertex vertices[TARP_MAX_RADIAL_GRADIENT_SLICES + 7];
     int vertexCount;
     tpTransform ellipse, inverse;
     tpMat2 rot;
@@ -3257,7 +6482,8 @@ TARP_LOCAL void _tpGLGradientRadialGeometry(
     vertices[0].tc = tpVec2Make(0, 0);
     vertexCount = 1;
 
-    phi = 2 * TARP_PI / TARP_RADIAL_GRADIENT_SLICES;
+    /* see tpQualityHints.gradientQuality */
+    phi = 2 * TARP_PI / TARP_CLAMP((int)(TARP_RADIAL_GRADIENT_SLICES * _quality), 8, TARP_MAX_RADIAL_GRADIENT_SLICES);
     rot = tpMat2MakeRotation(phi);
 
     /* max x, min y corner */
@@ -3366,15 +6592,10 @@ TARP_LOCAL void _tpGLCacheGradientGeometry(_tpGLContext * _ctx, _tpGLGradient *
 {
     _tpGLGradient * grad = _grad;
 
-    /* check if we need to update the gradient texture */
+    /* check if the gradient geometry needs to be rebuilt, the ramp texture is updated by _tpGLUploadDirtyRamps */
     if (grad->bDirty)
     {
         grad->bDirty = tpFalse;
-        /* ensure that the color stops are valid/complete */
-        _tpGLFinalizeColorStops(_ctx, grad);
-        /* update the ramp texture */
-        /* TODO: update the ramp texture separately just before drawing to avoid multiple texture binds */
-        _tpGLUpdateRampTexture(grad);
         _gradCache->lastGradientID = -1;
     }
 
@@ -3384,14 +6605,18 @@ TARP_LOCAL void _tpGLCacheGradientGeometry(_tpGLContext * _ctx, _tpGLGradient *
         if (grad->type == kTpGradientTypeLinear)
         {
             _tpGLGradientLinearGeometry(_ctx, grad, _paintTransform,
-                                        _gradCache->bounds, _vertices,
+                                        _gradCache->bounds,
+                                        _path->coverVertexCount ? _tpVec2ArrayAtPtr(&_path->geometryCache, _path->boundsVertexOffset + 4) : NULL,
+                                        _path->coverVertexCount, _vertices,
                                         &_gradCache->vertexOffset, &_gradCache->vertexCount);
-
+            _gradCache->primitive = _path->coverVertexCount ? GL_TRIANGLES : GL_TRIANGLE_FAN;
         }
         else if (grad->type == kTpGradientTypeRadial)
         {
+            /* the focal fan isn't linear in the position, so radial gradients keep covering the bounds */
+            _gradCache->primitive = GL_TRIANGLE_FAN;
             _tpGLGradientRadialGeometry(_ctx, grad, _paintTransform,
-                                        _gradCache->bounds, _vertices,
+                                        _gradCache->bounds, _path->quality.gradientQuality, _vertices,
                                         &_gradCache->vertexOffset, &_gradCache->vertexCount);
 
         }
@@ -3410,10 +6635,14 @@ TARP_API tpBool tpPrepareDrawing(tpContext _ctx)
 {
     _tpGLContext * ctx = (_tpGLContext *)_ctx.pointer;
 
+    __g_activeContext = ctx;
+
     /* cache previous render state so we can reset it in tpFinishDrawing */
     glGetIntegerv(GL_ACTIVE_TEXTURE, (GLint *)&ctx->stateBackup.activeTexture);
     ctx->stateBackup.depthTest = glIsEnabled(GL_DEPTH_TEST);
     glGetBooleanv(GL_DEPTH_WRITEMASK, &ctx->stateBackup.depthMask);
+    glGetIntegerv(GL_DEPTH_FUNC, (GLint *)&ctx->stateBackup.depthFunc);
+    glGetFloatv(GL_DEPTH_CLEAR_VALUE, &ctx->stateBackup.clearDepth);
     ctx->stateBackup.multisample = glIsEnabled(GL_MULTISAMPLE);
     ctx->stateBackup.stencilTest = glIsEnabled(GL_STENCIL_TEST);
     glGetIntegerv(GL_STENCIL_WRITEMASK, (GLint *)&ctx->stateBackup.stencilMask);
@@ -3434,6 +6663,9 @@ TARP_API tpBool tpPrepareDrawing(tpContext _ctx)
     glGetIntegerv(GL_VERTEX_ARRAY_BINDING, (GLint *)&ctx->stateBackup.vao);
     glGetIntegerv(GL_ARRAY_BUFFER_BINDING, (GLint *)&ctx->stateBackup.vbo);
     glGetIntegerv(GL_CURRENT_PROGRAM, (GLint *)&ctx->stateBackup.program);
+    ctx->stateBackup.scissorTest = glIsEnabled(GL_SCISSOR_TEST);
+    glGetIntegerv(GL_SCISSOR_BOX, ctx->stateBackup.scissorBox);
+    glGetFloatv(GL_COLOR_CLEAR_VALUE, ctx->stateBackup.clearColor);
 
     _TARP_ASSERT_NO_GL_ERROR(glActiveTexture(GL_TEXTURE0));
 
@@ -3457,18 +6689,37 @@ TARP_API tpBool tpPrepareDrawing(tpContext _ctx)
 
     ctx->clippingStackDepth = 0; /* reset clipping */
 
+    glGetIntegerv(GL_VIEWPORT, ctx->viewport);
+    if (ctx->bRetained || ctx->bDepthOrdering || ctx->bOcclusionCulling)
+    {
+        _tpGLCommandListClear(&ctx->frame);
+        ctx->recordList = &ctx->frame;
+    }
+
     return tpFalse;
 }
 
+TARP_LOCAL tpBool _tpGLRetainedFlush(_tpGLContext * _ctx);
+TARP_LOCAL tpBool _tpGLDeferredFlush(_tpGLContext * _ctx);
+
 TARP_API tpBool tpFinishDrawing(tpContext _ctx)
 {
     /* reset gl state to what it was before we began drawing */
     _tpGLContext * ctx = (_tpGLContext *)_ctx.pointer;
 
+    /* in retained mode, with depth ordering or occlusion culling, this is where the actual drawing happens */
+    if (ctx->bRetained)
+        _tpGLRetainedFlush(ctx);
+    else if (ctx->recordList)
+        _tpGLDeferredFlush(ctx);
+    ctx->debugPass = NULL;
+
     /* we dont assert gl errors here for now...should we? */
     glActiveTexture(ctx->stateBackup.activeTexture);
     ctx->stateBackup.depthTest ? glEnable(GL_DEPTH_TEST) : glDisable(GL_DEPTH_TEST);
     glDepthMask(ctx->stateBackup.depthMask);
+    glDepthFunc(ctx->stateBackup.depthFunc);
+    glClearDepth(ctx->stateBackup.clearDepth);
     ctx->stateBackup.multisample ? glEnable(GL_MULTISAMPLE) : glDisable(GL_MULTISAMPLE);
     ctx->stateBackup.stencilTest ? glEnable(GL_STENCIL_TEST) : glDisable(GL_STENCIL_TEST);
     glStencilMask(ctx->stateBackup.stencilMask);
@@ -3490,55 +6741,406 @@ TARP_API tpBool tpFinishDrawing(tpContext _ctx)
     glBindVertexArray(ctx->stateBackup.vao);
     glBindBuffer(GL_ARRAY_BUFFER, ctx->stateBackup.vbo);
     glUseProgram(ctx->stateBackup.program);
+    ctx->stateBackup.scissorTest ? glEnable(GL_SCISSOR_TEST) : glDisable(GL_SCISSOR_TEST);
+    glScissor(ctx->stateBackup.scissorBox[0], ctx->stateBackup.scissorBox[1],
+              ctx->stateBackup.scissorBox[2], ctx->stateBackup.scissorBox[3]);
+    glClearColor(ctx->stateBackup.clearColor[0], ctx->stateBackup.clearColor[1],
+                 ctx->stateBackup.clearColor[2], ctx->stateBackup.clearColor[3]);
 
+    __g_activeContext = NULL;
     return tpFalse;
 }
 
-TARP_LOCAL void _tpGLPrepareStencilPlanes(_tpGLContext * _ctx, tpBool _bIsClippingPath, int * _outTargetStencilPlane, int * _outTestStencilPlane)
+TARP_LOCAL int _tpGLPathFillVertexEnd(_tpGLPath * _path)
 {
-    *_outTargetStencilPlane = _bIsClippingPath ? _ctx->currentClipStencilPlane : _kTpGLFillRasterStencilPlane;
-    *_outTestStencilPlane = _ctx->currentClipStencilPlane == _kTpGLClippingStencilPlaneOne ? _kTpGLClippingStencilPlaneTwo : _kTpGLClippingStencilPlaneOne;
+    _tpGLContour * c;
+    if (!_path->contours.count)
+        return 0;
+    c = _tpGLContourArrayLastPtr(&_path->contours);
+    return c->fillVertexOffset + c->fillVertexCount;
 }
 
-TARP_LOCAL tpBool _tpGLDrawPathImpl(_tpGLContext * _ctx, _tpGLPath * _path, const tpStyle * _style, tpBool _bIsClipPath)
+/*
+remembers a range of the geometry cache that changed and needs to be uploaded.
+If we run out of ranges, they are all merged into one.
+*/
+TARP_LOCAL void _tpGLPathMarkUploadRange(_tpGLPath * _path, int _from, int _to)
 {
-    GLint i;
-    GLuint stencilPlaneToWriteTo, stencilPlaneToTestAgainst;
+    int i;
+
+    if (_path->bUploadAll || _from >= _to)
+        return;
+
+    if (_path->uploadRangeCount == TARP_GL_MAX_UPLOAD_RANGES)
+    {
+        for (i = 0; i < _path->uploadRangeCount; ++i)
+        {
+            _from = TARP_MIN(_from, _path->uploadRanges[i * 2]);
+            _to = TARP_MAX(_to, _path->uploadRanges[i * 2 + 1]);
+        }
+        _path->uploadRangeCount = 0;
+    }
+
+    _path->uploadRanges[_path->uploadRangeCount * 2] = _from;
+    _path->uploadRanges[_path->uploadRangeCount * 2 + 1] = _to;
+    _path->uploadRangeCount++;
+}
+
+/*
+uploads the out of date parts of the geometry cache to the paths buffer in _ctx and leaves it bound
+to GL_ARRAY_BUFFER.
+*/
+TARP_LOCAL tpBool _tpGLPathUpload(_tpGLContext * _ctx, _tpGLPath * _path)
+{
+    int i, from, to;
+    int count = _path->geometryCache.count;
+    _tpGLBuffer * buffer;
+    tpBool bClaimed;
+
+    if (_tpGLBindBuffer(_ctx, &_path->buffer, "tarp path", _path, &bClaimed))
+        return tpTrue;
+    buffer = _tpGLBufferArrayAtPtr(&_ctx->buffers, _path->buffer.index);
+
+    if (bClaimed || _path->bUploadAll || count > buffer->vertexCapacity)
+    {
+        /*
+        if the buffer was outgrown, leave room to grow into so that paths that keep growing
+        don't need to reallocate and upload everything on every draw.
+        */
+        if (count > buffer->vertexCapacity)
+            buffer->vertexCapacity = buffer->vertexCapacity ? TARP_MAX(count, buffer->vertexCapacity * 2) : count;
+
+        _TARP_ASSERT_NO_GL_ERROR(glBufferData(GL_ARRAY_BUFFER, sizeof(tpVec2) * buffer->vertexCapacity, NULL, GL_DYNAMIC_DRAW));
+        _TARP_ASSERT_NO_GL_ERROR(glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(tpVec2) * count, _path->geometryCache.array));
+    }
+    else
+    {
+        for (i = 0; i < _path->uploadRangeCount; ++i)
+        {
+            from = _path->uploadRanges[i * 2];
+            to = TARP_MIN(_path->uploadRanges[i * 2 + 1], count);
+            if (to > from)
+            {
+                _TARP_ASSERT_NO_GL_ERROR(glBufferSubData(GL_ARRAY_BUFFER, sizeof(tpVec2) * from,
+                                         sizeof(tpVec2) * (to - from), _path->geometryCache.array + from));
+            }
+        }
+    }
+
+    _path->bUploadAll = tpFalse;
+    _path->uploadRangeCount = 0;
+    return tpFalse;
+}
+
+/*
+returns the tolerance in path space (or screen space for non scaling strokes) that the flattened
+geometry gets simplified with and the scale bucket it is valid for. Buckets are power of two
+scale ranges, and the tolerance is computed for the biggest scale in the bucket.
+*/
+TARP_LOCAL tpFloat _tpGLPathSimplifyTolerance(_tpGLPath * _path, const tpStyle * _style, tpFloat _transformScale, int * _outBucket)
+{
+    int e;
+
+    *_outBucket = 0;
+    if (_path->simplifyTolerance <= 0)
+        return 0;
+
+    /* non scaling strokes are flattened in screen space already */
+    if (!_style->scaleStroke)
+        return _path->simplifyTolerance;
+
+    frexp(_transformScale, &e);
+    *_outBucket = e;
+    return _path->simplifyTolerance / (tpFloat)ldexp(1.0, e);
+}
+
+/*
+Brings the geometry cache up to date if the only change to the path since it was last built
+is segments being appended to its last, open contour. Only the new tail gets flattened and
+stroked (including the join with the previously last segment) and is spliced into the cache,
+so the cost is proportional to the appended data. Returns tpTrue if that is not possible and
+the path needs to be rebuilt instead, which is always the case while its topology is frozen.
+*/
+TARP_LOCAL tpBool _tpGLPathAppendGeometry(_tpGLPath * _path, const tpStyle * _style,
+        tpFloat _transformScale, const tpTransform * _transform, tpFloat _simplifyTolerance,
+        _tpVec2Array * _tmpVertices, _tpBoolArray * _tmpJoints)
+{
+    int i, j, n, start, segCount, oldFillCount, fillEnd, strokeStart, tailStart, k, gap, delta, vcount;
+    tpBool bStroke, bAnchor;
+    tpFloat tolerance;
+    const tpTransform * transform;
+    tpSegment * segments, * last, * current;
+    const tpVec2 * src;
+    tpVec2 pt, lastPt;
+    _tpGLCurve curve;
     _tpGLRect bounds;
+    _tpGLContour * c;
     _tpGLPath * p = _path;
 
-    assert(_ctx && p);
+    /* frozen contours record their curve parameters and aren't simplified, see _tpGLFlattenPath */
+    if (!p->contours.count || p->bFrozenTopology)
+        return tpTrue;
 
-    /* check if the transform projection is dirty */
-    if (p->lastDrawContext != _ctx ||
-            p->lastTransformID != _ctx->transformID)
+    /* all but the last contour have to be up to date */
+    for (i = 0; i < p->contours.count - 1; ++i)
     {
-        /* @TODO: we should also take skew into account here, not only scale */
-        if (_ctx->transformScale > p->lastTransformScale || !_style->scaleStroke)
+        c = _tpGLContourArrayAtPtr(&p->contours, i);
+        if (c->bDirty || c->flattenedSegmentCount != _tpGLContourSegmentCount(c))
+            return tpTrue;
+    }
+
+    c = _tpGLContourArrayLastPtr(&p->contours);
+    segCount = _tpGLContourSegmentCount(c);
+    if (c->bDirty || c->bIsClosed || c->flattenedSegmentCount < 1 || c->flattenedSegmentCount > segCount ||
+            p->lastStroke.scaleStroke != _style->scaleStroke)
+        return tpTrue;
+
+    /* the cached stroke has to match the style. Dashed strokes are always regenerated from the start. */
+    bStroke = (tpBool)(_style->stroke.type != kTpPaintTypeNone && _style->strokeWidth > 0);
+    if (bStroke)
+    {
+        if (_style->dashCount || p->lastStroke.dashCount ||
+                p->lastStroke.strokeType == kTpPaintTypeNone ||
+                p->lastStroke.strokeWidth != _style->strokeWidth ||
+                p->lastStroke.cap != _style->strokeCap ||
+                p->lastStroke.join != _style->strokeJoin ||
+                p->lastStroke.miterLimit != _style->miterLimit ||
+                p->lastStroke.roundQuality != p->quality.roundQuality ||
+                (c->strokeVertexCount && c->strokeCapOffset < 0))
+            return tpTrue;
+    }
+    else if (p->lastStroke.strokeType != kTpPaintTypeNone && p->lastStroke.strokeWidth > 0)
+    {
+        return tpTrue;
+    }
+
+    if (_style->scaleStroke)
+    {
+        tolerance = 0.15f / (_transformScale * p->quality.curveQuality);
+        transform = NULL;
+    }
+    else
+    {
+        tolerance = 0.15f / p->quality.curveQuality;
+        transform = _transform;
+    }
+
+    /* flatten the new tail into the tmp buffers */
+    oldFillCount = c->fillVertexCount;
+    fillEnd = c->fillVertexOffset + oldFillCount;
+    bounds = c->bounds;
+    _tpVec2ArrayClear(_tmpVertices);
+    _tpBoolArrayClear(_tmpJoints);
+
+    /*
+    when simplifying, the previously last vertex is added in front of the tail to anchor it.
+    It is removed again after the simplification.
+    */
+    bAnchor = (tpBool)(_simplifyTolerance > 0 && oldFillCount);
+    if (bAnchor && (_tpVec2ArrayAppend(_tmpVertices, _tpVec2ArrayAt(&p->geometryCache, fillEnd - 1)) ||
+                    _tpBoolArrayAppend(_tmpJoints, _tpBoolArrayAt(&p->jointCache, fillEnd - 1))))
+        return tpTrue;
+
+    if (c->bIsPolyline)
+    {
+        /* same as _tpGLFlattenPolyline, if there is no room the full rebuild reports the error */
+        n = segCount - c->flattenedSegmentCount;
+        if ((_tmpVertices->capacity < _tmpVertices->count + n &&
+                _tpVec2ArrayReserve(_tmpVertices, (_tmpVertices->count + n) * 2)) ||
+                (_tmpJoints->capacity < _tmpJoints->count + n &&
+                 _tpBoolArrayReserve(_tmpJoints, (_tmpJoints->count + n) * 2)))
+            return tpTrue;
+
+        start = _tmpVertices->count;
+        src = c->points.array + c->flattenedSegmentCount;
+        if (transform)
         {
-            _tpGLMarkPathGeometryDirty(p);
+            tpTransformApplyArray(transform, src, _tmpVertices->array + start, n);
+            src = _tmpVertices->array + start;
         }
-        p->lastTransformID = _ctx->transformID;
-        p->lastDrawContext = _ctx;
-        p->lastTransformScale = _ctx->transformScale;
+
+        for (i = 0; i < n; ++i)
+        {
+            pt = src[i];
+            vcount = oldFillCount + _tmpVertices->count - bAnchor;
+            if (vcount)
+            {
+                lastPt = _tmpVertices->count ? _tpVec2ArrayLast(_tmpVertices) : _tpVec2ArrayAt(&p->geometryCache, fillEnd - 1);
+                if (tpVec2Equals(pt, lastPt))
+                    continue;
+            }
+
+            _tmpVertices->array[_tmpVertices->count++] = pt;
+            _tmpJoints->array[_tmpJoints->count++] = (tpBool)(vcount > 0);
+        }
+        _tpGLEvaluatePointsForBounds(_tmpVertices->array + start, _tmpVertices->count - start, &bounds);
+    }
+    else
+    {
+        vcount = 0;
+        segments = _tpGLPathTransformedSegments(p, c, c->flattenedSegmentCount - 1, segCount, transform);
+        if (!segments)
+            return tpTrue;
+        last = &segments[0];
+        for (j = 1; j <= segCount - c->flattenedSegmentCount; ++j)
+        {
+            current = &segments[j];
+
+            curve.p0 = last->position;
+            curve.h0 = last->handleOut;
+            curve.h1 = current->handleIn;
+            curve.p1 = current->position;
+
+            _tpGLFlattenCurve(p, &curve, tolerance, tpFalse,
+                              oldFillCount + _tmpVertices->count == 0, tpFalse,
+                              _tmpVertices, _tmpJoints, &bounds, &vcount, NULL);
+            last = current;
+        }
+    }
+
+    c->flattenedSegmentCount = segCount;
+    p->bPathGeometryAppended = tpFalse;
+
+    if (_simplifyTolerance > 0)
+    {
+        _tmpVertices->count = _tpGLSimplifyVertices(_tmpVertices->array, _tmpJoints->array,
+                              _tmpVertices->count, _simplifyTolerance);
+        _tmpJoints->count = _tmpVertices->count;
+    }
+
+    k = _tmpVertices->count - bAnchor;
+    if (!k)
+        return tpFalse;
+
+    assert(p->jointCache.count == fillEnd);
+
+    /* the bounds and the end cap of the contour's stroke are regenerated, so we drop them */
+    tailStart = bStroke && c->strokeVertexCount ? c->strokeCapOffset : p->boundsVertexOffset;
+    strokeStart = fillEnd + p->fillVertexGap;
+
+    /*
+    if the new fill vertices don't fit into the gap in front of the stroke geometry, we move the
+    stroke back. The new gap grows with the fill geometry so this rarely happens for paths that
+    keep growing.
+    */
+    gap = p->fillVertexGap - k;
+    delta = 0;
+    if (gap < 0)
+    {
+        gap = (fillEnd + k) / 2;
+        delta = k + gap - p->fillVertexGap;
+    }
+
+    if (p->geometryCache.capacity < tailStart + delta &&
+            _tpVec2ArrayReserve(&p->geometryCache, (tailStart + delta) * 2))
+    {
+        _tpGLSetErrorMessage("Could not allocate memory for the path geometry.");
+        c->bDirty = tpTrue;
+        return tpTrue;
+    }
+
+    p->geometryCache.count = tailStart;
+    if (delta)
+    {
+        memmove(p->geometryCache.array + strokeStart + delta, p->geometryCache.array + strokeStart,
+                sizeof(tpVec2) * (tailStart - strokeStart));
+        p->geometryCache.count += delta;
+
+        for (i = 0; i < p->contours.count; ++i)
+            _tpGLContourArrayAtPtr(&p->contours, i)->strokeVertexOffset += delta;
+        if (c->strokeCapOffset >= 0)
+            c->strokeCapOffset += delta;
+        if (bStroke)
+            p->strokeVertexOffset += delta;
+
+        _tpGLPathMarkUploadRange(p, fillEnd, p->geometryCache.count);
+    }
+    else
+    {
+        _tpGLPathMarkUploadRange(p, fillEnd, fillEnd + k);
+    }
+
+    memcpy(p->geometryCache.array + fillEnd, _tmpVertices->array + bAnchor, sizeof(tpVec2) * k);
+    _tpBoolArrayAppendArray(&p->jointCache, _tmpJoints->array + bAnchor, k);
+    p->fillVertexGap = gap;
+    c->fillVertexCount += k;
+    c->bounds = bounds;
+    _tpGLMergeBounds(&p->boundsCache, &bounds);
+
+    tailStart = p->geometryCache.count;
+
+    /* continue the stroke from the previously last vertex of the contour */
+    if (bStroke)
+    {
+        if (!c->strokeVertexCount)
+            c->strokeVertexOffset = tailStart;
+        _tpGLContinousStrokeContour(c, _style, p->quality.roundQuality, c->fillVertexOffset + TARP_MAX(0, oldFillCount - 1),
+                                    &p->geometryCache, &p->jointCache);
+        c->strokeVertexCount = p->geometryCache.count - c->strokeVertexOffset;
+        p->strokeVertexOffset = _tpGLContourArrayAtPtr(&p->contours, 0)->strokeVertexOffset;
+        p->strokeVertexCount = p->geometryCache.count - p->strokeVertexOffset;
     }
 
+    _tpGLCacheBoundsGeometry(p, _style);
+    _tpGLPathMarkUploadRange(p, tailStart, p->geometryCache.count);
+    p->geometryVersion++;
+
+    /* the gradient geometry depends on the bounds */
+    p->fillGradientData.lastGradientID = -1;
+    p->strokeGradientData.lastGradientID = -1;
+
+    return tpFalse;
+}
+
+/*
+Makes sure that the geometry cache of the path is up to date for the provided style.
+_transformScale is the scale the geometry will be rendered at, _transform is only used
+for non scaling strokes where the path needs to be flattened in transformed space.
+The tmp buffers are used to double buffer the flattening.
+_styleVersion is the version of the style handle that _style comes from or 0 for plain styles. If the
+stroke was last validated against the same version, none of the stroke properties need to be compared.
+Returns tpTrue if the path could not be flattened, in which case it is rebuilt the next time.
+*/
+TARP_LOCAL tpBool _tpGLPathUpdateGeometry(_tpGLPath * _path, const tpStyle * _style, int _styleVersion,
+        tpFloat _transformScale, const tpTransform * _transform,
+        _tpVec2Array * _tmpVertices, _tpBoolArray * _tmpJoints,
+        tpBool _bIsClipPath)
+{
+    _tpGLRect bounds;
+    int fillEnd, simplifyBucket;
+    tpFloat simplifyTolerance;
+    tpBool bSameStyle;
+    _tpGLPath * p = _path;
+
+    bSameStyle = (tpBool)(_styleVersion && p->lastStyleVersion == _styleVersion &&
+                          (p->lastStroke.strokeType == kTpPaintTypeNone ||
+                           p->lastStroke.roundQuality == p->quality.roundQuality));
+
     /*
     if this style has a stroke and its scale stroke property is different from the last style,
     we force a full reflattening of all path contours.
     we also do this if the style has non scaling stroke and the transform changed since we
     last drew the path.
     */
-    if (!p->bPathGeometryDirty && _style->stroke.type != kTpPaintTypeNone && p->lastStroke.scaleStroke != _style->scaleStroke)
+    if (!p->bPathGeometryDirty && !bSameStyle && _style->stroke.type != kTpPaintTypeNone &&
+            p->lastStroke.scaleStroke != _style->scaleStroke)
     {
         _tpGLMarkPathGeometryDirty(p);
     }
 
-    if (_ctx->bTransformProjDirty)
+    /* simplified geometry needs to be rebuilt if the scale leaves the bucket it was simplified for */
+    simplifyTolerance = _tpGLPathSimplifyTolerance(p, _style, _transformScale, &simplifyBucket);
+    if (!p->bPathGeometryDirty && simplifyTolerance > 0 && simplifyBucket != p->simplifyBucket)
     {
-        _ctx->bTransformProjDirty = tpFalse;
-        _ctx->renderTransform = tpMat4MakeFrom2DTransform(&_ctx->transform);
-        _ctx->transformProjection = tpMat4Mult(&_ctx->projection, &_ctx->renderTransform);
+        _tpGLMarkPathGeometryDirty(p);
+    }
+
+    /* if segments were only appended, try to only add the new geometry */
+    if (!p->bPathGeometryDirty && p->bPathGeometryAppended &&
+            _tpGLPathAppendGeometry(p, _style, _transformScale, _transform, simplifyTolerance, _tmpVertices, _tmpJoints))
+    {
+        /* the flattening below picks up the appended segments */
+        p->bPathGeometryDirty = tpTrue;
     }
 
     /*
@@ -3548,35 +7150,59 @@ TARP_LOCAL tpBool _tpGLDrawPathImpl(_tpGLContext * _ctx, _tpGLPath * _path, cons
     if (p->bPathGeometryDirty)
     {
         p->bPathGeometryDirty = tpFalse;
-
-        /* flatten the path into tmp buffers */
-        if (_style->scaleStroke)
-            _tpGLFlattenPath(p, 0.15f / _ctx->transformScale, NULL, &_ctx->tmpVertices, &_ctx->tmpJoints, &bounds);
-        else
-            _tpGLFlattenPath(p, 0.15f, &_ctx->transform, &_ctx->tmpVertices, &_ctx->tmpJoints, &bounds);
+        p->bPathGeometryAppended = tpFalse;
+        p->fillVertexGap = 0;
+        p->bUploadAll = tpTrue;
+        p->simplifyBucket = simplifyBucket;
+
+        /* the tmp buffers might still hold the tail of a previous incremental update (see _tpGLPathAppendGeometry) */
+        _tpVec2ArrayClear(_tmpVertices);
+        _tpBoolArrayClear(_tmpJoints);
+
+        /* flatten (and potentially simplify) the path into tmp buffers */
+        if (_style->scaleStroke ?
+                _tpGLFlattenPath(p, 0.15f / (_transformScale * p->quality.curveQuality), simplifyTolerance, NULL, _tmpVertices, _tmpJoints, &bounds) :
+                _tpGLFlattenPath(p, 0.15f / p->quality.curveQuality, simplifyTolerance, _transform, _tmpVertices, _tmpJoints, &bounds))
+        {
+            /* some contours might have been flattened into the tmp buffers already */
+            _tpGLMarkPathGeometryDirty(p);
+            return tpTrue;
+        }
 
         /* generate and add the stroke geometry to the tmp buffers */
         if (_style->stroke.type != kTpPaintTypeNone && _style->strokeWidth > 0)
-            _tpGLStroke(p, _style, &_ctx->tmpVertices, &_ctx->tmpJoints);
+        {
+            _tpGLStroke(p, _style, _tmpVertices, _tmpJoints);
+        }
+        else
+        {
+            p->lastStroke.strokeType = kTpPaintTypeNone;
+            p->lastStroke.strokeWidth = 0;
+            p->lastStroke.scaleStroke = _style->scaleStroke;
+            p->strokeVertexOffset = 0;
+            p->strokeVertexCount = 0;
+        }
 
         /* swap the tmp buffers with the path caches */
         _tpVec2ArrayClear(&p->geometryCache);
         _tpBoolArrayClear(&p->jointCache);
-        _tpVec2ArraySwap(&p->geometryCache, &_ctx->tmpVertices);
-        _tpBoolArraySwap(&p->jointCache, &_ctx->tmpJoints);
+        _tpVec2ArraySwap(&p->geometryCache, _tmpVertices);
+        _tpBoolArraySwap(&p->jointCache, _tmpJoints);
 
         /* save the path bounds */
         p->boundsCache = bounds;
 
         /* add the bounds geometry to the geom cache (and potentially cache stroke bounds) */
         _tpGLCacheBoundsGeometry(p, _style);
+        p->geometryVersion++;
 
         /* force recalculation of gradient related geometries */
         p->fillGradientData.lastGradientID = -1;
         p->strokeGradientData.lastGradientID = -1;
     }
     /* check if the stroke should be removed */
-    else if (((_style->stroke.type == kTpPaintTypeNone &&
+    else if (!bSameStyle &&
+             ((_style->stroke.type == kTpPaintTypeNone &&
                p->lastStroke.strokeType != kTpPaintTypeNone) ||
               (_style->strokeWidth == 0 && p->lastStroke.strokeWidth > 0)))
     {
@@ -3584,29 +7210,193 @@ TARP_LOCAL tpBool _tpGLDrawPathImpl(_tpGLContext * _ctx, _tpGLPath * _path, cons
         p->lastStroke.strokeWidth = 0;
         p->strokeVertexOffset = 0;
         p->strokeVertexCount = 0;
+        p->geometryVersion++;
     }
     /* check if the stroke needs to be regenerated (due to a change in stroke width or dash related settings) */
-    else if (!_bIsClipPath && ((_style->stroke.type != kTpPaintTypeNone && _style->strokeWidth > 0 &&
+    else if (!_bIsClipPath && !bSameStyle && ((_style->stroke.type != kTpPaintTypeNone && _style->strokeWidth > 0 &&
                                 (p->lastStroke.strokeWidth != _style->strokeWidth ||
                                  p->lastStroke.cap != _style->strokeCap ||
                                  p->lastStroke.join != _style->strokeJoin ||
+                                 p->lastStroke.miterLimit != _style->miterLimit ||
+                                 (p->lastStroke.roundQuality != p->quality.roundQuality &&
+                                  (_style->strokeJoin == kTpStrokeJoinRound || _style->strokeCap == kTpStrokeCapRound)) ||
                                  p->lastStroke.dashCount != _style->dashCount ||
                                  p->lastStroke.dashOffset != _style->dashOffset ||
                                  memcmp(p->lastStroke.dashArray, _style->dashArray, sizeof(tpFloat) * _style->dashCount) != 0))))
     {
-        /* remove all the old stoke vertices from the cache */
-        _tpVec2ArrayRemoveRange(&p->geometryCache, p->strokeVertexOffset, p->geometryCache.count);
+        /*
+        remove all the old stoke vertices (and the bounds) from the cache. We don't use
+        strokeVertexOffset here as it is reset if the stroke was removed.
+        */
+        fillEnd = _tpGLPathFillVertexEnd(p);
+        if (p->geometryCache.count > fillEnd)
+            _tpVec2ArrayRemoveRange(&p->geometryCache, fillEnd, p->geometryCache.count);
+        p->fillVertexGap = 0;
 
         /* generate and add the stroke geometry to the cache. */
         _tpGLStroke(p, _style, &p->geometryCache, &p->jointCache);
 
         /* add the bounds geometry to the geom cache. */
         _tpGLCacheBoundsGeometry(p, _style);
+        _tpGLPathMarkUploadRange(p, fillEnd, p->geometryCache.count);
+        p->geometryVersion++;
 
-        /* force rebuilding of the stroke gradient geometry */
+        /* force rebuilding of the stroke gradient geometry, and of the fill's if it is drawn over the cover quads */
         p->strokeGradientData.lastGradientID = -1;
+        p->fillGradientData.lastGradientID = -1;
+    }
+
+    /* clipping paths skip the stroke, so their geometry doesn't match any style */
+    p->lastStyleVersion = _bIsClipPath ? 0 : _styleVersion;
+    return tpFalse;
+}
+
+TARP_LOCAL void _tpGLPrepareStencilPlanes(_tpGLContext * _ctx, tpBool _bIsClippingPath, int * _outTargetStencilPlane, int * _outTestStencilPlane)
+{
+    *_outTargetStencilPlane = _bIsClippingPath ? _ctx->currentClipStencilPlane : _kTpGLFillRasterStencilPlane;
+    *_outTestStencilPlane = _ctx->currentClipStencilPlane == _kTpGLClippingStencilPlaneOne ? _kTpGLClippingStencilPlaneTwo : _kTpGLClippingStencilPlaneOne;
+}
+
+TARP_LOCAL tpBool _tpGLDrawSmallPath(_tpGLContext * _ctx, _tpGLPath * _path, const tpStyle * _style);
+
+/*
+packs the fill vertex ranges of the contours into fillFirsts and fillCounts, so that the stencil
+passes can draw all contours with one glMultiDrawArrays without touching the contours themselves.
+*/
+TARP_LOCAL tpBool _tpGLPathUpdateFillRanges(_tpGLPath * _path)
+{
+    int i;
+    _tpGLContour * c;
+
+    if (_path->fillRangesVersion == _path->geometryVersion)
+        return tpFalse;
+
+    if ((_path->fillFirsts.capacity < _path->contours.count &&
+            _tpIntArrayReserve(&_path->fillFirsts, _path->contours.count)) ||
+            (_path->fillCounts.capacity < _path->contours.count &&
+             _tpIntArrayReserve(&_path->fillCounts, _path->contours.count)))
+    {
+        _tpGLSetErrorMessage("Could not allocate memory for the fill ranges.");
+        return tpTrue;
+    }
+
+    for (i = 0; i < _path->contours.count; ++i)
+    {
+        c = _tpGLContourArrayAtPtr(&_path->contours, i);
+        _path->fillFirsts.array[i] = c->fillVertexOffset;
+        _path->fillCounts.array[i] = c->fillVertexCount;
+    }
+    _path->fillFirsts.count = _path->fillCounts.count = _path->contours.count;
+    _path->fillRangesVersion = _path->geometryVersion;
+    return tpFalse;
+}
+
+/* the number of window pixels per unit of the current transform */
+TARP_LOCAL tpFloat _tpGLPixelScale(_tpGLContext * _ctx)
+{
+    const tpFloat * m = _ctx->projection.v;
+    return TARP_MAX(sqrt(m[0] * m[0] + m[1] * m[1]) * _ctx->viewport[2],
+                    sqrt(m[4] * m[4] + m[5] * m[5]) * _ctx->viewport[3]) * 0.5f * _ctx->transformScale;
+}
+
+TARP_LOCAL void _tpGLLayerUpdate(_tpGLLayer * _layer);
+TARP_LOCAL tpBool _tpGLLayerRender(_tpGLContext * _ctx, _tpGLLayer * _layer, int _bucket);
+
+/*
+renders the tile of a pattern paint if any of its paths changed or it is drawn with more pixels per tile unit
+than it was rendered at. This needs to happen before the path's stencil passes as it switches framebuffers.
+Drawing it smaller is left to the mipmaps, so paths drawing the same pattern at different scales don't keep
+rendering it again.
+*/
+TARP_LOCAL tpBool _tpGLPreparePattern(_tpGLContext * _ctx, _tpGLPath * _path, const tpPaint * _paint,
+                                      const tpTransform * _paintTransform)
+{
+    int bucket;
+    tpFloat scale;
+    const tpFloat * m = _paintTransform->m.v;
+    _tpGLLayer * tile;
+
+    if (_paint->type != kTpPaintTypePattern)
+        return tpFalse;
+    if (_tpGLEnsurePatternProgram(_ctx))
+        return tpTrue;
+
+    tile = (_tpGLLayer *)_paint->data.pattern.pointer;
+    _tpGLLayerUpdate(tile);
+
+    scale = _tpGLPixelScale(_ctx) * TARP_MAX(sqrt(m[0] * m[0] + m[1] * m[1]), sqrt(m[2] * m[2] + m[3] * m[3]));
+    if (_path->bHasTransform)
+        scale *= _path->transformScale;
+    frexp(scale, &bucket);
+    if ((tile->bDirty || bucket > tile->rasterBucket) && _tpGLLayerRender(_ctx, tile, bucket))
+        return tpTrue;
+    return tpFalse;
+}
+
+TARP_LOCAL tpBool _tpGLDrawPathImpl(_tpGLContext * _ctx, _tpGLPath * _path, const tpStyle * _style, int _styleVersion,
+                                     tpBool _bIsClipPath)
+{
+    GLuint stencilPlaneToWriteTo, stencilPlaneToTestAgainst;
+    const tpMat4 * mvp, * transformProjection;
+    tpMat4 pathMatrix, pathTransformProjection;
+    tpTransform transform, fillPaintTransform, strokePaintTransform;
+    tpFloat scale;
+    _tpGLPath * p = _path;
+
+    assert(_ctx && p);
+
+    if (!_bIsClipPath && (_tpGLPreparePattern(_ctx, p, &_style->fill, &p->fillPaintTransform) ||
+                          _tpGLPreparePattern(_ctx, p, &_style->stroke, &p->strokePaintTransform)))
+        return tpTrue;
+
+    /* the scale the path is drawn at, including its own transform (see tpPathSetTransform) */
+    scale = p->bHasTransform ? _ctx->transformScale * p->transformScale : _ctx->transformScale;
+
+    /* check if the transform projection is dirty */
+    if (p->lastDrawContext != _ctx ||
+            p->lastTransformID != _ctx->transformID)
+    {
+        /* @TODO: we should also take skew into account here, not only scale */
+        if (scale > p->lastTransformScale || !_style->scaleStroke)
+        {
+            _tpGLMarkPathGeometryDirty(p);
+        }
+        p->lastTransformID = _ctx->transformID;
+        p->lastDrawContext = _ctx;
+        p->lastTransformScale = scale;
+    }
+
+    if (_ctx->bTransformProjDirty)
+    {
+        _ctx->bTransformProjDirty = tpFalse;
+        _ctx->renderTransform = tpMat4MakeFrom2DTransform(&_ctx->transform);
+        _ctx->transformProjection = tpMat4Mult(&_ctx->projection, &_ctx->renderTransform);
+    }
+
+    if (!_bIsClipPath && _ctx->minimumPathSize > 0 && _tpGLDrawSmallPath(_ctx, p, _style))
+        return tpFalse;
+
+    /* the path transform is combined with the context's on the GPU, non scaling strokes are built with both applied */
+    if (p->bHasTransform)
+    {
+        transform = tpTransformCombine(&_ctx->transform, &p->transform);
+        pathMatrix = tpMat4MakeFrom2DTransform(&p->transform);
+        pathTransformProjection = tpMat4Mult(&_ctx->transformProjection, &pathMatrix);
+        transformProjection = &pathTransformProjection;
+    }
+    else
+    {
+        transform = _ctx->transform;
+        transformProjection = &_ctx->transformProjection;
     }
 
+    if (_tpGLPathUpdateGeometry(p, _style, _styleVersion, scale, &transform,
+                                &_ctx->tmpVertices, &_ctx->tmpJoints, _bIsClipPath))
+        return tpTrue;
+
+    _ctx->debugPass = _bIsClipPath ? "clipping mask" : "gradients";
+    _ctx->debugObject = p;
+
     /*
     check if there are any gradients to be cached.
     @TODO: This if statement could really need a cleaner rework. Basically what we are doing here is
@@ -3639,27 +7429,46 @@ TARP_LOCAL tpBool _tpGLDrawPathImpl(_tpGLContext * _ctx, _tpGLPath * _path, cons
 
     if (!_bIsClipPath && (_style->fill.type == kTpPaintTypeGradient || _style->stroke.type == kTpPaintTypeGradient))
     {
+        if (_tpGLEnsureTextureProgram(_ctx))
+            return tpTrue;
         _TARP_ASSERT_NO_GL_ERROR(glBindBuffer(GL_ARRAY_BUFFER, _ctx->textureVao.vbo));
         _tpGLUpdateVAO(&_ctx->textureVao, p->textureGeometryCache.array, sizeof(_tpGLTextureVertex) * p->textureGeometryCache.count);
-        _TARP_ASSERT_NO_GL_ERROR(glBindBuffer(GL_ARRAY_BUFFER, _ctx->vao.vbo));
     }
 
-    /* upload the paths geometry cache to the gpu */
-    _tpGLUpdateVAO(&_ctx->vao, p->geometryCache.array, sizeof(tpVec2) * p->geometryCache.count);
+    /*
+    upload the out of date parts of the paths geometry cache to its buffer and source the
+    vertex positions from it.
+    */
+    if (_tpGLPathUpload(_ctx, p))
+        return tpTrue;
+    _TARP_ASSERT_NO_GL_ERROR(glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, ((char *)0)));
+
+    mvp = _style->scaleStroke ? transformProjection : &_ctx->projection;
+    _tpGLUploadMatrix(_ctx, _ctx->tpLoc, mvp);
 
+    /* the vertices of non scaling strokes are already transformed, so their paint is too */
     if (_style->scaleStroke)
-        _TARP_ASSERT_NO_GL_ERROR(glUniformMatrix4fv(_ctx->tpLoc, 1, GL_FALSE, &_ctx->transformProjection.v[0]));
+    {
+        fillPaintTransform = p->fillPaintTransform;
+        strokePaintTransform = p->strokePaintTransform;
+    }
     else
     {
-        _TARP_ASSERT_NO_GL_ERROR(glUniformMatrix4fv(_ctx->tpLoc, 1, GL_FALSE, &_ctx->projection.v[0]));
+        fillPaintTransform = tpTransformCombine(&transform, &p->fillPaintTransform);
+        strokePaintTransform = tpTransformCombine(&transform, &p->strokePaintTransform);
     }
 
     /* draw the fill */
+    if (!_bIsClipPath)
+        _ctx->debugPass = "fill";
     stencilPlaneToWriteTo = _bIsClipPath ? _ctx->currentClipStencilPlane : _kTpGLFillRasterStencilPlane;
     stencilPlaneToTestAgainst = _ctx->currentClipStencilPlane == _kTpGLClippingStencilPlaneOne ? _kTpGLClippingStencilPlaneTwo : _kTpGLClippingStencilPlaneOne;
 
     if (_bIsClipPath || _style->fill.type != kTpPaintTypeNone)
     {
+        if (_tpGLPathUpdateFillRanges(p))
+            return tpTrue;
+
         _TARP_ASSERT_NO_GL_ERROR(glStencilFunc(_ctx->clippingStackDepth ? GL_NOTEQUAL : GL_ALWAYS, 0, stencilPlaneToTestAgainst));
         _TARP_ASSERT_NO_GL_ERROR(glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE));
         if (_style->fillRule == kTpFillRuleEvenOdd)
@@ -3668,11 +7477,7 @@ TARP_LOCAL tpBool _tpGLDrawPathImpl(_tpGLContext * _ctx, _tpGLPath * _path, cons
             _TARP_ASSERT_NO_GL_ERROR(glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE));
             _TARP_ASSERT_NO_GL_ERROR(glStencilOp(GL_KEEP, GL_KEEP, GL_INVERT));
 
-            for (i = 0; i < p->contours.count; ++i)
-            {
-                _tpGLContour * c = _tpGLContourArrayAtPtr(&p->contours, i);
-                _TARP_ASSERT_NO_GL_ERROR(glDrawArrays(GL_TRIANGLE_FAN, c->fillVertexOffset, c->fillVertexCount));
-            }
+            _TARP_ASSERT_NO_GL_ERROR(glMultiDrawArrays(GL_TRIANGLE_FAN, p->fillFirsts.array, p->fillCounts.array, p->fillCounts.count));
 
             if (_bIsClipPath) return tpFalse;
 
@@ -3691,20 +7496,12 @@ TARP_LOCAL tpBool _tpGLDrawPathImpl(_tpGLContext * _ctx, _tpGLPath * _path, cons
             _TARP_ASSERT_NO_GL_ERROR(glCullFace(GL_BACK));
             _TARP_ASSERT_NO_GL_ERROR(glFrontFace(GL_CCW));
 
-            for (i = 0; i < p->contours.count; ++i)
-            {
-                _tpGLContour * c = _tpGLContourArrayAtPtr(&p->contours, i);
-                _TARP_ASSERT_NO_GL_ERROR(glDrawArrays(GL_TRIANGLE_FAN, c->fillVertexOffset, c->fillVertexCount));
-            }
+            _TARP_ASSERT_NO_GL_ERROR(glMultiDrawArrays(GL_TRIANGLE_FAN, p->fillFirsts.array, p->fillCounts.array, p->fillCounts.count));
 
             _TARP_ASSERT_NO_GL_ERROR(glFrontFace(GL_CW));
             _TARP_ASSERT_NO_GL_ERROR(glStencilOp(GL_KEEP, GL_KEEP, GL_DECR_WRAP));
 
-            for (i = 0; i < p->contours.count; ++i)
-            {
-                _tpGLContour * c = _tpGLContourArrayAtPtr(&p->contours, i);
-                _TARP_ASSERT_NO_GL_ERROR(glDrawArrays(GL_TRIANGLE_FAN, c->fillVertexOffset, c->fillVertexCount));
-            }
+            _TARP_ASSERT_NO_GL_ERROR(glMultiDrawArrays(GL_TRIANGLE_FAN, p->fillFirsts.array, p->fillCounts.array, p->fillCounts.count));
 
             _TARP_ASSERT_NO_GL_ERROR(glDisable(GL_CULL_FACE));
             _TARP_ASSERT_NO_GL_ERROR(glFrontFace(GL_CW));
@@ -3715,14 +7512,14 @@ TARP_LOCAL tpBool _tpGLDrawPathImpl(_tpGLContext * _ctx, _tpGLPath * _path, cons
                 _TARP_ASSERT_NO_GL_ERROR(glStencilFunc(GL_NOTEQUAL, 0, _kTpGLFillRasterStencilPlane));
                 _TARP_ASSERT_NO_GL_ERROR(glStencilOp(GL_KEEP, GL_KEEP, GL_INVERT));
 
-                _TARP_ASSERT_NO_GL_ERROR(glDrawArrays(GL_TRIANGLE_STRIP, p->boundsVertexOffset, 4));
+                _tpGLDrawCover(p);
 
                 /*
-                draw the bounds one last time to zero out the tmp data created in the _kTpGLFillRasterStencilPlane
+                draw the cover one last time to zero out the tmp data created in the _kTpGLFillRasterStencilPlane
                 */
                 _TARP_ASSERT_NO_GL_ERROR(glStencilMask(stencilPlaneToWriteTo));
                 _TARP_ASSERT_NO_GL_ERROR(glStencilOp(GL_ZERO, GL_ZERO, GL_ZERO));
-                _TARP_ASSERT_NO_GL_ERROR(glDrawArrays(GL_TRIANGLE_STRIP, p->boundsVertexOffset, 4));
+                _tpGLDrawCover(p);
 
                 return tpFalse;
             }
@@ -3735,7 +7532,7 @@ TARP_LOCAL tpBool _tpGLDrawPathImpl(_tpGLContext * _ctx, _tpGLPath * _path, cons
         _TARP_ASSERT_NO_GL_ERROR(glStencilMask(_kTpGLFillRasterStencilPlane));
         _TARP_ASSERT_NO_GL_ERROR(glStencilOp(GL_KEEP, GL_KEEP, GL_INVERT));
         _TARP_ASSERT_NO_GL_ERROR(glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE));
-        _tpGLDrawPaint(_ctx, p, &_style->fill, &p->fillGradientData);
+        _tpGLDrawPaint(_ctx, p, &_style->fill, &p->fillGradientData, &fillPaintTransform, mvp, transformProjection);
     }
 
     /* we don't care for stroke if this is a clipping path */
@@ -3744,6 +7541,15 @@ TARP_LOCAL tpBool _tpGLDrawPathImpl(_tpGLContext * _ctx, _tpGLPath * _path, cons
     /* draw the stroke */
     if (p->strokeVertexCount)
     {
+        _ctx->debugPass = "stroke";
+
+        /* the stroke is drawn one depth slot above the fill */
+        if (_ctx->bDepthTest)
+        {
+            _ctx->depth += 2.0f / TARP_GL_MAX_DEPTH_SLOTS;
+            _tpGLUploadMatrix(_ctx, _ctx->tpLoc, mvp);
+        }
+
         _TARP_ASSERT_NO_GL_ERROR(glStencilMask(_kTpGLStrokeRasterStencilPlane));
         _TARP_ASSERT_NO_GL_ERROR(glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE));
         _TARP_ASSERT_NO_GL_ERROR(glStencilFunc(_ctx->clippingStackDepth ? GL_NOTEQUAL : GL_ALWAYS, 0, stencilPlaneToTestAgainst));
@@ -3756,148 +7562,3252 @@ TARP_LOCAL tpBool _tpGLDrawPathImpl(_tpGLContext * _ctx, _tpGLPath * _path, cons
         _TARP_ASSERT_NO_GL_ERROR(glStencilFunc(GL_EQUAL, 0, _kTpGLStrokeRasterStencilPlane));
         _TARP_ASSERT_NO_GL_ERROR(glStencilOp(GL_KEEP, GL_KEEP, GL_INVERT));
 
-        _tpGLDrawPaint(_ctx, p, &_style->stroke, &p->strokeGradientData);
+        _tpGLDrawPaint(_ctx, p, &_style->stroke, &p->strokeGradientData, &strokePaintTransform, mvp, transformProjection);
     }
 
     /* WE DONE BABY */
     return tpFalse;
 }
 
-TARP_API tpBool tpDrawPath(tpContext _ctx, tpPath _path, const tpStyle * _style)
+TARP_LOCAL int _tpGLHashCombine(int _hash, int _value)
 {
-    return _tpGLDrawPathImpl((_tpGLContext *)_ctx.pointer, (_tpGLPath *)_path.pointer, _style, tpFalse);
+    return (int)(((unsigned int)_hash ^ (unsigned int)_value) * 16777619u);
 }
 
-TARP_LOCAL tpBool _tpGLGenerateClippingMask(_tpGLContext * _ctx, _tpGLPath * _path, tpBool _bIsRebuilding)
+TARP_LOCAL int _tpGLHashTransform(int _hash, const tpTransform * _transform)
 {
-    tpBool drawResult;
-    assert(_ctx);
-
-    if (!_bIsRebuilding)
-        _ctx->clippingStack[_ctx->clippingStackDepth++] = _path;
-
-    /*
-    @TODO: Instead of clearing maybe just clear it in endClipping by
-    drawing the bounds of the last clip path? could be a potential speed up
-    */
-    _TARP_ASSERT_NO_GL_ERROR(glStencilMask(_ctx->currentClipStencilPlane));
-    _TARP_ASSERT_NO_GL_ERROR(glClearStencil(0));
-    _TARP_ASSERT_NO_GL_ERROR(glClear(GL_STENCIL_BUFFER_BIT));
+    int i;
+    unsigned int bits[6];
+    memcpy(bits, _transform, sizeof(bits));
+    for (i = 0; i < 6; ++i)
+        _hash = _tpGLHashCombine(_hash, (int)bits[i]);
+    return _hash;
+}
 
-    /* draw path */
-    drawResult = _tpGLDrawPathImpl(_ctx, _path, &_ctx->clippingStyle, tpTrue);
-    if (drawResult) return tpTrue;
+/* maps a point to window pixels, returns tpTrue if it is behind the viewer */
+TARP_LOCAL tpBool _tpGLWindowPoint(const tpMat4 * _projection, const GLint * _viewport, tpVec2 _p, tpVec2 * _outPoint)
+{
+    const tpFloat * m = _projection->v;
+    tpFloat x = m[0] * _p.x + m[4] * _p.y + m[12];
+    tpFloat y = m[1] * _p.x + m[5] * _p.y + m[13];
+    tpFloat w = m[3] * _p.x + m[7] * _p.y + m[15];
 
-    _ctx->currentClipStencilPlane = _ctx->currentClipStencilPlane == _kTpGLClippingStencilPlaneOne ?
-                                    _kTpGLClippingStencilPlaneTwo : _kTpGLClippingStencilPlaneOne;
+    if (w <= 0)
+        return tpTrue;
+    *_outPoint = tpVec2Make(_viewport[0] + (x / w * 0.5f + 0.5f) * _viewport[2],
+                            _viewport[1] + (y / w * 0.5f + 0.5f) * _viewport[3]);
+    return tpFalse;
+}
 
+/* projects a rectangle to window pixels, returns tpTrue if any of it is behind the viewer */
+TARP_LOCAL tpBool _tpGLWindowRect(_tpGLContext * _ctx, const _tpGLRect * _rect, _tpGLRect * _outRect)
+{
+    int i;
+    tpVec2 corners[4], p;
+
+    _outRect->min = tpVec2Make(FLT_MAX, FLT_MAX);
+    _outRect->max = tpVec2Make(-FLT_MAX, -FLT_MAX);
+    corners[0] = _rect->min;
+    corners[1] = tpVec2Make(_rect->min.x, _rect->max.y);
+    corners[2] = tpVec2Make(_rect->max.x, _rect->min.y);
+    corners[3] = _rect->max;
+    for (i = 0; i < 4; ++i)
+    {
+        if (_tpGLWindowPoint(&_ctx->projection, _ctx->viewport, corners[i], &p))
+            return tpTrue;
+        _tpGLEvaluatePointForBounds(p, _outRect);
+    }
     return tpFalse;
 }
 
-TARP_API tpBool tpBeginClipping(tpContext _ctx, tpPath _path)
+/* projects a rectangle under the current transform to window pixels, conservatively rounded out */
+TARP_LOCAL void _tpGLWindowBounds(_tpGLContext * _ctx, const _tpGLRect * _rect, _tpGLRect * _outBounds)
 {
-    return _tpGLGenerateClippingMask((_tpGLContext *)_ctx.pointer, (_tpGLPath *)_path.pointer, tpFalse);
+    _outBounds->min = tpVec2Make(FLT_MAX, FLT_MAX);
+    _outBounds->max = tpVec2Make(-FLT_MAX, -FLT_MAX);
+    if (_rect->min.x > _rect->max.x)
+        return;
+
+    if (_tpGLWindowRect(_ctx, _rect, _outBounds))
+    {
+        /* behind the viewer, we simply assume it covers everything */
+        _outBounds->min = tpVec2Make(_ctx->viewport[0], _ctx->viewport[1]);
+        _outBounds->max = tpVec2Make(_ctx->viewport[0] + _ctx->viewport[2], _ctx->viewport[1] + _ctx->viewport[3]);
+        return;
+    }
+
+    /* one extra pixel for antialiasing */
+    _outBounds->min = tpVec2Make(floor(_outBounds->min.x) - 1, floor(_outBounds->min.y) - 1);
+    _outBounds->max = tpVec2Make(ceil(_outBounds->max.x) + 1, ceil(_outBounds->max.y) + 1);
 }
 
-TARP_API tpBool tpEndClipping(tpContext _ctx)
+/*
+checks if a path is smaller on screen than the minimum path size (see tpSetMinimumPathSize) and if so skips
+it or draws the quad approximating it. Returns tpTrue if the path was taken care of.
+*/
+TARP_LOCAL tpBool _tpGLDrawSmallPath(_tpGLContext * _ctx, _tpGLPath * _path, const tpStyle * _style)
 {
     int i;
-    _tpGLPath * p;
-    _tpGLContext * ctx = (_tpGLContext *)_ctx.pointer;
-    assert(ctx->clippingStackDepth);
-    p = ctx->clippingStack[--ctx->clippingStackDepth];
+    _tpGLRect bounds, windowRect;
+    tpVec2 size, center, quadSize;
+    tpColor color;
+    const tpPaint * paint;
+    tpMat4 windowProjection;
+    tpFloat vertices[8];
+    GLuint stencilPlaneToTestAgainst;
+
+    _tpGLPathTransformedBounds(_path, _style, &_ctx->transform, &bounds);
+    if (bounds.min.x > bounds.max.x)
+        return tpTrue;
+    if (_tpGLWindowRect(_ctx, &bounds, &windowRect))
+        return tpFalse;
+
+    size = tpVec2Sub(windowRect.max, windowRect.min);
+    if (size.x <= 0 || size.y <= 0)
+        return tpTrue;
+    if (size.x >= _ctx->minimumPathSize || size.y >= _ctx->minimumPathSize)
+        return tpFalse;
+    if (_ctx->smallPathMode == kTpSmallPathModeSkip)
+        return tpTrue;
 
-    if (ctx->clippingStackDepth)
+    paint = _style->fill.type != kTpPaintTypeNone ? &_style->fill : &_style->stroke;
+    if (paint->type == kTpPaintTypeNone)
+        return tpTrue;
+    /* the tile of a pattern might not even be rendered yet, so there is no color to approximate it with */
+    if (paint->type == kTpPaintTypePattern)
+        return tpFalse;
+    if (paint->type == kTpPaintTypeColor)
     {
-        /* check if the last clip mask is still in one of the clipping planes... */
-        if (ctx->bCanSwapStencilPlanes)
+        color = paint->data.color;
+    }
+    else
+    {
+        /* a gradient is approximated by the average of its stops */
+        _tpGLGradient * grad = (_tpGLGradient *)paint->data.gradient.pointer;
+        color = tpColorMake(0, 0, 0, 0);
+        for (i = 0; i < grad->stops.count; ++i)
         {
-            ctx->currentClipStencilPlane = ctx->currentClipStencilPlane == _kTpGLClippingStencilPlaneOne ?
-                                           _kTpGLClippingStencilPlaneTwo : _kTpGLClippingStencilPlaneOne;
-            ctx->bCanSwapStencilPlanes = tpFalse;
+            color.r += grad->stops.array[i].color.r;
+            color.g += grad->stops.array[i].color.g;
+            color.b += grad->stops.array[i].color.b;
+            color.a += grad->stops.array[i].color.a;
         }
-        else
+        if (grad->stops.count)
         {
-            /* ...otherwise rebuild it */
-            _TARP_ASSERT_NO_GL_ERROR(glStencilMask(_kTpGLClippingStencilPlaneOne | _kTpGLClippingStencilPlaneTwo));
-            _TARP_ASSERT_NO_GL_ERROR(glClearStencil(255));
-            _TARP_ASSERT_NO_GL_ERROR(glClear(GL_STENCIL_BUFFER_BIT));
+            color.r /= grad->stops.count;
+            color.g /= grad->stops.count;
+            color.b /= grad->stops.count;
+            color.a /= grad->stops.count;
+        }
+    }
 
-            for (i = 0; i < ctx->clippingStackDepth; ++i)
-            {
-                /* draw clip path */
-                _tpGLGenerateClippingMask(ctx, ctx->clippingStack[i], tpTrue);
-            }
+    /*
+    the quad covers at least one pixel so it does not fall between the samples, its opacity is scaled
+    down so that it covers about as much as the bounds of the path.
+    */
+    center = tpVec2MultScalar(tpVec2Add(windowRect.min, windowRect.max), 0.5f);
+    quadSize = tpVec2Make(TARP_MAX(size.x, 1), TARP_MAX(size.y, 1));
+    color.a *= (size.x * size.y) / (quadSize.x * quadSize.y);
+    vertices[0] = center.x - quadSize.x * 0.5f; vertices[1] = center.y - quadSize.y * 0.5f;
+    vertices[2] = center.x - quadSize.x * 0.5f; vertices[3] = center.y + quadSize.y * 0.5f;
+    vertices[4] = center.x + quadSize.x * 0.5f; vertices[5] = center.y - quadSize.y * 0.5f;
+    vertices[6] = center.x + quadSize.x * 0.5f; vertices[7] = center.y + quadSize.y * 0.5f;
+
+    _ctx->debugPass = "approximation";
+    _ctx->debugObject = _path;
+
+    windowProjection = tpMat4MakeOrtho(_ctx->viewport[0], _ctx->viewport[0] + _ctx->viewport[2],
+                                       _ctx->viewport[1], _ctx->viewport[1] + _ctx->viewport[3], -1, 1);
+    _tpGLUploadMatrix(_ctx, _ctx->tpLoc, &windowProjection);
+    _TARP_ASSERT_NO_GL_ERROR(glBindBuffer(GL_ARRAY_BUFFER, _ctx->vao.vbo));
+    _tpGLUpdateVAO(&_ctx->vao, vertices, sizeof(vertices));
+    _TARP_ASSERT_NO_GL_ERROR(glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, ((char *)0)));
 
-            ctx->bCanSwapStencilPlanes = tpTrue;
-        }
+    /* only test against the clipping planes */
+    stencilPlaneToTestAgainst = _ctx->currentClipStencilPlane == _kTpGLClippingStencilPlaneOne ? _kTpGLClippingStencilPlaneTwo : _kTpGLClippingStencilPlaneOne;
+    _TARP_ASSERT_NO_GL_ERROR(glStencilMask(0));
+    _TARP_ASSERT_NO_GL_ERROR(glStencilFunc(_ctx->clippingStackDepth ? GL_NOTEQUAL : GL_ALWAYS, 0, stencilPlaneToTestAgainst));
+    _TARP_ASSERT_NO_GL_ERROR(glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE));
+    _TARP_ASSERT_NO_GL_ERROR(glUniform4fv(_ctx->meshColorLoc, 1, &color.r));
+    _TARP_ASSERT_NO_GL_ERROR(glDrawArrays(GL_TRIANGLE_STRIP, 0, 4));
+
+    return tpTrue;
+}
+
+TARP_LOCAL unsigned int _tpGLGlyphHash(int _id)
+{
+    return (unsigned int)_id * 2654435761u;
+}
+
+/* returns the glyph with the id or NULL if it was not added to the cache */
+TARP_LOCAL _tpGLGlyph * _tpGLGlyphCacheFind(_tpGLGlyphCache * _cache, int _id)
+{
+    unsigned int i, mask;
+
+    if (!_cache->slotCapacity)
+        return NULL;
+
+    mask = _cache->slotCapacity - 1;
+    for (i = _tpGLGlyphHash(_id) & mask; _cache->slots[i]; i = (i + 1) & mask)
+    {
+        if (_cache->glyphs.array[_cache->slots[i] - 1].id == _id)
+            return &_cache->glyphs.array[_cache->slots[i] - 1];
     }
-    else
+    return NULL;
+}
+
+/* adds the last glyph to the id table. Glyphs are never removed from it, only replaced. */
+TARP_LOCAL tpBool _tpGLGlyphCacheAddSlot(_tpGLGlyphCache * _cache)
+{
+    int i, capacity;
+    unsigned int j, mask;
+    int * slots;
+
+    if (_cache->glyphs.count * 2 > _cache->slotCapacity)
     {
-        /*
-        @TODO: Instead of clearing maybe just redrawing the clipping path bounds to
-        reset the stencil? Might scale better for a lot of paths :)
-        */
-        _TARP_ASSERT_NO_GL_ERROR(glStencilMask(_kTpGLClippingStencilPlaneOne | _kTpGLClippingStencilPlaneTwo));
-        _TARP_ASSERT_NO_GL_ERROR(glClearStencil(255));
-        _TARP_ASSERT_NO_GL_ERROR(glClear(GL_STENCIL_BUFFER_BIT));
+        capacity = _cache->slotCapacity ? _cache->slotCapacity * 2 : 64;
+        slots = (int *)TARP_MALLOC(sizeof(int) * capacity);
+        if (!slots)
+            return tpTrue;
+        memset(slots, 0, sizeof(int) * capacity);
+
+        if (_cache->slots)
+            TARP_FREE(_cache->slots);
+        _cache->slots = slots;
+        _cache->slotCapacity = capacity;
+
+        /* rehash everything, including the new glyph */
+        mask = capacity - 1;
+        for (i = 0; i < _cache->glyphs.count; ++i)
+        {
+            for (j = _tpGLGlyphHash(_cache->glyphs.array[i].id) & mask; slots[j]; j = (j + 1) & mask);
+            slots[j] = i + 1;
+        }
+        return tpFalse;
     }
 
+    mask = _cache->slotCapacity - 1;
+    for (j = _tpGLGlyphHash(_tpGLGlyphArrayLastPtr(&_cache->glyphs)->id) & mask; _cache->slots[j]; j = (j + 1) & mask);
+    _cache->slots[j] = _cache->glyphs.count;
     return tpFalse;
 }
 
-TARP_API tpBool tpResetClipping(tpContext _ctx)
+TARP_LOCAL void _tpGLGlyphResetGeometry(_tpGLGlyph * _glyph)
 {
-    _tpGLContext * ctx = (_tpGLContext *)_ctx.pointer;
-    _TARP_ASSERT_NO_GL_ERROR(glStencilMask(_kTpGLClippingStencilPlaneOne | _kTpGLClippingStencilPlaneTwo));
-    _TARP_ASSERT_NO_GL_ERROR(glClearStencil(0));
-    _TARP_ASSERT_NO_GL_ERROR(glClear(GL_STENCIL_BUFFER_BIT));
+    int i;
+    for (i = 0; i < TARP_GL_GLYPH_SIZE_BUCKETS; ++i)
+    {
+        _glyph->vertexOffsets[i] = -1;
+        _glyph->vertexCounts[i] = 0;
+    }
+}
 
-    ctx->currentClipStencilPlane = _kTpGLClippingStencilPlaneOne;
-    ctx->clippingStackDepth = 0;
+TARP_API tpGlyphCache tpGlyphCacheCreate(tpFloat _unitsPerEm)
+{
+    tpGlyphCache ret = {NULL};
+    _tpGLGlyphCache * cache;
 
-    return tpFalse;
+    if (_unitsPerEm <= 0)
+    {
+        _tpGLSetErrorMessage("The units per em of a glyph cache have to be bigger than zero.");
+        return ret;
+    }
+
+    cache = (_tpGLGlyphCache *)TARP_MALLOC(sizeof(_tpGLGlyphCache));
+    if (!cache)
+        return ret;
+    memset(cache, 0, sizeof(_tpGLGlyphCache));
+    cache->unitsPerEm = _unitsPerEm;
+    cache->version = _tpGLNextVersion();
+
+    ret.pointer = cache;
+    return ret;
 }
 
-TARP_API tpBool tpSetProjection(tpContext _ctx, const tpMat4 * _projection)
+TARP_API void tpGlyphCacheDestroy(tpGlyphCache _cache)
 {
-    _tpGLContext * ctx = (_tpGLContext *)_ctx.pointer;
-    ctx->projection = *_projection;
-    ctx->projectionID++;
-    ctx->bTransformProjDirty = tpTrue;
-
-    return tpFalse;
+    int i;
+    _tpGLGlyphCache * cache = (_tpGLGlyphCache *)_cache.pointer;
+    if (cache)
+    {
+        _tpGLReleaseBuffer(&cache->buffer);
+        for (i = 0; i < cache->glyphs.count; ++i)
+            tpPathDestroy(cache->glyphs.array[i].path);
+        _tpGLGlyphArrayDeallocate(&cache->glyphs);
+        _tpVec2ArrayDeallocate(&cache->vertices);
+        if (cache->slots)
+            TARP_FREE(cache->slots);
+        TARP_FREE(cache);
+    }
 }
 
-TARP_API tpBool tpSetTransform(tpContext _ctx, const tpTransform * _transform)
+/*
+adds a glyph outline to _path. Paths store every curve as a cubic and tpPathQuadraticCurveTo uses the control
+point for both handles, which is too far off for the quadratic outlines of TrueType fonts. The quadratics are
+therefore elevated to the exact cubic first.
+*/
+TARP_LOCAL tpBool _tpGLGlyphAddOutline(tpPath _path, const tpPathCommand * _commands, int _commandCount,
+                                       const tpFloat * _coords, int _coordCount)
 {
-    tpFloat rotation;
-    _tpGLContext * ctx = (_tpGLContext *)_ctx.pointer;
+    int i, j, k, n, quadCount;
+    tpVec2 cur, start, h;
+    tpPathCommand * cmds;
+    tpFloat * coords;
+    tpBool ret;
 
-    if (!tpTransformEquals(_transform, &ctx->transform))
+    quadCount = 0;
+    for (i = 0; i < _commandCount; ++i)
     {
-        tpVec2 scale, skew, translation;
-        ctx->transform = *_transform;
-        ctx->transformID++;
-        ctx->bTransformProjDirty = tpTrue;
+        if (_commands[i] == kTpPathCommandQuadraticCurveTo)
+            ++quadCount;
+    }
+    if (!quadCount)
+        return tpPathAddCommands(_path, _commands, _commandCount, _coords, _coordCount);
 
-        tpTransformDecompose(_transform, &translation, &scale, &skew, &rotation);
-        ctx->transformScale = TARP_MAX(scale.x, scale.y);
+    cmds = (tpPathCommand *)TARP_MALLOC(sizeof(tpPathCommand) * _commandCount);
+    coords = (tpFloat *)TARP_MALLOC(sizeof(tpFloat) * (_coordCount + quadCount * 2));
+    if (!cmds || !coords)
+    {
+        if (cmds)
+            TARP_FREE(cmds);
+        if (coords)
+            TARP_FREE(coords);
+        _tpGLSetErrorMessage("Could not allocate memory for the glyph.");
+        return tpTrue;
     }
 
-    return tpFalse;
-}
+    cur = start = tpVec2Make(0, 0);
+    for (i = 0, j = 0, k = 0; i < _commandCount; ++i, j += n)
+    {
+        n = _commands[i] == kTpPathCommandClose ? 0 : _commands[i] == kTpPathCommandQuadraticCurveTo ? 4 :
+            _commands[i] == kTpPathCommandCubicCurveTo ? 6 : 2;
+        if (!_coords || j + n > _coordCount)
+            break;
 
-TARP_API tpBool tpResetTransform(tpContext _ctx)
-{
-    _tpGLContext * ctx = (_tpGLContext *)_ctx.pointer;
-    ctx->transform = tpTransformMakeIdentity();
+        cmds[i] = _commands[i];
+        if (_commands[i] == kTpPathCommandQuadraticCurveTo)
+        {
+            /* the cubic handles are two thirds of the way from the end points to the quadratic control point */
+            h = tpVec2Make(_coords[j], _coords[j + 1]);
+            cmds[i] = kTpPathCommandCubicCurveTo;
+            coords[k++] = cur.x + (h.x - cur.x) * 2.0f / 3.0f;
+            coords[k++] = cur.y + (h.y - cur.y) * 2.0f / 3.0f;
+            cur = tpVec2Make(_coords[j + 2], _coords[j + 3]);
+            coords[k++] = cur.x + (h.x - cur.x) * 2.0f / 3.0f;
+            coords[k++] = cur.y + (h.y - cur.y) * 2.0f / 3.0f;
+            coords[k++] = cur.x;
+            coords[k++] = cur.y;
+            continue;
+        }
+
+        memcpy(coords + k, _coords + j, sizeof(tpFloat) * n);
+        k += n;
+        if (_commands[i] == kTpPathCommandClose)
+            cur = start;
+        else
+            cur = tpVec2Make(_coords[j + n - 2], _coords[j + n - 1]);
+        if (_commands[i] == kTpPathCommandMoveTo)
+            start = cur;
+    }
+
+    /* let tpPathAddCommands report coordinate count mismatches */
+    if (i < _commandCount || j != _coordCount)
+        ret = tpPathAddCommands(_path, _commands, _commandCount, _coords, _coordCount);
+    else
+        ret = tpPathAddCommands(_path, cmds, _commandCount, coords, k);
+
+    TARP_FREE(cmds);
+    TARP_FREE(coords);
+    return ret;
+}
+
+TARP_API tpBool tpGlyphCacheAddGlyph(tpGlyphCache _cache, int _glyph, const tpPathCommand * _commands, int _commandCount,
+                                     const tpFloat * _coords, int _coordCount)
+{
+    int i;
+    tpPath path;
+    tpStyle style;
+    _tpGLGlyph g, * glyph;
+    _tpGLGlyphCache * cache = (_tpGLGlyphCache *)_cache.pointer;
+
+    if (!cache || _commandCount < 0 || (_commandCount && !_commands))
+    {
+        _tpGLSetErrorMessage("tpGlyphCacheAddGlyph failed because of invalid arguments.");
+        return tpTrue;
+    }
+
+    /* glyphs without an outline, like spaces, are added with an empty path */
+    path = tpPathCreate();
+    if (_commandCount && _tpGLGlyphAddOutline(path, _commands, _commandCount, _coords, _coordCount))
+    {
+        tpPathDestroy(path);
+        return tpTrue;
+    }
+
+    glyph = _tpGLGlyphCacheFind(cache, _glyph);
+    if (glyph)
+    {
+        /* the old triangles can't be taken out of the vertices, so all glyphs are flattened again */
+        tpPathDestroy(glyph->path);
+        for (i = 0; i < cache->glyphs.count; ++i)
+            _tpGLGlyphResetGeometry(&cache->glyphs.array[i]);
+        _tpVec2ArrayClear(&cache->vertices);
+        cache->uploadedVertexCount = 0;
+    }
+    else
+    {
+        memset(&g, 0, sizeof(g));
+        g.id = _glyph;
+        if (_tpGLGlyphArrayAppendPtr(&cache->glyphs, &g))
+        {
+            tpPathDestroy(path);
+            _tpGLSetErrorMessage("Could not allocate memory for the glyph.");
+            return tpTrue;
+        }
+        if (_tpGLGlyphCacheAddSlot(cache))
+        {
+            _tpGLGlyphArrayRemove(&cache->glyphs, cache->glyphs.count - 1);
+            tpPathDestroy(path);
+            _tpGLSetErrorMessage("Could not allocate memory for the glyph.");
+            return tpTrue;
+        }
+        glyph = _tpGLGlyphArrayLastPtr(&cache->glyphs);
+    }
+
+    glyph->path = path;
+    _tpGLGlyphResetGeometry(glyph);
+    style = tpStyleMake();
+    style.stroke.type = kTpPaintTypeNone;
+    _tpGLPathTransformedBounds((_tpGLPath *)path.pointer, &style, NULL, &glyph->bounds);
+    cache->version = _tpGLNextVersion();
+    return tpFalse;
+}
+
+TARP_API tpBool tpGlyphCacheHasGlyph(tpGlyphCache _cache, int _glyph)
+{
+    return (tpBool)(_tpGLGlyphCacheFind((_tpGLGlyphCache *)_cache.pointer, _glyph) != NULL);
+}
+
+/*
+the bounds of a run of glyphs drawn with _scale font units per run unit, optionally transformed. Only the
+control point bounds of the outlines are used, nothing is flattened.
+*/
+TARP_LOCAL void _tpGLGlyphRunBounds(_tpGLGlyphCache * _cache, const tpGlyphInstance * _glyphs, int _count, tpFloat _scale,
+                                    const tpTransform * _transform, _tpGLRect * _outBounds)
+{
+    int i;
+    _tpGLRect b;
+    _tpGLGlyph * glyph;
+    tpVec2 corners[4];
+
+    _tpGLInitBounds(&b);
+    for (i = 0; i < _count; ++i)
+    {
+        glyph = _tpGLGlyphCacheFind(_cache, _glyphs[i].glyph);
+        if (!glyph || glyph->bounds.min.x > glyph->bounds.max.x)
+            continue;
+
+        /* the outlines are flipped vertically */
+        _tpGLEvaluatePointForBounds(tpVec2Make(_glyphs[i].x + glyph->bounds.min.x * _scale,
+                                               _glyphs[i].y - glyph->bounds.max.y * _scale), &b);
+        _tpGLEvaluatePointForBounds(tpVec2Make(_glyphs[i].x + glyph->bounds.max.x * _scale,
+                                               _glyphs[i].y - glyph->bounds.min.y * _scale), &b);
+    }
+
+    if (!_transform || b.min.x > b.max.x)
+    {
+        *_outBounds = b;
+        return;
+    }
+
+    corners[0] = b.min;
+    corners[1] = tpVec2Make(b.min.x, b.max.y);
+    corners[2] = tpVec2Make(b.max.x, b.min.y);
+    corners[3] = b.max;
+    _tpGLInitBounds(_outBounds);
+    for (i = 0; i < 4; ++i)
+        _tpGLEvaluatePointForBounds(tpTransformApply(_transform, corners[i]), _outBounds);
+}
+
+/*
+flattens the outline of a glyph for a size bucket and appends it to the vertices of the cache. The bucket
+covers the pixels per em up to 2^_bucket, which is the size the outline is flattened for.
+*/
+TARP_LOCAL tpBool _tpGLGlyphCacheBuild(_tpGLContext * _ctx, _tpGLGlyphCache * _cache, _tpGLGlyph * _glyph, int _bucket)
+{
+    int i, j, count, offset;
+    tpFloat scale;
+    _tpGLRect bounds;
+    _tpGLContour * c;
+    tpVec2 * v, * out;
+    _tpGLPath * p = (_tpGLPath *)_glyph->path.pointer;
+
+    scale = (tpFloat)ldexp(1.0, _bucket) / _cache->unitsPerEm;
+    _tpGLMarkPathGeometryDirty(p);
+    _tpVec2ArrayClear(&_ctx->tmpVertices);
+    _tpBoolArrayClear(&_ctx->tmpJoints);
+    if (_tpGLFlattenPath(p, 0.15f / (scale * p->quality.curveQuality), 0, NULL, &_ctx->tmpVertices, &_ctx->tmpJoints, &bounds))
+        return tpTrue;
+
+    /* the triangle fans of the contours are turned into one triangle list, so the glyph is a single draw */
+    count = 0;
+    for (i = 0; i < p->contours.count; ++i)
+    {
+        c = _tpGLContourArrayAtPtr(&p->contours, i);
+        if (c->fillVertexCount > 2)
+            count += (c->fillVertexCount - 2) * 3;
+    }
+
+    offset = _cache->vertices.count;
+    if (offset + count > _cache->vertices.capacity &&
+            _tpVec2ArrayReserve(&_cache->vertices, TARP_MAX(offset + count, _cache->vertices.capacity * 2)))
+    {
+        _tpGLSetErrorMessage("Could not allocate memory for the glyph geometry.");
+        return tpTrue;
+    }
+
+    out = _cache->vertices.array + offset;
+    for (i = 0; i < p->contours.count; ++i)
+    {
+        c = _tpGLContourArrayAtPtr(&p->contours, i);
+        v = _ctx->tmpVertices.array + c->fillVertexOffset;
+        for (j = 1; j < c->fillVertexCount - 1; ++j)
+        {
+            *out++ = v[0];
+            *out++ = v[j];
+            *out++ = v[j + 1];
+        }
+    }
+    _cache->vertices.count += count;
+
+    _glyph->vertexOffsets[_bucket] = offset;
+    _glyph->vertexCounts[_bucket] = count;
+    return tpFalse;
+}
+
+/*
+uploads the vertices that were added to the cache since the last upload to its buffer in _ctx, or all of
+them if it was last drawn in another context.
+*/
+TARP_LOCAL tpBool _tpGLGlyphCacheUpload(_tpGLContext * _ctx, _tpGLGlyphCache * _cache)
+{
+    int count = _cache->vertices.count;
+    _tpGLBuffer * buffer;
+    tpBool bClaimed;
+
+    if (_tpGLBindBuffer(_ctx, &_cache->buffer, "tarp glyph cache", _cache, &bClaimed))
+        return tpTrue;
+    buffer = _tpGLBufferArrayAtPtr(&_ctx->buffers, _cache->buffer.index);
+    if (bClaimed)
+        _cache->uploadedVertexCount = 0;
+
+    if (count > buffer->vertexCapacity)
+    {
+        buffer->vertexCapacity = TARP_MAX(count, buffer->vertexCapacity * 2);
+        _TARP_ASSERT_NO_GL_ERROR(glBufferData(GL_ARRAY_BUFFER, sizeof(tpVec2) * buffer->vertexCapacity, NULL, GL_STATIC_DRAW));
+        _TARP_ASSERT_NO_GL_ERROR(glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(tpVec2) * count, _cache->vertices.array));
+    }
+    else if (count > _cache->uploadedVertexCount)
+    {
+        _TARP_ASSERT_NO_GL_ERROR(glBufferSubData(GL_ARRAY_BUFFER, sizeof(tpVec2) * _cache->uploadedVertexCount,
+                                 sizeof(tpVec2) * (count - _cache->uploadedVertexCount),
+                                 _cache->vertices.array + _cache->uploadedVertexCount));
+    }
+    _cache->uploadedVertexCount = count;
+    return tpFalse;
+}
+
+TARP_LOCAL int _tpGLGlyphInstanceComp(const void * _a, const void * _b)
+{
+    const tpGlyphInstance * a = (const tpGlyphInstance *)_a;
+    const tpGlyphInstance * b = (const tpGlyphInstance *)_b;
+    return a->glyph < b->glyph ? -1 : a->glyph > b->glyph;
+}
+
+/*
+draws a run of glyphs. The occurrences of a glyph are drawn with one instanced draw (in batches of
+TARP_GL_GLYPH_BATCH_SIZE) that accumulates the non zero winding of all glyphs in the fill plane. A single
+quad covering the whole run then fills it and resets the plane.
+*/
+TARP_LOCAL tpBool _tpGLDrawGlyphRunImpl(_tpGLContext * _ctx, _tpGLGlyphCache * _cache, const tpGlyphInstance * _glyphs,
+                                        int _count, tpFloat _size, tpColor _color)
+{
+    int i, j, k, l, n, bucket;
+    tpFloat scale;
+    GLuint stencilPlaneToTestAgainst;
+    tpFloat offsets[TARP_GL_GLYPH_BATCH_SIZE * 2];
+    tpFloat vertices[8];
+    _tpGLRect bounds;
+    _tpGLGlyph * glyph;
+    tpGlyphInstance * glyphs;
+
+    scale = _size / _cache->unitsPerEm;
+    _tpGLGlyphRunBounds(_cache, _glyphs, _count, scale, NULL, &bounds);
+    if (bounds.min.x > bounds.max.x)
+        return tpFalse;
+
+    if (_tpGLEnsureGlyphProgram(_ctx))
+        return tpTrue;
+
+    if (_ctx->bTransformProjDirty)
+    {
+        _ctx->bTransformProjDirty = tpFalse;
+        _ctx->renderTransform = tpMat4MakeFrom2DTransform(&_ctx->transform);
+        _ctx->transformProjection = tpMat4Mult(&_ctx->projection, &_ctx->renderTransform);
+    }
+
+    /* the bucket is the next power of two of the pixels per em */
+    frexp(_size * _ctx->transformScale, &bucket);
+    bucket = TARP_MAX(0, TARP_MIN(bucket, TARP_GL_GLYPH_SIZE_BUCKETS - 1));
+
+    /* sort the glyphs so that all occurrences of a glyph are next to each other */
+    _tpGlyphInstanceArrayClear(&_ctx->tmpGlyphs);
+    if (_tpGlyphInstanceArrayAppendArray(&_ctx->tmpGlyphs, (tpGlyphInstance *)_glyphs, _count))
+    {
+        _tpGLSetErrorMessage("Could not allocate memory for the glyph run.");
+        return tpTrue;
+    }
+    glyphs = _ctx->tmpGlyphs.array;
+    qsort(glyphs, _count, sizeof(tpGlyphInstance), _tpGLGlyphInstanceComp);
+
+    /* flatten the glyphs that were not drawn at this size before */
+    for (i = 0; i < _count; i = j)
+    {
+        for (j = i + 1; j < _count && glyphs[j].glyph == glyphs[i].glyph; ++j);
+        glyph = _tpGLGlyphCacheFind(_cache, glyphs[i].glyph);
+        if (glyph && glyph->vertexOffsets[bucket] == -1 && _tpGLGlyphCacheBuild(_ctx, _cache, glyph, bucket))
+            return tpTrue;
+    }
+
+    _ctx->debugPass = "glyph run";
+    _ctx->debugObject = _cache;
+
+    if (_tpGLGlyphCacheUpload(_ctx, _cache))
+        return tpTrue;
+    _TARP_ASSERT_NO_GL_ERROR(glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, ((char *)0)));
+    _TARP_ASSERT_NO_GL_ERROR(glUseProgram(_ctx->glyphProgram));
+    _tpGLUploadMatrix(_ctx, _ctx->tpGlyphLoc, &_ctx->transformProjection);
+    _TARP_ASSERT_NO_GL_ERROR(glUniform1f(_ctx->glyphScaleLoc, scale));
+
+    /* front faces increment and back faces decrement the fill plane, so the non zero rule needs only one pass */
+    stencilPlaneToTestAgainst = _ctx->currentClipStencilPlane == _kTpGLClippingStencilPlaneOne ? _kTpGLClippingStencilPlaneTwo : _kTpGLClippingStencilPlaneOne;
+    _TARP_ASSERT_NO_GL_ERROR(glStencilFunc(_ctx->clippingStackDepth ? GL_NOTEQUAL : GL_ALWAYS, 0, stencilPlaneToTestAgainst));
+    _TARP_ASSERT_NO_GL_ERROR(glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE));
+    _TARP_ASSERT_NO_GL_ERROR(glStencilMask(_kTpGLFillRasterStencilPlane));
+    _TARP_ASSERT_NO_GL_ERROR(glStencilOpSeparate(GL_FRONT, GL_KEEP, GL_KEEP, GL_INCR_WRAP));
+    _TARP_ASSERT_NO_GL_ERROR(glStencilOpSeparate(GL_BACK, GL_KEEP, GL_KEEP, GL_DECR_WRAP));
+
+    for (i = 0; i < _count; i = j)
+    {
+        for (j = i + 1; j < _count && glyphs[j].glyph == glyphs[i].glyph; ++j);
+        glyph = _tpGLGlyphCacheFind(_cache, glyphs[i].glyph);
+        if (!glyph || !glyph->vertexCounts[bucket])
+            continue;
+
+        for (k = i; k < j; k += n)
+        {
+            n = TARP_MIN(j - k, TARP_GL_GLYPH_BATCH_SIZE);
+            for (l = 0; l < n; ++l)
+            {
+                offsets[l * 2] = glyphs[k + l].x;
+                offsets[l * 2 + 1] = glyphs[k + l].y;
+            }
+            _TARP_ASSERT_NO_GL_ERROR(glUniform4fv(_ctx->glyphOffsetsLoc, (n + 1) / 2, offsets));
+            _TARP_ASSERT_NO_GL_ERROR(glDrawArraysInstanced(GL_TRIANGLES, glyph->vertexOffsets[bucket], glyph->vertexCounts[bucket], n));
+        }
+    }
+
+    /* cover the run, replacing the winding with the value the fill plane is cleared to */
+    vertices[0] = bounds.min.x; vertices[1] = bounds.min.y;
+    vertices[2] = bounds.min.x; vertices[3] = bounds.max.y;
+    vertices[4] = bounds.max.x; vertices[5] = bounds.min.y;
+    vertices[6] = bounds.max.x; vertices[7] = bounds.max.y;
+
+    _TARP_ASSERT_NO_GL_ERROR(glUseProgram(_ctx->program));
+    _tpGLUploadMatrix(_ctx, _ctx->tpLoc, &_ctx->transformProjection);
+    _TARP_ASSERT_NO_GL_ERROR(glBindBuffer(GL_ARRAY_BUFFER, _ctx->vao.vbo));
+    _tpGLUpdateVAO(&_ctx->vao, vertices, sizeof(vertices));
+    _TARP_ASSERT_NO_GL_ERROR(glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, ((char *)0)));
+
+    _TARP_ASSERT_NO_GL_ERROR(glStencilFunc(GL_NOTEQUAL, 255, _kTpGLFillRasterStencilPlane));
+    _TARP_ASSERT_NO_GL_ERROR(glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE));
+    _TARP_ASSERT_NO_GL_ERROR(glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE));
+    _TARP_ASSERT_NO_GL_ERROR(glUniform4fv(_ctx->meshColorLoc, 1, &_color.r));
+    if (_ctx->bDepthTest && _ctx->bDepthWrite)
+        _TARP_ASSERT_NO_GL_ERROR(glDepthMask(GL_TRUE));
+    _TARP_ASSERT_NO_GL_ERROR(glDrawArrays(GL_TRIANGLE_STRIP, 0, 4));
+    if (_ctx->bDepthTest && _ctx->bDepthWrite)
+        _TARP_ASSERT_NO_GL_ERROR(glDepthMask(GL_FALSE));
+
+    return tpFalse;
+}
+
+TARP_LOCAL tpBool _tpGLRecordGlyphRun(_tpGLContext * _ctx, _tpGLGlyphCache * _cache, const tpGlyphInstance * _glyphs,
+                                      int _count, tpFloat _size, tpColor _color)
+{
+    _tpGLCommand cmd;
+    _tpGLRect bounds;
+    _tpGLCommandList * list = _ctx->recordList;
+
+    memset(&cmd, 0, sizeof(cmd));
+    cmd.type = _kTpGLCommandDrawGlyphRun;
+    cmd.glyphCache = _cache;
+    cmd.version = _cache->version;
+    cmd.glyphStart = list->glyphs.count;
+    cmd.glyphCount = _count;
+    cmd.glyphSize = _size;
+    cmd.style = tpStyleMake();
+    cmd.style.fill = tpPaintMakeColor(_color.r, _color.g, _color.b, _color.a);
+    cmd.style.stroke.type = kTpPaintTypeNone;
+    cmd.transform = _ctx->transform;
+    cmd.projection = _ctx->projection;
+    cmd.clipSignature = list->clipSignatures[list->clippingDepth];
+    cmd.match = -1;
+
+    if (_count && _tpGlyphInstanceArrayAppendArray(&list->glyphs, (tpGlyphInstance *)_glyphs, _count))
+    {
+        _tpGLSetErrorMessage("Could not allocate memory for the recorded commands.");
+        return tpTrue;
+    }
+
+    _tpGLGlyphRunBounds(_cache, _glyphs, _count, _size / _cache->unitsPerEm, &_ctx->transform, &bounds);
+    if (list->bWindowBounds)
+        _tpGLWindowBounds(_ctx, &bounds, &cmd.bounds);
+    else
+        cmd.bounds = bounds;
+
+    if (_tpGLCommandArrayAppendPtr(&list->commands, &cmd))
+    {
+        _tpGLSetErrorMessage("Could not allocate memory for the recorded commands.");
+        return tpTrue;
+    }
+    return tpFalse;
+}
+
+TARP_LOCAL void _tpGLLayerUpdate(_tpGLLayer * _layer);
+
+/*
+returns the version of the gradient or pattern of a paint, which changes whenever what it paints changes.
+The tile of a pattern is brought up to date with its paths first.
+*/
+TARP_LOCAL int _tpGLPaintVersion(const tpPaint * _paint)
+{
+    if (_paint->type == kTpPaintTypeGradient)
+        return ((_tpGLGradient *)_paint->data.gradient.pointer)->version;
+    if (_paint->type == kTpPaintTypePattern)
+    {
+        _tpGLLayerUpdate((_tpGLLayer *)_paint->data.pattern.pointer);
+        return ((_tpGLLayer *)_paint->data.pattern.pointer)->version;
+    }
+    return 0;
+}
+
+/*
+brings the recorded versions and bounds of a layer up to date with its paths, gradients and patterns and
+marks it dirty if anything changed.
+*/
+TARP_LOCAL void _tpGLLayerUpdate(_tpGLLayer * _layer)
+{
+    int i;
+    tpBool bChanged = tpFalse;
+    _tpGLCommand * cmd;
+
+    for (i = 0; i < _layer->list.commands.count; ++i)
+    {
+        cmd = &_layer->list.commands.array[i];
+        if (cmd->glyphCache)
+        {
+            if (cmd->version != cmd->glyphCache->version)
+            {
+                cmd->version = cmd->glyphCache->version;
+                _tpGLGlyphRunBounds(cmd->glyphCache, _layer->list.glyphs.array + cmd->glyphStart, cmd->glyphCount,
+                                    cmd->glyphSize / cmd->glyphCache->unitsPerEm, &cmd->transform, &cmd->bounds);
+                bChanged = tpTrue;
+            }
+            continue;
+        }
+        if (!cmd->path)
+            continue;
+
+        if (cmd->version != cmd->path->version ||
+                cmd->fillPaintVersion != _tpGLPaintVersion(&cmd->style.fill) ||
+                cmd->strokePaintVersion != _tpGLPaintVersion(&cmd->style.stroke))
+        {
+            cmd->version = cmd->path->version;
+            cmd->fillPaintVersion = _tpGLPaintVersion(&cmd->style.fill);
+            cmd->strokePaintVersion = _tpGLPaintVersion(&cmd->style.stroke);
+            _tpGLPathTransformedBounds(cmd->path, &cmd->style, &cmd->transform, &cmd->bounds);
+            bChanged = tpTrue;
+        }
+    }
+
+    /* the bounds of a tile are fixed */
+    if (bChanged && _layer->bTile)
+    {
+        _layer->version = _tpGLNextVersion();
+        _layer->bDirty = tpTrue;
+    }
+    else if (bChanged)
+    {
+        _layer->bounds.min = tpVec2Make(FLT_MAX, FLT_MAX);
+        _layer->bounds.max = tpVec2Make(-FLT_MAX, -FLT_MAX);
+        for (i = 0; i < _layer->list.commands.count; ++i)
+        {
+            cmd = &_layer->list.commands.array[i];
+            if ((cmd->type == _kTpGLCommandDrawPath || cmd->type == _kTpGLCommandDrawGlyphRun) && cmd->bounds.min.x <= cmd->bounds.max.x)
+            {
+                _tpGLEvaluatePointForBounds(cmd->bounds.min, &_layer->bounds);
+                _tpGLEvaluatePointForBounds(cmd->bounds.max, &_layer->bounds);
+            }
+        }
+        _layer->version = _tpGLNextVersion();
+        _layer->bDirty = tpTrue;
+    }
+}
+
+/* stores the path and style of a draw command, its dashes are appended to the dashes of _list */
+TARP_LOCAL tpBool _tpGLCommandSetStyle(_tpGLCommandList * _list, _tpGLCommand * _cmd, _tpGLPath * _path, const tpStyle * _style)
+{
+    _cmd->version = _path->version;
+    _cmd->style = *_style;
+    _cmd->style.dashArray = NULL;
+    _cmd->dashStart = _list->dashes.count;
+    if (_style->dashCount && _tpFloatArrayAppendArray(&_list->dashes, (tpFloat *)_style->dashArray, _style->dashCount))
+    {
+        _tpGLSetErrorMessage("Could not allocate memory for the recorded commands.");
+        return tpTrue;
+    }
+    _cmd->fillPaintVersion = _tpGLPaintVersion(&_style->fill);
+    _cmd->strokePaintVersion = _tpGLPaintVersion(&_style->stroke);
+    return tpFalse;
+}
+
+TARP_LOCAL tpBool _tpGLRecordCommand(_tpGLContext * _ctx, _tpGLCommandType _type, _tpGLPath * _path, _tpGLLayer * _layer, const tpStyle * _style)
+{
+    int i;
+    _tpGLCommand cmd;
+    _tpGLRect bounds;
+    tpVec2 corners[4];
+    _tpGLCommandList * list = _ctx->recordList;
+
+    memset(&cmd, 0, sizeof(cmd));
+    cmd.type = _type;
+    cmd.path = _path;
+    cmd.layer = _layer;
+    cmd.transform = _ctx->transform;
+    cmd.projection = _ctx->projection;
+    cmd.match = -1;
+    cmd.bounds.min = tpVec2Make(FLT_MAX, FLT_MAX);
+    cmd.bounds.max = tpVec2Make(-FLT_MAX, -FLT_MAX);
+
+    if (_type == _kTpGLCommandEndClipping)
+    {
+        if (!list->clippingDepth)
+        {
+            _tpGLSetErrorMessage("tpEndClipping was called without a matching tpBeginClipping.");
+            return tpTrue;
+        }
+        list->clippingDepth--;
+    }
+    else if (_type == _kTpGLCommandResetClipping)
+    {
+        list->clippingDepth = 0;
+    }
+    cmd.clipSignature = list->clipSignatures[list->clippingDepth];
+
+    if (_path)
+    {
+        if (_tpGLCommandSetStyle(list, &cmd, _path, _style))
+            return tpTrue;
+
+        _tpGLPathTransformedBounds(_path, _style, &_ctx->transform, &bounds);
+        if (list->bWindowBounds)
+            _tpGLWindowBounds(_ctx, &bounds, &cmd.bounds);
+        else
+            cmd.bounds = bounds;
+    }
+    else if (_layer)
+    {
+        _tpGLLayerUpdate(_layer);
+        cmd.version = _layer->version;
+
+        /* the layer is drawn with the current transform, same as a path */
+        _tpGLInitBounds(&bounds);
+        if (_layer->bounds.min.x <= _layer->bounds.max.x)
+        {
+            corners[0] = _layer->bounds.min;
+            corners[1] = tpVec2Make(_layer->bounds.min.x, _layer->bounds.max.y);
+            corners[2] = tpVec2Make(_layer->bounds.max.x, _layer->bounds.min.y);
+            corners[3] = _layer->bounds.max;
+            for (i = 0; i < 4; ++i)
+                _tpGLEvaluatePointForBounds(tpTransformApply(&_ctx->transform, corners[i]), &bounds);
+        }
+        if (list->bWindowBounds)
+            _tpGLWindowBounds(_ctx, &bounds, &cmd.bounds);
+        else
+            cmd.bounds = bounds;
+    }
+
+    if (_type == _kTpGLCommandBeginClipping)
+    {
+        if (list->clippingDepth >= TARP_GL_MAX_CLIPPING_STACK_DEPTH)
+        {
+            _tpGLSetErrorMessage("Too many nested clipping paths.");
+            return tpTrue;
+        }
+        /* everything drawn until the matching tpEndClipping depends on this clipping path */
+        list->clipSignatures[list->clippingDepth + 1] =
+            _tpGLHashTransform(_tpGLHashCombine(cmd.clipSignature, cmd.version), &cmd.transform);
+        list->clippingDepth++;
+    }
+
+    if (_tpGLCommandArrayAppendPtr(&list->commands, &cmd))
+    {
+        _tpGLSetErrorMessage("Could not allocate memory for the recorded commands.");
+        return tpTrue;
+    }
+    return tpFalse;
+}
+
+TARP_API tpBool tpDrawPath(tpContext _ctx, tpPath _path, const tpStyle * _style)
+{
+    _tpGLContext * ctx = (_tpGLContext *)_ctx.pointer;
+    if (ctx->recordList)
+        return _tpGLRecordCommand(ctx, _kTpGLCommandDrawPath, (_tpGLPath *)_path.pointer, NULL, _style);
+    return _tpGLDrawPathImpl(ctx, (_tpGLPath *)_path.pointer, _style, 0, tpFalse);
+}
+
+TARP_API tpBool tpDrawPathWithStyle(tpContext _ctx, tpPath _path, tpStyleHandle _style)
+{
+    _tpGLContext * ctx = (_tpGLContext *)_ctx.pointer;
+    _tpGLStyle * style = (_tpGLStyle *)_style.pointer;
+
+    if (ctx->recordList)
+    {
+        if (_tpGLRecordCommand(ctx, _kTpGLCommandDrawPath, (_tpGLPath *)_path.pointer, NULL, &style->style))
+            return tpTrue;
+        _tpGLCommandArrayLastPtr(&ctx->recordList->commands)->styleVersion = style->version;
+        return tpFalse;
+    }
+    return _tpGLDrawPathImpl(ctx, (_tpGLPath *)_path.pointer, &style->style, style->version, tpFalse);
+}
+
+TARP_API tpBool tpDrawGlyphRun(tpContext _ctx, tpGlyphCache _cache, const tpGlyphInstance * _glyphs, int _count,
+                               tpFloat _size, tpColor _color)
+{
+    _tpGLContext * ctx = (_tpGLContext *)_ctx.pointer;
+    _tpGLGlyphCache * cache = (_tpGLGlyphCache *)_cache.pointer;
+
+    if (!cache || _count < 0 || (_count && !_glyphs) || _size <= 0)
+    {
+        _tpGLSetErrorMessage("tpDrawGlyphRun failed because of invalid arguments.");
+        return tpTrue;
+    }
+    if (ctx->recordList)
+        return _tpGLRecordGlyphRun(ctx, cache, _glyphs, _count, _size, _color);
+    return _tpGLDrawGlyphRunImpl(ctx, cache, _glyphs, _count, _size, _color);
+}
+
+TARP_API tpBool tpPathTessellate(tpPath _path, const tpStyle * _style, tpFloat _scale, const tpTessellationCallbacks * _callbacks)
+{
+    int i, j, indexCount, indexCapacity;
+    unsigned int * indices, * mem;
+    tpBool err;
+    _tpGLContour * c;
+    _tpVec2Array tmpVertices;
+    _tpBoolArray tmpJoints;
+    tpTransform scaleTransform;
+    _tpGLPath * p = (_tpGLPath *)_path.pointer;
+
+    if (!p || !_style || !_callbacks || _scale <= 0)
+    {
+        _tpGLSetErrorMessage("tpPathTessellate failed because of invalid arguments.");
+        return tpTrue;
+    }
+
+    /* same logic as in _tpGLDrawPathImpl, only reflatten if we need more detail */
+    if (_scale > p->lastTransformScale || !_style->scaleStroke)
+        _tpGLMarkPathGeometryDirty(p);
+
+    if (p->bPathGeometryDirty)
+        p->lastTransformScale = _scale;
+
+    /* make sure the next draw call checks if the cached geometry is detailed enough */
+    p->lastDrawContext = NULL;
+
+    _tpVec2ArrayInit(&tmpVertices, 128);
+    _tpBoolArrayInit(&tmpJoints, 128);
+    scaleTransform = tpTransformMakeScale(_scale, _scale);
+    err = _tpGLPathUpdateGeometry(p, _style, 0, _scale, &scaleTransform, &tmpVertices, &tmpJoints, tpFalse);
+    _tpVec2ArrayDeallocate(&tmpVertices);
+    _tpBoolArrayDeallocate(&tmpJoints);
+    if (err)
+        return tpTrue;
+
+    if (_callbacks->fillContour || _callbacks->fillContourIndexed)
+    {
+        indices = NULL;
+        indexCapacity = 0;
+        for (i = 0; i < p->contours.count; ++i)
+        {
+            c = _tpGLContourArrayAtPtr(&p->contours, i);
+            if (!c->fillVertexCount)
+                continue;
+
+            if (_callbacks->fillContourIndexed)
+            {
+                indexCount = TARP_MAX(0, c->fillVertexCount - 2) * 3;
+                if (indexCount > indexCapacity)
+                {
+                    indexCapacity = indexCount * 2;
+                    mem = (unsigned int *)(indices ? TARP_REALLOC(indices, sizeof(unsigned int) * indexCapacity) :
+                                           TARP_MALLOC(sizeof(unsigned int) * indexCapacity));
+                    if (!mem)
+                    {
+                        /* a failed realloc leaves the old block alive */
+                        if (indices)
+                            TARP_FREE(indices);
+                        _tpGLSetErrorMessage("Could not allocate memory for tessellation indices.");
+                        return tpTrue;
+                    }
+                    indices = mem;
+                }
+                for (j = 0; j < indexCount / 3; ++j)
+                {
+                    indices[j * 3] = 0;
+                    indices[j * 3 + 1] = j + 1;
+                    indices[j * 3 + 2] = j + 2;
+                }
+                _callbacks->fillContourIndexed(_callbacks->userData,
+                                               _tpVec2ArrayAtPtr(&p->geometryCache, c->fillVertexOffset),
+                                               c->fillVertexCount, indices, indexCount, c->bIsClosed);
+            }
+            else
+            {
+                _callbacks->fillContour(_callbacks->userData,
+                                        _tpVec2ArrayAtPtr(&p->geometryCache, c->fillVertexOffset),
+                                        c->fillVertexCount, c->bIsClosed);
+            }
+        }
+        if (indices)
+            TARP_FREE(indices);
+    }
+
+    if (_callbacks->strokeTriangles && p->strokeVertexCount)
+    {
+        _callbacks->strokeTriangles(_callbacks->userData,
+                                    _tpVec2ArrayAtPtr(&p->geometryCache, p->strokeVertexOffset),
+                                    p->strokeVertexCount);
+    }
+
+    return tpFalse;
+}
+
+TARP_LOCAL int _tpGLHitGridColumn(const _tpGLHitGrid * _grid, tpFloat _x)
+{
+    int c = (int)((_x - _grid->bounds.min.x) * _grid->invCellWidth);
+    return TARP_CLAMP(c, 0, _grid->columns - 1);
+}
+
+TARP_LOCAL int _tpGLHitGridRow(const _tpGLHitGrid * _grid, tpFloat _y)
+{
+    int r = (int)((_y - _grid->bounds.min.y) * _grid->invCellHeight);
+    return TARP_CLAMP(r, 0, _grid->rows - 1);
+}
+
+TARP_LOCAL tpBool _tpGLIntArrayResize(_tpIntArray * _array, int _count)
+{
+    if (_array->capacity < _count && _tpIntArrayReserve(_array, _count))
+        return tpTrue;
+    _array->count = _count;
+    return tpFalse;
+}
+
+typedef void (*_tpGLHitGridItemBoundsFn)(_tpGLPath * _path, int _item, _tpGLRect * _outBounds);
+
+/* sorts the items into all the cells that their bounds overlap */
+TARP_LOCAL tpBool _tpGLHitGridBuild(_tpGLHitGrid * _grid, _tpGLPath * _path, const _tpGLRect * _bounds,
+                                    int _itemCount, _tpGLHitGridItemBoundsFn _itemBounds)
+{
+    int i, x, y, c0, c1, r0, r1, cellCount;
+    tpFloat w, h;
+    _tpGLRect ib;
+
+    _grid->bounds = *_bounds;
+    w = TARP_MAX(_bounds->max.x - _bounds->min.x, FLT_EPSILON);
+    h = TARP_MAX(_bounds->max.y - _bounds->min.y, FLT_EPSILON);
+
+    /* aim for a couple of items per cell and keep the cells roughly square */
+    cellCount = TARP_CLAMP(_itemCount / 2, 1, TARP_GL_MAX_HIT_GRID_SIZE * TARP_GL_MAX_HIT_GRID_SIZE);
+    _grid->columns = TARP_CLAMP((int)(sqrt(cellCount * w / h) + 0.5), 1, TARP_GL_MAX_HIT_GRID_SIZE);
+    _grid->rows = TARP_CLAMP(cellCount / _grid->columns, 1, TARP_GL_MAX_HIT_GRID_SIZE);
+    _grid->invCellWidth = _grid->columns / w;
+    _grid->invCellHeight = _grid->rows / h;
+    cellCount = _grid->columns * _grid->rows;
+
+    if (_tpGLIntArrayResize(&_grid->cellStarts, cellCount + 1))
+        return tpTrue;
+    memset(_grid->cellStarts.array, 0, sizeof(int) * (cellCount + 1));
+
+    /* count the items per cell... */
+    for (i = 0; i < _itemCount; ++i)
+    {
+        _itemBounds(_path, i, &ib);
+        c0 = _tpGLHitGridColumn(_grid, ib.min.x);
+        c1 = _tpGLHitGridColumn(_grid, ib.max.x);
+        r0 = _tpGLHitGridRow(_grid, ib.min.y);
+        r1 = _tpGLHitGridRow(_grid, ib.max.y);
+        for (y = r0; y <= r1; ++y)
+            for (x = c0; x <= c1; ++x)
+                _grid->cellStarts.array[y * _grid->columns + x + 1]++;
+    }
+
+    /* ...turn the counts into offsets... */
+    for (i = 1; i <= cellCount; ++i)
+        _grid->cellStarts.array[i] += _grid->cellStarts.array[i - 1];
+
+    if (_tpGLIntArrayResize(&_grid->items, _grid->cellStarts.array[cellCount]))
+        return tpTrue;
+
+    /* ...and put the items into their cells. This moves each offset to the start of the next cell. */
+    for (i = 0; i < _itemCount; ++i)
+    {
+        _itemBounds(_path, i, &ib);
+        c0 = _tpGLHitGridColumn(_grid, ib.min.x);
+        c1 = _tpGLHitGridColumn(_grid, ib.max.x);
+        r0 = _tpGLHitGridRow(_grid, ib.min.y);
+        r1 = _tpGLHitGridRow(_grid, ib.max.y);
+        for (y = r0; y <= r1; ++y)
+            for (x = c0; x <= c1; ++x)
+                _grid->items.array[_grid->cellStarts.array[y * _grid->columns + x]++] = i;
+    }
+
+    for (i = cellCount; i > 0; --i)
+        _grid->cellStarts.array[i] = _grid->cellStarts.array[i - 1];
+    _grid->cellStarts.array[0] = 0;
+
+    _grid->version = _path->geometryVersion;
+    return tpFalse;
+}
+
+TARP_LOCAL void _tpGLRectFromPoints(_tpGLRect * _rect, const tpVec2 * _points, int _count)
+{
+    int i;
+    _tpGLInitBounds(_rect);
+    for (i = 0; i < _count; ++i)
+        _tpGLEvaluatePointForBounds(_points[i], _rect);
+}
+
+TARP_LOCAL void _tpGLFillEdgeBounds(_tpGLPath * _path, int _item, _tpGLRect * _outBounds)
+{
+    tpVec2 pts[2];
+    pts[0] = _path->geometryCache.array[_path->hitEdges.array[_item * 2]];
+    pts[1] = _path->geometryCache.array[_path->hitEdges.array[_item * 2 + 1]];
+    _tpGLRectFromPoints(_outBounds, pts, 2);
+}
+
+TARP_LOCAL void _tpGLStrokeTriangleBounds(_tpGLPath * _path, int _item, _tpGLRect * _outBounds)
+{
+    _tpGLRectFromPoints(_outBounds, _path->geometryCache.array + _path->strokeVertexOffset + _item * 3, 3);
+}
+
+TARP_LOCAL tpBool _tpGLRectContains(const _tpGLRect * _rect, tpVec2 _p)
+{
+    return (tpBool)(_p.x >= _rect->min.x && _p.x <= _rect->max.x &&
+                    _p.y >= _rect->min.y && _p.y <= _rect->max.y);
+}
+
+/*
+returns the path to hit test _path with, with its geometry cache brought up to date for the provided style.
+Hit tests work in path space, so if the geometry was last built for a non scaling stroke (which lives in
+screen space), a copy of the path is tested instead, which keeps the render geometry intact.
+Returns NULL if the copy could not be created.
+*/
+TARP_LOCAL _tpGLPath * _tpGLPathUpdateHitTestGeometry(_tpGLPath * _path, const tpStyle * _style)
+{
+    tpStyle style;
+    tpTransform identity;
+    tpPath handle;
+    _tpVec2Array tmpVertices;
+    _tpBoolArray tmpJoints;
+    _tpGLPath * p = _path;
+
+    if (!_path->lastStroke.scaleStroke)
+    {
+        if (!tpPathIsValidHandle(_path->hitTestPath) || _path->hitTestVersion != _path->version)
+        {
+            tpPathDestroy(_path->hitTestPath);
+            handle.pointer = _path;
+            _path->hitTestPath = tpPathClone(handle);
+            if (!tpPathIsValidHandle(_path->hitTestPath))
+                return NULL;
+            _path->hitTestVersion = _path->version;
+        }
+        p = (_tpGLPath *)_path->hitTestPath.pointer;
+    }
+
+    style = *_style;
+    style.scaleStroke = tpTrue;
+    if (!p->lastStroke.scaleStroke)
+        _tpGLMarkPathGeometryDirty(p);
+
+    if (p->bPathGeometryDirty)
+    {
+        /* make sure the next draw call rebuilds the geometry for its transform if needed */
+        p->lastDrawContext = NULL;
+    }
+
+    /* empty arrays don't allocate until something is added to them */
+    memset(&tmpVertices, 0, sizeof(tmpVertices));
+    memset(&tmpJoints, 0, sizeof(tmpJoints));
+    identity = tpTransformMakeIdentity();
+    if (_tpGLPathUpdateGeometry(p, &style, 0, p->lastTransformScale, &identity, &tmpVertices, &tmpJoints, tpFalse))
+        p = NULL;
+    _tpVec2ArrayDeallocate(&tmpVertices);
+    _tpBoolArrayDeallocate(&tmpJoints);
+    return p;
+}
+
+TARP_API tpBool tpPathHitTestFill(tpPath _path, tpFloat _x, tpFloat _y, tpFillRule _fillRule)
+{
+    int i, j, k, col, row, cell, step, winding;
+    tpFloat ix;
+    tpVec2 pt, a, b;
+    tpStyle style;
+    _tpGLContour * c;
+    _tpGLHitGrid * grid;
+    _tpGLPath * p = (_tpGLPath *)_path.pointer;
+
+    if (!p)
+        return tpFalse;
+
+    /* use the stroke the geometry was last built with, so we don't throw the cached stroke away */
+    style = tpStyleMake();
+    style.stroke.type = p->lastStroke.strokeType;
+    style.strokeWidth = p->lastStroke.strokeWidth;
+    style.strokeJoin = p->lastStroke.join;
+    style.strokeCap = p->lastStroke.cap;
+    style.miterLimit = p->lastStroke.miterLimit;
+    style.dashArray = p->lastStroke.dashArray;
+    style.dashCount = p->lastStroke.dashCount;
+    style.dashOffset = p->lastStroke.dashOffset;
+    p = _tpGLPathUpdateHitTestGeometry(p, &style);
+    if (!p)
+        return tpFalse;
+
+    pt = tpVec2Make(_x, _y);
+    if (!p->contours.count || !_tpGLRectContains(&p->boundsCache, pt))
+        return tpFalse;
+
+    grid = &p->fillHitGrid;
+    if (grid->version != p->geometryVersion)
+    {
+        /* collect the edges of all contours, including the implicit closing edge of the fill */
+        _tpIntArrayClear(&p->hitEdges);
+        for (i = 0; i < p->contours.count; ++i)
+        {
+            c = _tpGLContourArrayAtPtr(&p->contours, i);
+            if (c->fillVertexCount < 2)
+                continue;
+            for (j = c->fillVertexOffset; j < c->fillVertexOffset + c->fillVertexCount; ++j)
+            {
+                _tpIntArrayAppend(&p->hitEdges, j);
+                _tpIntArrayAppend(&p->hitEdges, j + 1 < c->fillVertexOffset + c->fillVertexCount ? j + 1 : c->fillVertexOffset);
+            }
+        }
+
+        if (_tpGLHitGridBuild(grid, p, &p->boundsCache, p->hitEdges.count / 2, _tpGLFillEdgeBounds))
+        {
+            _tpGLSetErrorMessage("Could not allocate memory for the hit test grid.");
+            grid->version = -1;
+            return tpFalse;
+        }
+    }
+
+    /*
+    count the crossings of a horizontal ray going from the point towards the closer side of the grid.
+    Edges are stored in every cell they overlap, so a crossing is only counted in the cell that it
+    lies in. The sign of the winding number depends on the ray direction, which doesn't matter for
+    either fill rule.
+    */
+    winding = 0;
+    row = _tpGLHitGridRow(grid, _y);
+    col = _tpGLHitGridColumn(grid, _x);
+    step = col < grid->columns / 2 ? -1 : 1;
+    for (; col >= 0 && col < grid->columns; col += step)
+    {
+        cell = row * grid->columns + col;
+        for (k = grid->cellStarts.array[cell]; k < grid->cellStarts.array[cell + 1]; ++k)
+        {
+            i = grid->items.array[k];
+            a = p->geometryCache.array[p->hitEdges.array[i * 2]];
+            b = p->geometryCache.array[p->hitEdges.array[i * 2 + 1]];
+            if ((a.y > _y) == (b.y > _y))
+                continue;
+
+            ix = a.x + (_y - a.y) * (b.x - a.x) / (b.y - a.y);
+            ix = TARP_CLAMP(ix, TARP_MIN(a.x, b.x), TARP_MAX(a.x, b.x));
+            if ((step > 0 ? ix > _x : ix < _x) && _tpGLHitGridColumn(grid, ix) == col)
+                winding += b.y > a.y ? 1 : -1;
+        }
+    }
+
+    if (_fillRule == kTpFillRuleEvenOdd)
+        return (tpBool)(winding % 2 != 0);
+    return (tpBool)(winding != 0);
+}
+
+TARP_API tpBool tpPathHitTestStroke(tpPath _path, const tpStyle * _style, tpFloat _x, tpFloat _y)
+{
+    int i, k, cell;
+    tpVec2 pt, a, b, c;
+    tpFloat d0, d1, d2;
+    _tpGLHitGrid * grid;
+    _tpGLPath * p = (_tpGLPath *)_path.pointer;
+
+    if (!p || !_style || _style->stroke.type == kTpPaintTypeNone || _style->strokeWidth <= 0)
+        return tpFalse;
+
+    p = _tpGLPathUpdateHitTestGeometry(p, _style);
+    if (!p)
+        return tpFalse;
+
+    pt = tpVec2Make(_x, _y);
+    if (!p->strokeVertexCount || !_tpGLRectContains(&p->strokeBoundsCache, pt))
+        return tpFalse;
+
+    grid = &p->strokeHitGrid;
+    if (grid->version != p->geometryVersion &&
+            _tpGLHitGridBuild(grid, p, &p->strokeBoundsCache, p->strokeVertexCount / 3, _tpGLStrokeTriangleBounds))
+    {
+        _tpGLSetErrorMessage("Could not allocate memory for the hit test grid.");
+        grid->version = -1;
+        return tpFalse;
+    }
+
+    /* check the triangles of the cell the point is in */
+    cell = _tpGLHitGridRow(grid, _y) * grid->columns + _tpGLHitGridColumn(grid, _x);
+    for (k = grid->cellStarts.array[cell]; k < grid->cellStarts.array[cell + 1]; ++k)
+    {
+        i = p->strokeVertexOffset + grid->items.array[k] * 3;
+        a = p->geometryCache.array[i];
+        b = p->geometryCache.array[i + 1];
+        c = p->geometryCache.array[i + 2];
+
+        /* the stroke triangles can have either winding */
+        d0 = tpVec2Cross(tpVec2Sub(b, a), tpVec2Sub(pt, a));
+        d1 = tpVec2Cross(tpVec2Sub(c, b), tpVec2Sub(pt, b));
+        d2 = tpVec2Cross(tpVec2Sub(a, c), tpVec2Sub(pt, c));
+        if (!((d0 < 0 || d1 < 0 || d2 < 0) && (d0 > 0 || d1 > 0 || d2 > 0)))
+            return tpTrue;
+    }
+
+    return tpFalse;
+}
+
+/*
+checks if a path consists of a single convex contour. We check the control polygon, as the curves of a
+convex control polygon can't bend inwards. Paths with more than one contour are never treated as convex.
+*/
+TARP_LOCAL tpBool _tpGLPathIsConvex(_tpGLPath * _path)
+{
+    int i, n, sign;
+    tpFloat cross, turning;
+    tpVec2 a, b;
+    tpSegment * seg;
+    _tpGLContour * c;
+    _tpVec2Array points;
+
+    if (_path->convexVersion == _path->version)
+        return _path->bConvex;
+
+    _path->convexVersion = _path->version;
+    _path->bConvex = tpFalse;
+    if (_path->contours.count != 1)
+        return tpFalse;
+
+    c = _tpGLContourArrayAtPtr(&_path->contours, 0);
+    memset(&points, 0, sizeof(points));
+    if (c->bIsPolyline)
+    {
+        for (i = 0; i < c->points.count; ++i)
+            _tpVec2ArrayAppend(&points, c->points.array[i]);
+    }
+    else
+    {
+        /* open contours are closed with a straight line, so the outer handles don't matter */
+        for (i = 0; i < c->segments.count; ++i)
+        {
+            seg = _tpGLSegmentBufferAtPtr(&c->segments, i);
+            if (i || c->bIsClosed)
+                _tpVec2ArrayAppend(&points, seg->handleIn);
+            _tpVec2ArrayAppend(&points, seg->position);
+            if (i < c->segments.count - 1 || c->bIsClosed)
+                _tpVec2ArrayAppend(&points, seg->handleOut);
+        }
+    }
+
+    /* remove handles that coincide with their segment and other duplicates */
+    n = 0;
+    for (i = 0; i < points.count; ++i)
+    {
+        if (!n || !tpVec2Equals(points.array[i], points.array[n - 1]))
+            points.array[n++] = points.array[i];
+    }
+    while (n > 1 && tpVec2Equals(points.array[n - 1], points.array[0]))
+        --n;
+
+    if (n >= 3)
+    {
+        sign = 0;
+        turning = 0;
+        for (i = 0; i < n; ++i)
+        {
+            a = tpVec2Sub(points.array[(i + 1) % n], points.array[i]);
+            b = tpVec2Sub(points.array[(i + 2) % n], points.array[(i + 1) % n]);
+            cross = tpVec2Cross(a, b);
+            if (cross != 0)
+            {
+                if (sign && (cross > 0) != (sign > 0))
+                    break;
+                sign = cross > 0 ? 1 : -1;
+            }
+            turning += atan2(cross, tpVec2Dot(a, b));
+        }
+        /* all turns go the same way and add up to exactly one revolution */
+        _path->bConvex = (tpBool)(i == n && sign && fabs(fabs(turning) - 2 * TARP_PI) < 0.01f);
+    }
+
+    _tpVec2ArrayDeallocate(&points);
+    return _path->bConvex;
+}
+
+TARP_LOCAL unsigned int _tpGLSpatialCellHash(int _x, int _y)
+{
+    return (unsigned int)_x * 73856093u ^ (unsigned int)_y * 19349663u;
+}
+
+TARP_LOCAL unsigned int _tpGLSpatialPathHash(const _tpGLPath * _path)
+{
+    return (unsigned int)((size_t)_path >> 3) * 2654435761u;
+}
+
+TARP_LOCAL _tpGLSpatialCell * _tpGLSpatialIndexFindCell(_tpGLSpatialIndex * _idx, int _x, int _y)
+{
+    unsigned int i, mask;
+    _tpGLSpatialCell * cell;
+
+    if (!_idx->cellCapacity)
+        return NULL;
+
+    mask = _idx->cellCapacity - 1;
+    for (i = _tpGLSpatialCellHash(_x, _y) & mask;; i = (i + 1) & mask)
+    {
+        cell = &_idx->cells[i];
+        if (!cell->bUsed)
+            return NULL;
+        if (cell->x == _x && cell->y == _y)
+            return cell;
+    }
+}
+
+TARP_LOCAL tpBool _tpGLSpatialIndexGrowCells(_tpGLSpatialIndex * _idx)
+{
+    int i, capacity;
+    unsigned int j, mask;
+    _tpGLSpatialCell * cells;
+
+    capacity = _idx->cellCapacity ? _idx->cellCapacity * 2 : 64;
+    cells = (_tpGLSpatialCell *)TARP_MALLOC(sizeof(_tpGLSpatialCell) * capacity);
+    if (!cells)
+        return tpTrue;
+    memset(cells, 0, sizeof(_tpGLSpatialCell) * capacity);
+
+    mask = capacity - 1;
+    for (i = 0; i < _idx->cellCapacity; ++i)
+    {
+        if (!_idx->cells[i].bUsed)
+            continue;
+        for (j = _tpGLSpatialCellHash(_idx->cells[i].x, _idx->cells[i].y) & mask; cells[j].bUsed; j = (j + 1) & mask);
+        cells[j] = _idx->cells[i];
+    }
+
+    if (_idx->cells)
+        TARP_FREE(_idx->cells);
+    _idx->cells = cells;
+    _idx->cellCapacity = capacity;
+    return tpFalse;
+}
+
+/* cells are never removed, empty ones simply stay around to be reused */
+TARP_LOCAL _tpGLSpatialCell * _tpGLSpatialIndexAddCell(_tpGLSpatialIndex * _idx, int _x, int _y)
+{
+    unsigned int i, mask;
+    _tpGLSpatialCell * cell = _tpGLSpatialIndexFindCell(_idx, _x, _y);
+    if (cell)
+        return cell;
+
+    if ((_idx->cellCount + 1) * 2 > _idx->cellCapacity && _tpGLSpatialIndexGrowCells(_idx))
+        return NULL;
+
+    mask = _idx->cellCapacity - 1;
+    for (i = _tpGLSpatialCellHash(_x, _y) & mask; _idx->cells[i].bUsed; i = (i + 1) & mask);
+    cell = &_idx->cells[i];
+    cell->x = _x;
+    cell->y = _y;
+    cell->bUsed = tpTrue;
+    memset(&cell->entries, 0, sizeof(cell->entries));
+    _idx->cellCount++;
+    return cell;
+}
+
+TARP_LOCAL int _tpGLSpatialIndexFindSlot(_tpGLSpatialIndex * _idx, const _tpGLPath * _path)
+{
+    unsigned int i, mask;
+
+    if (!_idx->slotCapacity)
+        return -1;
+
+    mask = _idx->slotCapacity - 1;
+    for (i = _tpGLSpatialPathHash(_path) & mask; _idx->slots[i].path; i = (i + 1) & mask)
+    {
+        if (_idx->slots[i].path == _path)
+            return (int)i;
+    }
+    return -1;
+}
+
+TARP_LOCAL tpBool _tpGLSpatialIndexAddSlot(_tpGLSpatialIndex * _idx, _tpGLPath * _path, int _entry)
+{
+    int i, capacity;
+    unsigned int j, mask;
+    _tpGLSpatialSlot * slots;
+
+    if ((_idx->slotCount + 1) * 2 > _idx->slotCapacity)
+    {
+        capacity = _idx->slotCapacity ? _idx->slotCapacity * 2 : 64;
+        slots = (_tpGLSpatialSlot *)TARP_MALLOC(sizeof(_tpGLSpatialSlot) * capacity);
+        if (!slots)
+            return tpTrue;
+        memset(slots, 0, sizeof(_tpGLSpatialSlot) * capacity);
+
+        mask = capacity - 1;
+        for (i = 0; i < _idx->slotCapacity; ++i)
+        {
+            if (!_idx->slots[i].path)
+                continue;
+            for (j = _tpGLSpatialPathHash(_idx->slots[i].path) & mask; slots[j].path; j = (j + 1) & mask);
+            slots[j] = _idx->slots[i];
+        }
+
+        if (_idx->slots)
+            TARP_FREE(_idx->slots);
+        _idx->slots = slots;
+        _idx->slotCapacity = capacity;
+    }
+
+    mask = _idx->slotCapacity - 1;
+    for (j = _tpGLSpatialPathHash(_path) & mask; _idx->slots[j].path; j = (j + 1) & mask);
+    _idx->slots[j].path = _path;
+    _idx->slots[j].entry = _entry;
+    _idx->slotCount++;
+    return tpFalse;
+}
+
+/* removes a slot from the path table, shifting back the following slots so no tombstones are needed */
+TARP_LOCAL void _tpGLSpatialIndexRemoveSlot(_tpGLSpatialIndex * _idx, int _slot)
+{
+    unsigned int i, j, k, mask;
+
+    mask = _idx->slotCapacity - 1;
+    i = (unsigned int)_slot;
+    j = i;
+    for (;;)
+    {
+        j = (j + 1) & mask;
+        if (!_idx->slots[j].path)
+            break;
+        k = _tpGLSpatialPathHash(_idx->slots[j].path) & mask;
+        /* move the slot back if its ideal position is not in the (cyclic) range (i, j] */
+        if ((j > i && (k <= i || k > j)) || (j < i && (k <= i && k > j)))
+        {
+            _idx->slots[i] = _idx->slots[j];
+            i = j;
+        }
+    }
+    _idx->slots[i].path = NULL;
+    _idx->slotCount--;
+}
+
+TARP_LOCAL void _tpGLSpatialIndexUnlink(_tpGLSpatialIndex * _idx, int _entry)
+{
+    int x, y, i;
+    _tpGLSpatialCell * cell;
+    _tpGLSpatialEntry * e = _tpGLSpatialEntryArrayAtPtr(&_idx->entries, _entry);
+
+    if (e->bOversized)
+    {
+        _tpIntArrayRemoveValue(&_idx->oversized, _entry);
+        e->bOversized = tpFalse;
+        return;
+    }
+
+    for (y = e->r0; y <= e->r1; ++y)
+    {
+        for (x = e->c0; x <= e->c1; ++x)
+        {
+            cell = _tpGLSpatialIndexFindCell(_idx, x, y);
+            if (!cell)
+                continue;
+            /* the order within a cell doesn't matter, so we swap remove */
+            for (i = 0; i < cell->entries.count; ++i)
+            {
+                if (cell->entries.array[i] == _entry)
+                {
+                    cell->entries.array[i] = cell->entries.array[--cell->entries.count];
+                    break;
+                }
+            }
+        }
+    }
+}
+
+TARP_LOCAL tpBool _tpGLSpatialIndexLink(_tpGLSpatialIndex * _idx, int _entry)
+{
+    int x, y;
+    _tpGLSpatialCell * cell;
+    _tpGLSpatialEntry * e = _tpGLSpatialEntryArrayAtPtr(&_idx->entries, _entry);
+
+    /* empty bounds are not stored in any cell */
+    e->c0 = e->r0 = 0;
+    e->c1 = e->r1 = -1;
+    if (e->bounds.min.x > e->bounds.max.x)
+        return tpFalse;
+
+    if ((e->bounds.max.x - e->bounds.min.x) * _idx->invCellSize >= TARP_GL_MAX_SPATIAL_INDEX_CELLS_PER_PATH ||
+            (e->bounds.max.y - e->bounds.min.y) * _idx->invCellSize >= TARP_GL_MAX_SPATIAL_INDEX_CELLS_PER_PATH ||
+            (int)((e->bounds.max.x - e->bounds.min.x) * _idx->invCellSize + 1) *
+            (int)((e->bounds.max.y - e->bounds.min.y) * _idx->invCellSize + 1) > TARP_GL_MAX_SPATIAL_INDEX_CELLS_PER_PATH)
+    {
+        if (_tpIntArrayAppend(&_idx->oversized, _entry))
+            return tpTrue;
+        e->bOversized = tpTrue;
+        return tpFalse;
+    }
+
+    e->c0 = (int)floor(e->bounds.min.x * _idx->invCellSize);
+    e->r0 = (int)floor(e->bounds.min.y * _idx->invCellSize);
+    e->c1 = (int)floor(e->bounds.max.x * _idx->invCellSize);
+    e->r1 = (int)floor(e->bounds.max.y * _idx->invCellSize);
+    for (y = e->r0; y <= e->r1; ++y)
+    {
+        for (x = e->c0; x <= e->c1; ++x)
+        {
+            cell = _tpGLSpatialIndexAddCell(_idx, x, y);
+            if (!cell || _tpIntArrayAppend(&cell->entries, _entry))
+            {
+                /* cells that don't contain the entry yet are simply skipped */
+                _tpGLSpatialIndexUnlink(_idx, _entry);
+                return tpTrue;
+            }
+        }
+    }
+    return tpFalse;
+}
+
+TARP_API tpSpatialIndex tpSpatialIndexCreate(tpFloat _cellSize)
+{
+    tpSpatialIndex ret = {NULL};
+    _tpGLSpatialIndex * idx;
+
+    if (_cellSize <= 0)
+    {
+        _tpGLSetErrorMessage("The cell size of a spatial index has to be bigger than zero.");
+        return ret;
+    }
+
+    idx = (_tpGLSpatialIndex *)TARP_MALLOC(sizeof(_tpGLSpatialIndex));
+    if (!idx)
+        return ret;
+    memset(idx, 0, sizeof(_tpGLSpatialIndex));
+    idx->invCellSize = 1.0f / _cellSize;
+    idx->freeEntry = -1;
+
+    ret.pointer = idx;
+    return ret;
+}
+
+TARP_API void tpSpatialIndexClear(tpSpatialIndex _index)
+{
+    int i;
+    _tpGLSpatialIndex * idx = (_tpGLSpatialIndex *)_index.pointer;
+
+    for (i = 0; i < idx->cellCapacity; ++i)
+    {
+        if (idx->cells[i].bUsed)
+            _tpIntArrayDeallocate(&idx->cells[i].entries);
+    }
+    if (idx->cells)
+        TARP_FREE(idx->cells);
+    if (idx->slots)
+        TARP_FREE(idx->slots);
+    idx->cells = NULL;
+    idx->slots = NULL;
+    idx->cellCount = idx->cellCapacity = 0;
+    idx->slotCount = idx->slotCapacity = 0;
+
+    _tpGLSpatialEntryArrayClear(&idx->entries);
+    _tpIntArrayClear(&idx->oversized);
+    idx->freeEntry = -1;
+}
+
+TARP_API void tpSpatialIndexDestroy(tpSpatialIndex _index)
+{
+    _tpGLSpatialIndex * idx = (_tpGLSpatialIndex *)_index.pointer;
+    if (idx)
+    {
+        tpSpatialIndexClear(_index);
+        _tpGLSpatialEntryArrayDeallocate(&idx->entries);
+        _tpIntArrayDeallocate(&idx->oversized);
+        TARP_FREE(idx);
+    }
+}
+
+TARP_API tpBool tpSpatialIndexInsert(tpSpatialIndex _index, tpPath _path, const tpStyle * _style, const tpTransform * _transform)
+{
+    int slot, entry;
+    _tpGLSpatialEntry e;
+    _tpGLSpatialIndex * idx = (_tpGLSpatialIndex *)_index.pointer;
+    _tpGLPath * p = (_tpGLPath *)_path.pointer;
+
+    if (!idx || !p || !_style)
+    {
+        _tpGLSetErrorMessage("tpSpatialIndexInsert failed because of invalid arguments.");
+        return tpTrue;
+    }
+
+    slot = _tpGLSpatialIndexFindSlot(idx, p);
+    if (slot != -1)
+    {
+        /* the path moved, take it out of its old cells */
+        entry = idx->slots[slot].entry;
+        _tpGLSpatialIndexUnlink(idx, entry);
+    }
+    else
+    {
+        /* reuse a free entry if possible */
+        if (idx->freeEntry != -1)
+        {
+            entry = idx->freeEntry;
+            idx->freeEntry = _tpGLSpatialEntryArrayAtPtr(&idx->entries, entry)->nextFree;
+        }
+        else
+        {
+            memset(&e, 0, sizeof(e));
+            if (_tpGLSpatialEntryArrayAppendPtr(&idx->entries, &e))
+            {
+                _tpGLSetErrorMessage("Could not allocate memory for the spatial index.");
+                return tpTrue;
+            }
+            entry = idx->entries.count - 1;
+        }
+
+        if (_tpGLSpatialIndexAddSlot(idx, p, entry))
+        {
+            _tpGLSpatialEntryArrayAtPtr(&idx->entries, entry)->nextFree = idx->freeEntry;
+            idx->freeEntry = entry;
+            _tpGLSetErrorMessage("Could not allocate memory for the spatial index.");
+            return tpTrue;
+        }
+    }
+
+    e.path = _path;
+    _tpGLPathTransformedBounds(p, _style, _transform, &e.bounds);
+    e.bOversized = tpFalse;
+    e.queryStamp = 0;
+    e.nextFree = -1;
+    *_tpGLSpatialEntryArrayAtPtr(&idx->entries, entry) = e;
+
+    if (_tpGLSpatialIndexLink(idx, entry))
+    {
+        tpSpatialIndexRemove(_index, _path);
+        _tpGLSetErrorMessage("Could not allocate memory for the spatial index.");
+        return tpTrue;
+    }
+    return tpFalse;
+}
+
+TARP_API tpBool tpSpatialIndexRemove(tpSpatialIndex _index, tpPath _path)
+{
+    int slot, entry;
+    _tpGLSpatialEntry * e;
+    _tpGLSpatialIndex * idx = (_tpGLSpatialIndex *)_index.pointer;
+
+    slot = _tpGLSpatialIndexFindSlot(idx, (_tpGLPath *)_path.pointer);
+    if (slot == -1)
+    {
+        _tpGLSetErrorMessage("tpSpatialIndexRemove failed because the path is not in the index.");
+        return tpTrue;
+    }
+
+    entry = idx->slots[slot].entry;
+    _tpGLSpatialIndexUnlink(idx, entry);
+    _tpGLSpatialIndexRemoveSlot(idx, slot);
+
+    e = _tpGLSpatialEntryArrayAtPtr(&idx->entries, entry);
+    e->path = tpPathInvalidHandle();
+    e->nextFree = idx->freeEntry;
+    idx->freeEntry = entry;
+    return tpFalse;
+}
+
+TARP_LOCAL tpBool _tpGLSpatialIndexVisit(_tpGLSpatialIndex * _idx, int _entry, const _tpGLRect * _rect,
+        tpPath * _outPaths, int _maxCount, int * _count)
+{
+    _tpGLSpatialEntry * e = _tpGLSpatialEntryArrayAtPtr(&_idx->entries, _entry);
+
+    /* entries can be stored in multiple cells, only report them once */
+    if (e->queryStamp == _idx->queryStamp)
+        return tpFalse;
+    e->queryStamp = _idx->queryStamp;
+
+    if (e->bounds.max.x < _rect->min.x || e->bounds.min.x > _rect->max.x ||
+            e->bounds.max.y < _rect->min.y || e->bounds.min.y > _rect->max.y)
+        return tpFalse;
+
+    if (*_count < _maxCount)
+        _outPaths[*_count] = e->path;
+    (*_count)++;
+    return tpTrue;
+}
+
+TARP_API int tpSpatialIndexQuery(tpSpatialIndex _index, tpFloat _minX, tpFloat _minY, tpFloat _maxX, tpFloat _maxY,
+                                 tpPath * _outPaths, int _maxCount)
+{
+    int i, x, y, c0, r0, c1, r1, count;
+    _tpGLRect rect;
+    _tpGLSpatialCell * cell;
+    _tpGLSpatialIndex * idx = (_tpGLSpatialIndex *)_index.pointer;
+
+    if (!_outPaths)
+        _maxCount = 0;
+
+    rect.min = tpVec2Make(_minX, _minY);
+    rect.max = tpVec2Make(_maxX, _maxY);
+
+    /* reset the stamps before they overflow */
+    if (idx->queryStamp == INT_MAX)
+    {
+        for (i = 0; i < idx->entries.count; ++i)
+            idx->entries.array[i].queryStamp = 0;
+        idx->queryStamp = 0;
+    }
+    idx->queryStamp++;
+
+    count = 0;
+    for (i = 0; i < idx->oversized.count; ++i)
+        _tpGLSpatialIndexVisit(idx, idx->oversized.array[i], &rect, _outPaths, _maxCount, &count);
+
+    /* if the rect covers more cells than there are, it's cheaper to check all entries */
+    if ((_maxX - _minX) * idx->invCellSize + 1 > idx->cellCount ||
+            (_maxY - _minY) * idx->invCellSize + 1 > idx->cellCount ||
+            ((_maxX - _minX) * idx->invCellSize + 1) * ((_maxY - _minY) * idx->invCellSize + 1) > idx->cellCount)
+    {
+        for (i = 0; i < idx->entries.count; ++i)
+        {
+            if (tpPathIsValidHandle(idx->entries.array[i].path))
+                _tpGLSpatialIndexVisit(idx, i, &rect, _outPaths, _maxCount, &count);
+        }
+        return count;
+    }
+
+    c0 = (int)floor(_minX * idx->invCellSize);
+    r0 = (int)floor(_minY * idx->invCellSize);
+    c1 = (int)floor(_maxX * idx->invCellSize);
+    r1 = (int)floor(_maxY * idx->invCellSize);
+    for (y = r0; y <= r1; ++y)
+    {
+        for (x = c0; x <= c1; ++x)
+        {
+            cell = _tpGLSpatialIndexFindCell(idx, x, y);
+            if (!cell)
+                continue;
+            for (i = 0; i < cell->entries.count; ++i)
+                _tpGLSpatialIndexVisit(idx, cell->entries.array[i], &rect, _outPaths, _maxCount, &count);
+        }
+    }
+
+    return count;
+}
+
+TARP_LOCAL tpBool _tpGLGenerateClippingMask(_tpGLContext * _ctx, _tpGLPath * _path, tpBool _bIsRebuilding)
+{
+    tpBool drawResult;
+    assert(_ctx);
+
+    if (!_bIsRebuilding)
+        _ctx->clippingStack[_ctx->clippingStackDepth++] = _path;
+
+    /*
+    @TODO: Instead of clearing maybe just clear it in endClipping by
+    drawing the bounds of the last clip path? could be a potential speed up
+    */
+    _TARP_ASSERT_NO_GL_ERROR(glStencilMask(_ctx->currentClipStencilPlane));
+    _TARP_ASSERT_NO_GL_ERROR(glClearStencil(0));
+    _TARP_ASSERT_NO_GL_ERROR(glClear(GL_STENCIL_BUFFER_BIT));
+
+    /* draw path */
+    drawResult = _tpGLDrawPathImpl(_ctx, _path, &_ctx->clippingStyle, 0, tpTrue);
+    if (drawResult) return tpTrue;
+
+    _ctx->currentClipStencilPlane = _ctx->currentClipStencilPlane == _kTpGLClippingStencilPlaneOne ?
+                                    _kTpGLClippingStencilPlaneTwo : _kTpGLClippingStencilPlaneOne;
+
+    return tpFalse;
+}
+
+TARP_API tpBool tpBeginClipping(tpContext _ctx, tpPath _path)
+{
+    _tpGLContext * ctx = (_tpGLContext *)_ctx.pointer;
+    if (ctx->recordList)
+        return _tpGLRecordCommand(ctx, _kTpGLCommandBeginClipping, (_tpGLPath *)_path.pointer, NULL, &ctx->clippingStyle);
+    return _tpGLGenerateClippingMask(ctx, (_tpGLPath *)_path.pointer, tpFalse);
+}
+
+TARP_LOCAL tpBool _tpGLEndClippingImpl(_tpGLContext * _ctx)
+{
+    int i;
+    _tpGLPath * p;
+    assert(_ctx->clippingStackDepth);
+    p = _ctx->clippingStack[--_ctx->clippingStackDepth];
+
+    if (_ctx->clippingStackDepth)
+    {
+        /* check if the last clip mask is still in one of the clipping planes... */
+        if (_ctx->bCanSwapStencilPlanes)
+        {
+            _ctx->currentClipStencilPlane = _ctx->currentClipStencilPlane == _kTpGLClippingStencilPlaneOne ?
+                                           _kTpGLClippingStencilPlaneTwo : _kTpGLClippingStencilPlaneOne;
+            _ctx->bCanSwapStencilPlanes = tpFalse;
+        }
+        else
+        {
+            /* ...otherwise rebuild it */
+            _TARP_ASSERT_NO_GL_ERROR(glStencilMask(_kTpGLClippingStencilPlaneOne | _kTpGLClippingStencilPlaneTwo));
+            _TARP_ASSERT_NO_GL_ERROR(glClearStencil(255));
+            _TARP_ASSERT_NO_GL_ERROR(glClear(GL_STENCIL_BUFFER_BIT));
+
+            for (i = 0; i < _ctx->clippingStackDepth; ++i)
+            {
+                /* draw clip path */
+                _tpGLGenerateClippingMask(_ctx, _ctx->clippingStack[i], tpTrue);
+            }
+
+            _ctx->bCanSwapStencilPlanes = tpTrue;
+        }
+    }
+    else
+    {
+        /*
+        @TODO: Instead of clearing maybe just redrawing the clipping path bounds to
+        reset the stencil? Might scale better for a lot of paths :)
+        */
+        _TARP_ASSERT_NO_GL_ERROR(glStencilMask(_kTpGLClippingStencilPlaneOne | _kTpGLClippingStencilPlaneTwo));
+        _TARP_ASSERT_NO_GL_ERROR(glClearStencil(255));
+        _TARP_ASSERT_NO_GL_ERROR(glClear(GL_STENCIL_BUFFER_BIT));
+    }
+
+    return tpFalse;
+}
+
+TARP_API tpBool tpEndClipping(tpContext _ctx)
+{
+    _tpGLContext * ctx = (_tpGLContext *)_ctx.pointer;
+    if (ctx->recordList)
+        return _tpGLRecordCommand(ctx, _kTpGLCommandEndClipping, NULL, NULL, NULL);
+    return _tpGLEndClippingImpl(ctx);
+}
+
+TARP_LOCAL tpBool _tpGLResetClippingImpl(_tpGLContext * _ctx)
+{
+    _TARP_ASSERT_NO_GL_ERROR(glStencilMask(_kTpGLClippingStencilPlaneOne | _kTpGLClippingStencilPlaneTwo));
+    _TARP_ASSERT_NO_GL_ERROR(glClearStencil(0));
+    _TARP_ASSERT_NO_GL_ERROR(glClear(GL_STENCIL_BUFFER_BIT));
+
+    _ctx->currentClipStencilPlane = _kTpGLClippingStencilPlaneOne;
+    _ctx->clippingStackDepth = 0;
+
+    return tpFalse;
+}
+
+TARP_API tpBool tpResetClipping(tpContext _ctx)
+{
+    _tpGLContext * ctx = (_tpGLContext *)_ctx.pointer;
+    if (ctx->recordList)
+        return _tpGLRecordCommand(ctx, _kTpGLCommandResetClipping, NULL, NULL, NULL);
+    return _tpGLResetClippingImpl(ctx);
+}
+
+TARP_API tpBool tpSetProjection(tpContext _ctx, const tpMat4 * _projection)
+{
+    _tpGLContext * ctx = (_tpGLContext *)_ctx.pointer;
+    ctx->projection = *_projection;
+    ctx->projectionID++;
+    ctx->bTransformProjDirty = tpTrue;
+
+    return tpFalse;
+}
+
+TARP_LOCAL void _tpGLSetTransform(_tpGLContext * _ctx, const tpTransform * _transform)
+{
+    tpFloat rotation;
+    _tpGLContext * ctx = _ctx;
+
+    if (!tpTransformEquals(_transform, &ctx->transform))
+    {
+        tpVec2 scale, skew, translation;
+        ctx->transform = *_transform;
+        ctx->transformID++;
+        ctx->bTransformProjDirty = tpTrue;
+
+        tpTransformDecompose(_transform, &translation, &scale, &skew, &rotation);
+        ctx->transformScale = TARP_MAX(scale.x, scale.y);
+    }
+}
+
+TARP_API tpBool tpSetTransform(tpContext _ctx, const tpTransform * _transform)
+{
+    _tpGLSetTransform((_tpGLContext *)_ctx.pointer, _transform);
+    return tpFalse;
+}
+
+TARP_API tpBool tpResetTransform(tpContext _ctx)
+{
+    _tpGLContext * ctx = (_tpGLContext *)_ctx.pointer;
+    ctx->transform = tpTransformMakeIdentity();
     ctx->transformScale = 1.0;
     ctx->transformID++;
     ctx->bTransformProjDirty = tpTrue;
     return tpFalse;
 }
 
+TARP_LOCAL tpBool _tpGLPaintEquals(const tpPaint * _a, int _versionA, const tpPaint * _b, int _versionB)
+{
+    if (_a->type != _b->type)
+        return tpFalse;
+    if (_a->type == kTpPaintTypeColor)
+        return (tpBool)(memcmp(&_a->data.color, &_b->data.color, sizeof(tpColor)) == 0);
+    if (_a->type == kTpPaintTypeGradient)
+        return (tpBool)(_a->data.gradient.pointer == _b->data.gradient.pointer && _versionA == _versionB);
+    if (_a->type == kTpPaintTypePattern)
+        return (tpBool)(_a->data.pattern.pointer == _b->data.pattern.pointer && _versionA == _versionB);
+    return tpTrue;
+}
+
+/* checks if two recorded commands produce the same pixels */
+TARP_LOCAL tpBool _tpGLCommandEquals(const _tpGLCommand * _a, const _tpGLCommandList * _listA,
+                                     const _tpGLCommand * _b, const _tpGLCommandList * _listB)
+{
+    const tpStyle * sa = &_a->style;
+    const tpStyle * sb = &_b->style;
+
+    if (_a->type != _b->type ||
+            _a->path != _b->path ||
+            _a->layer != _b->layer ||
+            _a->glyphCache != _b->glyphCache ||
+            _a->version != _b->version ||
+            _a->clipSignature != _b->clipSignature ||
+            memcmp(&_a->transform, &_b->transform, sizeof(tpTransform)) != 0 ||
+            memcmp(&_a->projection, &_b->projection, sizeof(tpMat4)) != 0)
+        return tpFalse;
+
+    if (_a->glyphCache)
+        return (tpBool)(_a->glyphSize == _b->glyphSize &&
+                        _a->glyphCount == _b->glyphCount &&
+                        _tpGLPaintEquals(&sa->fill, 0, &sb->fill, 0) &&
+                        (!_a->glyphCount || memcmp(_listA->glyphs.array + _a->glyphStart, _listB->glyphs.array + _b->glyphStart,
+                                sizeof(tpGlyphInstance) * _a->glyphCount) == 0));
+
+    if (!_a->path)
+        return tpTrue;
+
+    /* the same style handle version always holds the same style, only its gradients might have changed */
+    if (_a->styleVersion && _a->styleVersion == _b->styleVersion)
+        return (tpBool)(_a->fillPaintVersion == _b->fillPaintVersion &&
+                        _a->strokePaintVersion == _b->strokePaintVersion);
+
+    return (tpBool)(_tpGLPaintEquals(&sa->fill, _a->fillPaintVersion, &sb->fill, _b->fillPaintVersion) &&
+                    _tpGLPaintEquals(&sa->stroke, _a->strokePaintVersion, &sb->stroke, _b->strokePaintVersion) &&
+                    sa->strokeWidth == sb->strokeWidth &&
+                    sa->strokeCap == sb->strokeCap &&
+                    sa->strokeJoin == sb->strokeJoin &&
+                    sa->fillRule == sb->fillRule &&
+                    sa->dashCount == sb->dashCount &&
+                    sa->dashOffset == sb->dashOffset &&
+                    sa->miterLimit == sb->miterLimit &&
+                    sa->scaleStroke == sb->scaleStroke &&
+                    (!sa->dashCount || memcmp(_listA->dashes.array + _a->dashStart, _listB->dashes.array + _b->dashStart,
+                            sizeof(tpFloat) * sa->dashCount) == 0));
+}
+
+TARP_LOCAL tpBool _tpGLCommandListEquals(const _tpGLCommandList * _a, const _tpGLCommandList * _b)
+{
+    int i;
+    if (_a->commands.count != _b->commands.count)
+        return tpFalse;
+    for (i = 0; i < _a->commands.count; ++i)
+    {
+        if (!_tpGLCommandEquals(&_a->commands.array[i], _a, &_b->commands.array[i], _b))
+            return tpFalse;
+    }
+    return tpTrue;
+}
+
+TARP_LOCAL void _tpGLCommandListSwap(_tpGLCommandList * _a, _tpGLCommandList * _b)
+{
+    _tpGLCommandArraySwap(&_a->commands, &_b->commands);
+    _tpFloatArraySwap(&_a->dashes, &_b->dashes);
+    _tpGlyphInstanceArraySwap(&_a->glyphs, &_b->glyphs);
+}
+
+TARP_LOCAL int _tpGLCommandKeyComp(const void * _a, const void * _b)
+{
+    const _tpGLCommandKey * a = (const _tpGLCommandKey *)_a;
+    const _tpGLCommandKey * b = (const _tpGLCommandKey *)_b;
+    if (a->object != b->object)
+        return (size_t)a->object < (size_t)b->object ? -1 : 1;
+    if (a->type != b->type)
+        return a->type < b->type ? -1 : 1;
+    return a->index < b->index ? -1 : a->index > b->index;
+}
+
+TARP_LOCAL tpBool _tpGLBuildCommandKeys(_tpGLCommandArray * _commands, _tpGLCommandKeyArray * _outKeys)
+{
+    int i;
+    _tpGLCommandKey key;
+
+    _tpGLCommandKeyArrayClear(_outKeys);
+    if (_commands->count > _outKeys->capacity && _tpGLCommandKeyArrayReserve(_outKeys, _commands->count))
+        return tpTrue;
+
+    for (i = 0; i < _commands->count; ++i)
+    {
+        if (_commands->array[i].path)
+            key.object = _commands->array[i].path;
+        else if (_commands->array[i].layer)
+            key.object = _commands->array[i].layer;
+        else
+            key.object = _commands->array[i].glyphCache;
+        key.type = _commands->array[i].type;
+        key.index = i;
+        _tpGLCommandKeyArrayAppendPtr(_outKeys, &key);
+        _commands->array[i].match = -1;
+    }
+    qsort(_outKeys->array, _outKeys->count, sizeof(_tpGLCommandKey), _tpGLCommandKeyComp);
+    return tpFalse;
+}
+
+TARP_LOCAL tpFloat _tpGLRectArea(const _tpGLRect * _rect)
+{
+    return (_rect->max.x - _rect->min.x) * (_rect->max.y - _rect->min.y);
+}
+
+TARP_LOCAL void _tpGLRectMerge(_tpGLRect * _a, const _tpGLRect * _b)
+{
+    _a->min.x = TARP_MIN(_a->min.x, _b->min.x);
+    _a->min.y = TARP_MIN(_a->min.y, _b->min.y);
+    _a->max.x = TARP_MAX(_a->max.x, _b->max.x);
+    _a->max.y = TARP_MAX(_a->max.y, _b->max.y);
+}
+
+TARP_LOCAL tpBool _tpGLRectsOverlap(const _tpGLRect * _a, const _tpGLRect * _b)
+{
+    return (tpBool)(_a->min.x < _b->max.x && _a->max.x > _b->min.x &&
+                    _a->min.y < _b->max.y && _a->max.y > _b->min.y);
+}
+
+/*
+adds a rectangle to the damaged regions of the frame. Overlapping regions are merged and if there are
+too many, the two that grow the least when merged are combined.
+*/
+TARP_LOCAL void _tpGLAddDamage(_tpGLContext * _ctx, const _tpGLRect * _rect)
+{
+    int i, j, bestI, bestJ;
+    tpFloat cost, bestCost;
+    _tpGLRect r, merged;
+
+    /* clamp to the viewport */
+    r.min.x = TARP_MAX(_rect->min.x, _ctx->viewport[0]);
+    r.min.y = TARP_MAX(_rect->min.y, _ctx->viewport[1]);
+    r.max.x = TARP_MIN(_rect->max.x, _ctx->viewport[0] + _ctx->viewport[2]);
+    r.max.y = TARP_MIN(_rect->max.y, _ctx->viewport[1] + _ctx->viewport[3]);
+    if (r.min.x >= r.max.x || r.min.y >= r.max.y)
+        return;
+
+    /* merge with everything it overlaps, which might make the result overlap others again */
+    for (i = 0; i < _ctx->damageCount; ++i)
+    {
+        if (_tpGLRectsOverlap(&r, &_ctx->damage[i]))
+        {
+            _tpGLRectMerge(&r, &_ctx->damage[i]);
+            _ctx->damage[i] = _ctx->damage[--_ctx->damageCount];
+            i = -1;
+        }
+    }
+    _ctx->damage[_ctx->damageCount++] = r;
+
+    if (_ctx->damageCount <= TARP_GL_MAX_DAMAGE_RECTS)
+        return;
+
+    bestI = 0;
+    bestJ = 1;
+    bestCost = FLT_MAX;
+    for (i = 0; i < _ctx->damageCount; ++i)
+    {
+        for (j = i + 1; j < _ctx->damageCount; ++j)
+        {
+            merged = _ctx->damage[i];
+            _tpGLRectMerge(&merged, &_ctx->damage[j]);
+            cost = _tpGLRectArea(&merged) - _tpGLRectArea(&_ctx->damage[i]) - _tpGLRectArea(&_ctx->damage[j]);
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                bestI = i;
+                bestJ = j;
+            }
+        }
+    }
+    merged = _ctx->damage[bestI];
+    _tpGLRectMerge(&merged, &_ctx->damage[bestJ]);
+    _ctx->damage[bestJ] = _ctx->damage[--_ctx->damageCount];
+    _ctx->damage[bestI] = _ctx->damage[--_ctx->damageCount];
+    _tpGLAddDamage(_ctx, &merged);
+}
+
+/* matches the commands of this frame with the ones of the last frame and collects what changed */
+TARP_LOCAL tpBool _tpGLComputeDamage(_tpGLContext * _ctx)
+{
+    int i, j, cmp, maxMatch;
+    _tpGLCommand * cmd, * last;
+    _tpGLCommandArray * commands = &_ctx->frame.commands;
+    _tpGLCommandArray * lastCommands = &_ctx->lastFrame.commands;
+    _tpGLRect viewport;
+
+    _ctx->damageCount = 0;
+    if (_ctx->bRetainedFullRedraw || memcmp(_ctx->viewport, _ctx->lastViewport, sizeof(_ctx->viewport)) != 0)
+    {
+        viewport.min = tpVec2Make(_ctx->viewport[0], _ctx->viewport[1]);
+        viewport.max = tpVec2Make(_ctx->viewport[0] + _ctx->viewport[2], _ctx->viewport[1] + _ctx->viewport[3]);
+        _tpGLAddDamage(_ctx, &viewport);
+        return tpFalse;
+    }
+
+    if (_tpGLBuildCommandKeys(commands, &_ctx->tmpKeys) ||
+            _tpGLBuildCommandKeys(lastCommands, &_ctx->tmpLastKeys))
+    {
+        _tpGLSetErrorMessage("Could not allocate memory for the retained frame.");
+        return tpTrue;
+    }
+
+    /* the nth occurence of a path in this frame is matched with its nth occurence in the last one */
+    for (i = 0, j = 0; i < _ctx->tmpKeys.count && j < _ctx->tmpLastKeys.count;)
+    {
+        cmp = _ctx->tmpKeys.array[i].object != _ctx->tmpLastKeys.array[j].object ?
+              ((size_t)_ctx->tmpKeys.array[i].object < (size_t)_ctx->tmpLastKeys.array[j].object ? -1 : 1) :
+              (int)_ctx->tmpKeys.array[i].type - (int)_ctx->tmpLastKeys.array[j].type;
+        if (cmp < 0)
+            ++i;
+        else if (cmp > 0)
+            ++j;
+        else
+        {
+            commands->array[_ctx->tmpKeys.array[i].index].match = _ctx->tmpLastKeys.array[j].index;
+            lastCommands->array[_ctx->tmpLastKeys.array[j].index].match = _ctx->tmpKeys.array[i].index;
+            ++i;
+            ++j;
+        }
+    }
+
+    /* everything that disappeared */
+    for (i = 0; i < lastCommands->count; ++i)
+    {
+        if (lastCommands->array[i].match == -1)
+            _tpGLAddDamage(_ctx, &lastCommands->array[i].bounds);
+    }
+
+    /* everything that is new, changed or changed its drawing order */
+    maxMatch = -1;
+    for (i = 0; i < commands->count; ++i)
+    {
+        cmd = &commands->array[i];
+        if (cmd->match == -1)
+        {
+            _tpGLAddDamage(_ctx, &cmd->bounds);
+            continue;
+        }
+
+        last = &lastCommands->array[cmd->match];
+        if (cmd->match < maxMatch || !_tpGLCommandEquals(cmd, &_ctx->frame, last, &_ctx->lastFrame))
+        {
+            _tpGLAddDamage(_ctx, &last->bounds);
+            _tpGLAddDamage(_ctx, &cmd->bounds);
+        }
+        else
+            maxMatch = cmd->match;
+    }
+
+    return tpFalse;
+}
+
+TARP_LOCAL void _tpGLSetProjection(_tpGLContext * _ctx, const tpMat4 * _projection)
+{
+    if (memcmp(_projection, &_ctx->projection, sizeof(tpMat4)) != 0)
+    {
+        _ctx->projection = *_projection;
+        _ctx->projectionID++;
+        _ctx->bTransformProjDirty = tpTrue;
+    }
+}
+
+TARP_LOCAL tpBool _tpGLDrawLayerImpl(_tpGLContext * _ctx, _tpGLLayer * _layer);
+
+/* draws a single recorded command of a list (see _tpGLReplayCommands) */
+TARP_LOCAL tpBool _tpGLReplayCommand(_tpGLContext * _ctx, _tpGLCommandList * _list,
+                                     _tpGLCommand * _cmd, const tpTransform * _layerTransform)
+{
+    tpStyle style;
+    tpTransform transform;
+
+    if (_cmd->path || _cmd->layer || _cmd->glyphCache)
+    {
+        if (_layerTransform)
+        {
+            transform = tpTransformCombine(_layerTransform, &_cmd->transform);
+            _tpGLSetTransform(_ctx, &transform);
+        }
+        else
+        {
+            _tpGLSetTransform(_ctx, &_cmd->transform);
+            _tpGLSetProjection(_ctx, &_cmd->projection);
+        }
+    }
+
+    switch (_cmd->type)
+    {
+    case _kTpGLCommandDrawPath:
+        style = _cmd->style;
+        style.dashArray = style.dashCount ? _list->dashes.array + _cmd->dashStart : NULL;
+        return _tpGLDrawPathImpl(_ctx, _cmd->path, &style, _cmd->styleVersion, tpFalse);
+    case _kTpGLCommandBeginClipping:
+        return _tpGLGenerateClippingMask(_ctx, _cmd->path, tpFalse);
+    case _kTpGLCommandEndClipping:
+        return _tpGLEndClippingImpl(_ctx);
+    case _kTpGLCommandResetClipping:
+        return _tpGLResetClippingImpl(_ctx);
+    case _kTpGLCommandDrawLayer:
+        return _tpGLDrawLayerImpl(_ctx, _cmd->layer);
+    case _kTpGLCommandDrawGlyphRun:
+        return _tpGLDrawGlyphRunImpl(_ctx, _cmd->glyphCache, _list->glyphs.array + _cmd->glyphStart, _cmd->glyphCount,
+                                     _cmd->glyphSize, _cmd->style.fill.data.color);
+    }
+    return tpFalse;
+}
+
+TARP_LOCAL tpBool _tpGLPaintIsOpaque(const tpPaint * _paint)
+{
+    int i;
+    _tpGLGradient * grad;
+
+    if (_paint->type == kTpPaintTypeColor)
+        return (tpBool)(_paint->data.color.a >= 1.0f);
+    if (_paint->type == kTpPaintTypeGradient)
+    {
+        grad = (_tpGLGradient *)_paint->data.gradient.pointer;
+        for (i = 0; i < grad->stops.count; ++i)
+        {
+            if (grad->stops.array[i].color.a < 1.0f)
+                return tpFalse;
+        }
+    }
+    /* the tile of a pattern is rendered on demand, so we don't know */
+    if (_paint->type == kTpPaintTypePattern)
+        return tpFalse;
+    return tpTrue;
+}
+
+/* adds the opaque fill of a recorded convex path to the occluders */
+TARP_LOCAL void _tpGLAddOccluder(_tpGLContext * _ctx, const _tpGLCommand * _cmd)
+{
+    int i, j, offset, count;
+    tpFloat area;
+    tpVec2 p;
+    _tpGLContour * c;
+    _tpGLOccluder occ;
+    tpTransform transform;
+    _tpGLPath * path = _cmd->path;
+
+    /* simplification can cut into the polygon */
+    if (path->simplifyTolerance > 0 || !_tpGLPathIsConvex(path))
+        return;
+
+    transform = path->bHasTransform ? tpTransformCombine(&_cmd->transform, &path->transform) : _cmd->transform;
+
+    /*
+    the points on the curve of a convex contour span a polygon that is entirely inside of it,
+    which stays convex when mapped to window pixels.
+    */
+    c = _tpGLContourArrayAtPtr(&path->contours, 0);
+    count = c->bIsPolyline ? c->points.count : c->segments.count;
+    offset = _ctx->tmpOccluderPoints.count;
+    _tpGLInitBounds(&occ.bounds);
+    for (i = 0; i < count; ++i)
+    {
+        p = tpTransformApply(&transform, c->bIsPolyline ? c->points.array[i] : _tpGLSegmentBufferAtPtr(&c->segments, i)->position);
+        if (_tpGLWindowPoint(&_cmd->projection, _ctx->viewport, p, &p) || _tpVec2ArrayAppend(&_ctx->tmpOccluderPoints, p))
+        {
+            _ctx->tmpOccluderPoints.count = offset;
+            return;
+        }
+        _tpGLEvaluatePointForBounds(p, &occ.bounds);
+    }
+
+    area = 0;
+    for (i = 0; i < count; ++i)
+        area += tpVec2Cross(_ctx->tmpOccluderPoints.array[offset + i], _ctx->tmpOccluderPoints.array[offset + (i + 1) % count]);
+    if (area == 0)
+    {
+        _ctx->tmpOccluderPoints.count = offset;
+        return;
+    }
+
+    occ.pointOffset = offset;
+    occ.pointCount = count;
+    occ.orientation = area > 0 ? 1 : -1;
+
+    /* if there are too many occluders, replace the smallest one if this one is bigger */
+    if (_ctx->occluderCount < TARP_GL_MAX_OCCLUDERS)
+    {
+        _ctx->occluders[_ctx->occluderCount++] = occ;
+        return;
+    }
+    j = 0;
+    for (i = 1; i < TARP_GL_MAX_OCCLUDERS; ++i)
+    {
+        if (_tpGLRectArea(&_ctx->occluders[i].bounds) < _tpGLRectArea(&_ctx->occluders[j].bounds))
+            j = i;
+    }
+    if (_tpGLRectArea(&occ.bounds) > _tpGLRectArea(&_ctx->occluders[j].bounds))
+        _ctx->occluders[j] = occ;
+}
+
+TARP_LOCAL tpBool _tpGLIsOccluded(_tpGLContext * _ctx, const _tpGLRect * _bounds)
+{
+    int i, j, k;
+    tpVec2 corners[4], a, b;
+    _tpGLOccluder * occ;
+
+    corners[0] = _bounds->min;
+    corners[1] = tpVec2Make(_bounds->min.x, _bounds->max.y);
+    corners[2] = tpVec2Make(_bounds->max.x, _bounds->min.y);
+    corners[3] = _bounds->max;
+
+    for (i = 0; i < _ctx->occluderCount; ++i)
+    {
+        occ = &_ctx->occluders[i];
+        if (!_tpGLRectContains(&occ->bounds, _bounds->min) || !_tpGLRectContains(&occ->bounds, _bounds->max))
+            continue;
+
+        /* the bounds are inside of the convex polygon if all of their corners are */
+        for (j = 0; j < occ->pointCount; ++j)
+        {
+            a = _ctx->tmpOccluderPoints.array[occ->pointOffset + j];
+            b = _ctx->tmpOccluderPoints.array[occ->pointOffset + (j + 1) % occ->pointCount];
+            for (k = 0; k < 4; ++k)
+            {
+                if (tpVec2Cross(tpVec2Sub(b, a), tpVec2Sub(corners[k], a)) * occ->orientation < 0)
+                    break;
+            }
+            if (k < 4)
+                break;
+        }
+        if (j == occ->pointCount)
+            return tpTrue;
+    }
+    return tpFalse;
+}
+
+/*
+marks the draw commands of a list that are entirely covered by the opaque fill of a later convex path.
+We walk the list back to front, collecting occluders until we hit a clipping command.
+*/
+TARP_LOCAL void _tpGLCullOccluded(_tpGLContext * _ctx, _tpGLCommandList * _list)
+{
+    int i;
+    _tpGLCommand * cmd;
+
+    _ctx->occluderCount = 0;
+    _tpVec2ArrayClear(&_ctx->tmpOccluderPoints);
+
+    for (i = _list->commands.count - 1; i >= 0; --i)
+    {
+        cmd = &_list->commands.array[i];
+        cmd->bCulled = tpFalse;
+        if (!_tpGLCommandIsDraw(cmd))
+        {
+            _ctx->occluderCount = 0;
+            _tpVec2ArrayClear(&_ctx->tmpOccluderPoints);
+            continue;
+        }
+        if (cmd->bounds.min.x > cmd->bounds.max.x)
+            continue;
+
+        if (_tpGLIsOccluded(_ctx, &cmd->bounds))
+            cmd->bCulled = tpTrue;
+        else if (cmd->path && cmd->style.fill.type != kTpPaintTypeNone && _tpGLPaintIsOpaque(&cmd->style.fill))
+            _tpGLAddOccluder(_ctx, cmd);
+    }
+}
+
+TARP_LOCAL int _tpGLDepthKeyComp(const void * _a, const void * _b)
+{
+    const _tpGLDepthKey * a = (const _tpGLDepthKey *)_a;
+    const _tpGLDepthKey * b = (const _tpGLDepthKey *)_b;
+
+    /* opaque commands come first, grouped by paint and front to back within a group */
+    if (a->bOpaque != b->bOpaque)
+        return a->bOpaque ? -1 : 1;
+    if (a->bOpaque)
+    {
+        if (a->paint != b->paint)
+            return (size_t)a->paint < (size_t)b->paint ? -1 : 1;
+        return b->slot - a->slot;
+    }
+    /* translucent ones need to stay in painter's order */
+    return a->slot - b->slot;
+}
+
+/*
+Replays the draw commands with a depth test, each one at its own depth slot. This allows drawing opaque
+commands out of order (see tpSetDepthOrdering). Clipping commands modify the stencil planes that all
+following draws depend on, so only the runs of draw commands between them are reordered.
+*/
+TARP_LOCAL tpBool _tpGLReplayCommandsDepthOrdered(_tpGLContext * _ctx, _tpGLCommandList * _list,
+                                                  const _tpGLRect * _region, const tpTransform * _layerTransform)
+{
+    int i, j, k, slot;
+    tpBool err = tpFalse;
+    _tpGLCommand * cmd;
+    _tpGLDepthKey key;
+    /* this might be a layer rendered while replaying another list */
+    tpBool bDepthTest = _ctx->bDepthTest;
+    tpBool bDepthWrite = _ctx->bDepthWrite;
+    tpFloat depth = _ctx->depth;
+
+    _TARP_ASSERT_NO_GL_ERROR(glEnable(GL_DEPTH_TEST));
+    _TARP_ASSERT_NO_GL_ERROR(glDepthFunc(GL_GREATER));
+    _TARP_ASSERT_NO_GL_ERROR(glDepthMask(GL_TRUE));
+    _TARP_ASSERT_NO_GL_ERROR(glClearDepth(0.0));
+    _TARP_ASSERT_NO_GL_ERROR(glClear(GL_DEPTH_BUFFER_BIT));
+    _TARP_ASSERT_NO_GL_ERROR(glDepthMask(GL_FALSE));
+    slot = 1;
+
+    for (i = 0; i < _list->commands.count && !err; i = j)
+    {
+        cmd = &_list->commands.array[i];
+        if (!_tpGLCommandIsDraw(cmd))
+        {
+            /* clipping masks need to be complete, no matter what was drawn before */
+            _ctx->bDepthTest = tpFalse;
+            _TARP_ASSERT_NO_GL_ERROR(glDisable(GL_DEPTH_TEST));
+            err = _tpGLReplayCommand(_ctx, _list, cmd, _layerTransform);
+            _TARP_ASSERT_NO_GL_ERROR(glEnable(GL_DEPTH_TEST));
+            j = i + 1;
+            continue;
+        }
+
+        /* find the run of draw commands up to the next clipping command */
+        for (j = i; j < _list->commands.count && j - i < TARP_GL_MAX_DEPTH_SLOTS / 2 - 1 &&
+                _tpGLCommandIsDraw(&_list->commands.array[j]); ++j);
+
+        /* start over if we ran out of depth slots, everything drawn so far is final */
+        if (slot + (j - i) * 2 >= TARP_GL_MAX_DEPTH_SLOTS)
+        {
+            _TARP_ASSERT_NO_GL_ERROR(glDepthMask(GL_TRUE));
+            _TARP_ASSERT_NO_GL_ERROR(glClear(GL_DEPTH_BUFFER_BIT));
+            _TARP_ASSERT_NO_GL_ERROR(glDepthMask(GL_FALSE));
+            slot = 1;
+        }
+
+        _tpGLDepthKeyArrayClear(&_ctx->tmpDepthKeys);
+        for (k = i; k < j; ++k)
+        {
+            cmd = &_list->commands.array[k];
+            if (cmd->bCulled || (_region && !_tpGLRectsOverlap(&cmd->bounds, _region)))
+                continue;
+
+            key.index = k;
+            key.slot = slot;
+            /* paths take two slots, one for the fill and one for the stroke */
+            slot += cmd->path ? 2 : 1;
+            key.bOpaque = (tpBool)((cmd->path || cmd->glyphCache) &&
+                                   (cmd->style.fill.type != kTpPaintTypeNone || cmd->style.stroke.type != kTpPaintTypeNone) &&
+                                   _tpGLPaintIsOpaque(&cmd->style.fill) && _tpGLPaintIsOpaque(&cmd->style.stroke));
+            key.paint = NULL;
+            if (cmd->path && cmd->style.fill.type == kTpPaintTypeGradient)
+                key.paint = cmd->style.fill.data.gradient.pointer;
+            else if (cmd->path && cmd->style.stroke.type == kTpPaintTypeGradient)
+                key.paint = cmd->style.stroke.data.gradient.pointer;
+            _tpGLDepthKeyArrayAppendPtr(&_ctx->tmpDepthKeys, &key);
+        }
+
+        if (!_ctx->tmpDepthKeys.count)
+            continue;
+        qsort(_ctx->tmpDepthKeys.array, _ctx->tmpDepthKeys.count, sizeof(_tpGLDepthKey), _tpGLDepthKeyComp);
+
+        for (k = 0; k < _ctx->tmpDepthKeys.count && !err; ++k)
+        {
+            key = _ctx->tmpDepthKeys.array[k];
+            _ctx->bDepthTest = tpTrue;
+            _ctx->bDepthWrite = key.bOpaque;
+            _ctx->depth = (tpFloat)key.slot * 2.0f / TARP_GL_MAX_DEPTH_SLOTS - 1.0f;
+            err = _tpGLReplayCommand(_ctx, _list, &_list->commands.array[key.index], _layerTransform);
+        }
+    }
+
+    _ctx->bDepthTest = bDepthTest;
+    _ctx->bDepthWrite = bDepthWrite;
+    _ctx->depth = depth;
+    if (!bDepthTest)
+        _TARP_ASSERT_NO_GL_ERROR(glDisable(GL_DEPTH_TEST));
+
+    return err;
+}
+
+/*
+draws the recorded commands of a list. If _region is not NULL, draw commands outside of it are skipped.
+If _layerTransform is not NULL, the commands are drawn into a layer with the transform placing them in
+its texture prepended to theirs. Otherwise they are drawn with the transform and projection they were
+recorded with.
+*/
+TARP_LOCAL tpBool _tpGLReplayCommands(_tpGLContext * _ctx, _tpGLCommandList * _list,
+                                      const _tpGLRect * _region, const tpTransform * _layerTransform)
+{
+    int i;
+    tpBool err = tpFalse;
+    _tpGLCommand * cmd;
+
+    if (_ctx->bDepthOrdering)
+    {
+        err = _tpGLReplayCommandsDepthOrdered(_ctx, _list, _region, _layerTransform);
+    }
+    else
+    {
+        for (i = 0; i < _list->commands.count && !err; ++i)
+        {
+            cmd = &_list->commands.array[i];
+
+            /* clipping commands are always replayed to keep the clipping stack intact */
+            if (cmd->bCulled || (_region && _tpGLCommandIsDraw(cmd) && !_tpGLRectsOverlap(&cmd->bounds, _region)))
+                continue;
+
+            err = _tpGLReplayCommand(_ctx, _list, cmd, _layerTransform);
+        }
+    }
+
+    /* the stencil planes are shared by all regions, so we leave no clipping behind */
+    if (_ctx->clippingStackDepth)
+        _tpGLResetClippingImpl(_ctx);
+
+    return err;
+}
+
+TARP_LOCAL tpBool _tpGLRetainedFlush(_tpGLContext * _ctx)
+{
+    int i;
+    tpBool err;
+    tpTransform transform;
+    tpMat4 projection;
+    _tpGLRect * r;
+
+    _ctx->recordList = NULL;
+    err = _tpGLComputeDamage(_ctx);
+    if (!err && _ctx->damageCount)
+    {
+        if (_ctx->bOcclusionCulling)
+            _tpGLCullOccluded(_ctx, &_ctx->frame);
+
+        transform = _ctx->transform;
+        projection = _ctx->projection;
+
+        _TARP_ASSERT_NO_GL_ERROR(glEnable(GL_SCISSOR_TEST));
+        for (i = 0; i < _ctx->damageCount && !err; ++i)
+        {
+            r = &_ctx->damage[i];
+            _TARP_ASSERT_NO_GL_ERROR(glScissor((GLint)r->min.x, (GLint)r->min.y,
+                                               (GLsizei)(r->max.x - r->min.x), (GLsizei)(r->max.y - r->min.y)));
+
+            /* clear the region and draw it from scratch */
+            _TARP_ASSERT_NO_GL_ERROR(glClearColor(_ctx->retainedClearColor.r, _ctx->retainedClearColor.g,
+                                                  _ctx->retainedClearColor.b, _ctx->retainedClearColor.a));
+            _TARP_ASSERT_NO_GL_ERROR(glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE));
+            _TARP_ASSERT_NO_GL_ERROR(glStencilMask(_kTpGLFillRasterStencilPlane | _kTpGLClippingStencilPlaneOne | _kTpGLClippingStencilPlaneTwo | _kTpGLStrokeRasterStencilPlane));
+            _TARP_ASSERT_NO_GL_ERROR(glClearStencil(255));
+            _TARP_ASSERT_NO_GL_ERROR(glClear(GL_COLOR_BUFFER_BIT | GL_STENCIL_BUFFER_BIT));
+
+            _ctx->clippingStackDepth = 0;
+            _ctx->currentClipStencilPlane = _kTpGLClippingStencilPlaneOne;
+            _ctx->bCanSwapStencilPlanes = tpTrue;
+            err = _tpGLReplayCommands(_ctx, &_ctx->frame, r, NULL);
+        }
+        _TARP_ASSERT_NO_GL_ERROR(glDisable(GL_SCISSOR_TEST));
+
+        /* restore the state the application left the context in */
+        _tpGLSetTransform(_ctx, &transform);
+        _tpGLSetProjection(_ctx, &projection);
+    }
+
+    /* this frame becomes the one we compare the next one to */
+    _tpGLCommandListSwap(&_ctx->frame, &_ctx->lastFrame);
+    _tpGLCommandListClear(&_ctx->frame);
+    memcpy(_ctx->lastViewport, _ctx->viewport, sizeof(_ctx->viewport));
+    /* if anything went wrong, we can't trust the framebuffer contents anymore */
+    _ctx->bRetainedFullRedraw = err;
+
+    return err;
+}
+
+TARP_LOCAL tpBool _tpGLDeferredFlush(_tpGLContext * _ctx)
+{
+    tpBool err;
+    tpTransform transform = _ctx->transform;
+    tpMat4 projection = _ctx->projection;
+
+    _ctx->recordList = NULL;
+    if (_ctx->bOcclusionCulling)
+        _tpGLCullOccluded(_ctx, &_ctx->frame);
+    _ctx->clippingStackDepth = 0;
+    err = _tpGLReplayCommands(_ctx, &_ctx->frame, NULL, NULL);
+    _tpGLCommandListClear(&_ctx->frame);
+
+    _tpGLSetTransform(_ctx, &transform);
+    _tpGLSetProjection(_ctx, &projection);
+
+    return err;
+}
+
+TARP_API tpBool tpSetRetainedMode(tpContext _ctx, tpBool _bEnabled, tpColor _clearColor)
+{
+    _tpGLContext * ctx = (_tpGLContext *)_ctx.pointer;
+    if (ctx->currentLayer)
+    {
+        _tpGLSetErrorMessage("The retained mode can't be changed while recording a layer.");
+        return tpTrue;
+    }
+    if (ctx->bRetained != _bEnabled)
+    {
+        ctx->bRetained = _bEnabled;
+        ctx->bRetainedFullRedraw = tpTrue;
+        _tpGLCommandListClear(&ctx->frame);
+        _tpGLCommandListClear(&ctx->lastFrame);
+        ctx->recordList = NULL;
+        ctx->damageCount = 0;
+    }
+    if (memcmp(&ctx->retainedClearColor, &_clearColor, sizeof(tpColor)) != 0)
+    {
+        ctx->retainedClearColor = _clearColor;
+        ctx->bRetainedFullRedraw = tpTrue;
+    }
+    return tpFalse;
+}
+
+TARP_API void tpInvalidateRetainedFrame(tpContext _ctx)
+{
+    ((_tpGLContext *)_ctx.pointer)->bRetainedFullRedraw = tpTrue;
+}
+
+TARP_API int tpRetainedDamage(tpContext _ctx, int * _outRects, int _maxCount)
+{
+    int i;
+    _tpGLContext * ctx = (_tpGLContext *)_ctx.pointer;
+
+    for (i = 0; i < ctx->damageCount && i < _maxCount; ++i)
+    {
+        _outRects[i * 4] = (int)ctx->damage[i].min.x;
+        _outRects[i * 4 + 1] = (int)ctx->damage[i].min.y;
+        _outRects[i * 4 + 2] = (int)(ctx->damage[i].max.x - ctx->damage[i].min.x);
+        _outRects[i * 4 + 3] = (int)(ctx->damage[i].max.y - ctx->damage[i].min.y);
+    }
+    return ctx->damageCount;
+}
+
+TARP_API tpBool tpSetOcclusionCulling(tpContext _ctx, tpBool _bEnabled)
+{
+    _tpGLContext * ctx = (_tpGLContext *)_ctx.pointer;
+    if (ctx->recordList)
+    {
+        _tpGLSetErrorMessage("Occlusion culling can't be changed between tpPrepareDrawing and tpFinishDrawing.");
+        return tpTrue;
+    }
+    ctx->bOcclusionCulling = _bEnabled;
+    return tpFalse;
+}
+
+TARP_API tpBool tpSetMinimumPathSize(tpContext _ctx, tpFloat _pixels, tpSmallPathMode _mode)
+{
+    _tpGLContext * ctx = (_tpGLContext *)_ctx.pointer;
+    ctx->minimumPathSize = _pixels;
+    ctx->smallPathMode = _mode;
+    return tpFalse;
+}
+
+TARP_API tpBool tpSetDepthOrdering(tpContext _ctx, tpBool _bEnabled)
+{
+    _tpGLContext * ctx = (_tpGLContext *)_ctx.pointer;
+    if (ctx->recordList)
+    {
+        _tpGLSetErrorMessage("Depth ordering can't be changed between tpPrepareDrawing and tpFinishDrawing.");
+        return tpTrue;
+    }
+    ctx->bDepthOrdering = _bEnabled;
+    return tpFalse;
+}
+
+TARP_API tpLayer tpLayerCreate()
+{
+    tpLayer ret = {NULL};
+    _tpGLLayer * layer = (_tpGLLayer *)TARP_MALLOC(sizeof(_tpGLLayer));
+    if (!layer)
+        return ret;
+
+    memset(layer, 0, sizeof(_tpGLLayer));
+    _tpGLCommandListInit(&layer->list, tpFalse);
+    layer->bounds.min = tpVec2Make(FLT_MAX, FLT_MAX);
+    layer->bounds.max = tpVec2Make(-FLT_MAX, -FLT_MAX);
+    layer->version = _tpGLNextVersion();
+    layer->bDirty = tpTrue;
+
+    ret.pointer = layer;
+    return ret;
+}
+
+TARP_LOCAL void _tpGLLayerDeallocateTargets(_tpGLLayer * _layer)
+{
+    if (_layer->fbo)
+    {
+        _TARP_ASSERT_NO_GL_ERROR(glDeleteFramebuffers(1, &_layer->fbo));
+        _TARP_ASSERT_NO_GL_ERROR(glDeleteFramebuffers(1, &_layer->msaaFbo));
+        _TARP_ASSERT_NO_GL_ERROR(glDeleteTextures(1, &_layer->texture));
+        _TARP_ASSERT_NO_GL_ERROR(glDeleteRenderbuffers(1, &_layer->msaaColor));
+        _TARP_ASSERT_NO_GL_ERROR(glDeleteRenderbuffers(1, &_layer->msaaStencil));
+    }
+    _layer->fbo = _layer->msaaFbo = _layer->texture = _layer->msaaColor = _layer->msaaStencil = 0;
+    _layer->width = _layer->height = 0;
+}
+
+TARP_API void tpLayerDestroy(tpLayer _layer)
+{
+    _tpGLLayer * layer = (_tpGLLayer *)_layer.pointer;
+    if (layer)
+    {
+        _tpGLLayerDeallocateTargets(layer);
+        _tpGLCommandListDeallocate(&layer->list);
+        TARP_FREE(layer);
+    }
+}
+
+TARP_API tpBool tpBeginLayer(tpContext _ctx, tpLayer _layer)
+{
+    _tpGLContext * ctx = (_tpGLContext *)_ctx.pointer;
+    _tpGLLayer * layer = (_tpGLLayer *)_layer.pointer;
+
+    if (ctx->currentLayer)
+    {
+        _tpGLSetErrorMessage("Layers can't be nested.");
+        return tpTrue;
+    }
+
+    /* keep the old content around to check if it changed in tpEndLayer */
+    _tpGLCommandListSwap(&layer->list, &ctx->previousLayerList);
+    _tpGLCommandListClear(&layer->list);
+
+    ctx->layerParentList = ctx->recordList;
+    ctx->recordList = &layer->list;
+    ctx->currentLayer = layer;
+    return tpFalse;
+}
+
+TARP_API tpBool tpEndLayer(tpContext _ctx)
+{
+    int i;
+    _tpGLCommand * cmd;
+    _tpGLContext * ctx = (_tpGLContext *)_ctx.pointer;
+    _tpGLLayer * layer = ctx->currentLayer;
+
+    if (!layer)
+    {
+        _tpGLSetErrorMessage("tpEndLayer was called without a matching tpBeginLayer.");
+        return tpTrue;
+    }
+
+    if (!_tpGLCommandListEquals(&layer->list, &ctx->previousLayerList))
+    {
+        layer->bounds.min = tpVec2Make(FLT_MAX, FLT_MAX);
+        layer->bounds.max = tpVec2Make(-FLT_MAX, -FLT_MAX);
+        for (i = 0; i < layer->list.commands.count; ++i)
+        {
+            cmd = &layer->list.commands.array[i];
+            if ((cmd->type == _kTpGLCommandDrawPath || cmd->type == _kTpGLCommandDrawGlyphRun) && cmd->bounds.min.x <= cmd->bounds.max.x)
+            {
+                _tpGLEvaluatePointForBounds(cmd->bounds.min, &layer->bounds);
+                _tpGLEvaluatePointForBounds(cmd->bounds.max, &layer->bounds);
+            }
+        }
+        layer->version = _tpGLNextVersion();
+        layer->bDirty = tpTrue;
+    }
+    else
+    {
+        /* nothing changed, keep the bounds that were possibly refined since */
+        _tpGLCommandListSwap(&layer->list, &ctx->previousLayerList);
+    }
+
+    ctx->recordList = ctx->layerParentList;
+    ctx->currentLayer = NULL;
+    return tpFalse;
+}
+
+TARP_LOCAL tpBool _tpGLLayerAllocateTargets(_tpGLLayer * _layer, int _width, int _height)
+{
+    GLint samples;
+
+    _tpGLLayerDeallocateTargets(_layer);
+
+    _TARP_ASSERT_NO_GL_ERROR(glGetIntegerv(GL_MAX_SAMPLES, &samples));
+    samples = TARP_MIN(samples, TARP_GL_LAYER_SAMPLES);
+
+    _TARP_ASSERT_NO_GL_ERROR(glGenTextures(1, &_layer->texture));
+    _TARP_ASSERT_NO_GL_ERROR(glBindTexture(GL_TEXTURE_2D, _layer->texture));
+    _tpGLObjectLabel(GL_TEXTURE, _layer->texture, "tarp layer", _layer);
+    _TARP_ASSERT_NO_GL_ERROR(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, _width, _height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL));
+    _TARP_ASSERT_NO_GL_ERROR(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+    _TARP_ASSERT_NO_GL_ERROR(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR));
+    _TARP_ASSERT_NO_GL_ERROR(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, _layer->bTile ? GL_REPEAT : GL_CLAMP_TO_EDGE));
+    _TARP_ASSERT_NO_GL_ERROR(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, _layer->bTile ? GL_REPEAT : GL_CLAMP_TO_EDGE));
+    _TARP_ASSERT_NO_GL_ERROR(glBindTexture(GL_TEXTURE_2D, 0));
+
+    _TARP_ASSERT_NO_GL_ERROR(glGenFramebuffers(1, &_layer->fbo));
+    _TARP_ASSERT_NO_GL_ERROR(glBindFramebuffer(GL_FRAMEBUFFER, _layer->fbo));
+    _TARP_ASSERT_NO_GL_ERROR(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _layer->texture, 0));
+
+    /* we render into a multisampled framebuffer with a stencil buffer and resolve it into the texture */
+    _TARP_ASSERT_NO_GL_ERROR(glGenRenderbuffers(1, &_layer->msaaColor));
+    _TARP_ASSERT_NO_GL_ERROR(glBindRenderbuffer(GL_RENDERBUFFER, _layer->msaaColor));
+    _TARP_ASSERT_NO_GL_ERROR(glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_RGBA8, _width, _height));
+    _TARP_ASSERT_NO_GL_ERROR(glGenRenderbuffers(1, &_layer->msaaStencil));
+    _TARP_ASSERT_NO_GL_ERROR(glBindRenderbuffer(GL_RENDERBUFFER, _layer->msaaStencil));
+    _TARP_ASSERT_NO_GL_ERROR(glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_DEPTH24_STENCIL8, _width, _height));
+    _TARP_ASSERT_NO_GL_ERROR(glBindRenderbuffer(GL_RENDERBUFFER, 0));
+
+    _TARP_ASSERT_NO_GL_ERROR(glGenFramebuffers(1, &_layer->msaaFbo));
+    _TARP_ASSERT_NO_GL_ERROR(glBindFramebuffer(GL_FRAMEBUFFER, _layer->msaaFbo));
+    _tpGLObjectLabel(GL_FRAMEBUFFER, _layer->msaaFbo, "tarp layer", _layer);
+    _TARP_ASSERT_NO_GL_ERROR(glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, _layer->msaaColor));
+    _TARP_ASSERT_NO_GL_ERROR(glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, _layer->msaaStencil));
+
+    _layer->width = _width;
+    _layer->height = _height;
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        _tpGLSetErrorMessage("Could not create the framebuffer for a layer.");
+        return tpTrue;
+    }
+    return tpFalse;
+}
+
+/* renders the content of a layer into its texture at 2^_bucket pixels per layer unit */
+TARP_LOCAL tpBool _tpGLLayerRender(_tpGLContext * _ctx, _tpGLLayer * _layer, int _bucket)
+{
+    int width, height, border, rasterBucket;
+    tpFloat scale, scaleX, scaleY;
+    tpBool err;
+    GLint drawFbo, readFbo, viewport[4], ctxViewport[4];
+    GLboolean scissorTest;
+    GLfloat clearColor[4];
+    tpTransform transform, layerTransform;
+    tpMat4 projection, layerProjection;
+    _tpGLPath * clippingStack[TARP_GL_MAX_CLIPPING_STACK_DEPTH];
+    int clippingStackDepth, currentClipStencilPlane;
+    tpBool bCanSwapStencilPlanes;
+    _tpGLDepthKeyArray depthKeys;
+
+    /* use a smaller scale if the texture would get too big, tiles repeat so they don't get a border */
+    border = _layer->bTile ? 0 : 2;
+    rasterBucket = _bucket;
+    for (;;)
+    {
+        scale = (tpFloat)ldexp(1.0, rasterBucket);
+        width = TARP_MAX((int)ceil((_layer->bounds.max.x - _layer->bounds.min.x) * scale), 1) + border;
+        height = TARP_MAX((int)ceil((_layer->bounds.max.y - _layer->bounds.min.y) * scale), 1) + border;
+        if (width <= TARP_GL_MAX_LAYER_SIZE && height <= TARP_GL_MAX_LAYER_SIZE)
+            break;
+        rasterBucket--;
+    }
+
+    if ((width != _layer->width || height != _layer->height) && _tpGLLayerAllocateTargets(_layer, width, height))
+    {
+        _tpGLLayerDeallocateTargets(_layer);
+        return tpTrue;
+    }
+
+    /* save everything that rendering the layer changes */
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &drawFbo);
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &readFbo);
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glGetFloatv(GL_COLOR_CLEAR_VALUE, clearColor);
+    scissorTest = glIsEnabled(GL_SCISSOR_TEST);
+    transform = _ctx->transform;
+    projection = _ctx->projection;
+    memcpy(ctxViewport, _ctx->viewport, sizeof(ctxViewport));
+    memcpy(clippingStack, _ctx->clippingStack, sizeof(clippingStack));
+    clippingStackDepth = _ctx->clippingStackDepth;
+    currentClipStencilPlane = _ctx->currentClipStencilPlane;
+    bCanSwapStencilPlanes = _ctx->bCanSwapStencilPlanes;
+    /* a depth ordered replay of another list might be iterating its depth keys */
+    depthKeys = _ctx->tmpDepthKeys;
+    memset(&_ctx->tmpDepthKeys, 0, sizeof(_ctx->tmpDepthKeys));
+
+    _TARP_ASSERT_NO_GL_ERROR(glBindFramebuffer(GL_FRAMEBUFFER, _layer->msaaFbo));
+    _TARP_ASSERT_NO_GL_ERROR(glViewport(0, 0, width, height));
+    _ctx->viewport[0] = 0;
+    _ctx->viewport[1] = 0;
+    _ctx->viewport[2] = width;
+    _ctx->viewport[3] = height;
+    _TARP_ASSERT_NO_GL_ERROR(glDisable(GL_SCISSOR_TEST));
+    _TARP_ASSERT_NO_GL_ERROR(glClearColor(0, 0, 0, 0));
+    _TARP_ASSERT_NO_GL_ERROR(glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE));
+    _TARP_ASSERT_NO_GL_ERROR(glStencilMask(_kTpGLFillRasterStencilPlane | _kTpGLClippingStencilPlaneOne | _kTpGLClippingStencilPlaneTwo | _kTpGLStrokeRasterStencilPlane));
+    _TARP_ASSERT_NO_GL_ERROR(glClearStencil(255));
+    _TARP_ASSERT_NO_GL_ERROR(glClear(GL_COLOR_BUFFER_BIT | GL_STENCIL_BUFFER_BIT));
+
+    /* the texture holds premultiplied colors so it composites correctly */
+    _TARP_ASSERT_NO_GL_ERROR(glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA));
+
+    /*
+    map the layer bounds to the texture, leaving a one pixel border. A tile is stretched to cover the
+    texture exactly instead.
+    */
+    layerProjection = tpMat4MakeOrtho(0, width, 0, height, -1, 1);
+    _tpGLSetProjection(_ctx, &layerProjection);
+    if (_layer->bTile)
+    {
+        scaleX = width / (_layer->bounds.max.x - _layer->bounds.min.x);
+        scaleY = height / (_layer->bounds.max.y - _layer->bounds.min.y);
+        layerTransform = tpTransformMake(scaleX, 0, -_layer->bounds.min.x * scaleX,
+                                         0, scaleY, -_layer->bounds.min.y * scaleY);
+    }
+    else
+    {
+        layerTransform = tpTransformMake(scale, 0, 1 - _layer->bounds.min.x * scale,
+                                         0, scale, 1 - _layer->bounds.min.y * scale);
+    }
+    _ctx->clippingStackDepth = 0;
+    _ctx->currentClipStencilPlane = _kTpGLClippingStencilPlaneOne;
+    _ctx->bCanSwapStencilPlanes = tpTrue;
+
+    err = _tpGLReplayCommands(_ctx, &_layer->list, NULL, &layerTransform);
+
+    /* resolve the samples into the texture */
+    _ctx->debugPass = "resolve";
+    _ctx->debugObject = _layer;
+    _TARP_ASSERT_NO_GL_ERROR(glBindFramebuffer(GL_READ_FRAMEBUFFER, _layer->msaaFbo));
+    _TARP_ASSERT_NO_GL_ERROR(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _layer->fbo));
+    _TARP_ASSERT_NO_GL_ERROR(glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST));
+    _TARP_ASSERT_NO_GL_ERROR(glBindTexture(GL_TEXTURE_2D, _layer->texture));
+    _TARP_ASSERT_NO_GL_ERROR(glGenerateMipmap(GL_TEXTURE_2D));
+
+    /* restore */
+    _TARP_ASSERT_NO_GL_ERROR(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, drawFbo));
+    _TARP_ASSERT_NO_GL_ERROR(glBindFramebuffer(GL_READ_FRAMEBUFFER, readFbo));
+    _TARP_ASSERT_NO_GL_ERROR(glViewport(viewport[0], viewport[1], viewport[2], viewport[3]));
+    _TARP_ASSERT_NO_GL_ERROR(glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]));
+    if (scissorTest)
+        _TARP_ASSERT_NO_GL_ERROR(glEnable(GL_SCISSOR_TEST));
+    _TARP_ASSERT_NO_GL_ERROR(glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
+    _tpGLSetTransform(_ctx, &transform);
+    _tpGLSetProjection(_ctx, &projection);
+    memcpy(_ctx->viewport, ctxViewport, sizeof(ctxViewport));
+    memcpy(_ctx->clippingStack, clippingStack, sizeof(clippingStack));
+    _ctx->clippingStackDepth = clippingStackDepth;
+    _ctx->currentClipStencilPlane = currentClipStencilPlane;
+    _ctx->bCanSwapStencilPlanes = bCanSwapStencilPlanes;
+    _tpGLDepthKeyArrayDeallocate(&_ctx->tmpDepthKeys);
+    _ctx->tmpDepthKeys = depthKeys;
+
+    if (_layer->bTile)
+    {
+        _layer->rasterBounds = _layer->bounds;
+    }
+    else
+    {
+        _layer->rasterBounds.min = tpVec2Make(_layer->bounds.min.x - 1 / scale, _layer->bounds.min.y - 1 / scale);
+        _layer->rasterBounds.max = tpVec2Make(_layer->rasterBounds.min.x + width / scale, _layer->rasterBounds.min.y + height / scale);
+    }
+    _layer->rasterBucket = _bucket;
+    _layer->bDirty = err;
+
+    return err;
+}
+
+TARP_LOCAL tpBool _tpGLDrawLayerImpl(_tpGLContext * _ctx, _tpGLLayer * _layer)
+{
+    int bucket;
+    tpFloat vertices[16];
+    GLuint stencilPlaneToTestAgainst;
+    _tpGLRect * r = &_layer->rasterBounds;
+
+    _tpGLLayerUpdate(_layer);
+    if (_layer->bounds.min.x > _layer->bounds.max.x)
+        return tpFalse;
+    if (_tpGLEnsureLayerProgram(_ctx))
+        return tpTrue;
+
+    /*
+    the layer is rendered at the next power of two of the pixels per layer unit it is drawn with, so
+    it only needs to be rendered again if that crosses a power of two.
+    */
+    frexp(_tpGLPixelScale(_ctx), &bucket);
+    if ((_layer->bDirty || bucket != _layer->rasterBucket) && _tpGLLayerRender(_ctx, _layer, bucket))
+        return tpTrue;
+
+    _ctx->debugPass = "composite";
+    _ctx->debugObject = _layer;
+
+    if (_ctx->bTransformProjDirty)
+    {
+        _ctx->bTransformProjDirty = tpFalse;
+        _ctx->renderTransform = tpMat4MakeFrom2DTransform(&_ctx->transform);
+        _ctx->transformProjection = tpMat4Mult(&_ctx->projection, &_ctx->renderTransform);
+    }
+
+    /* a textured quad covering the layer bounds as a triangle strip */
+    vertices[0] = r->min.x; vertices[1] = r->min.y; vertices[2] = 0; vertices[3] = 0;
+    vertices[4] = r->min.x; vertices[5] = r->max.y; vertices[6] = 0; vertices[7] = 1;
+    vertices[8] = r->max.x; vertices[9] = r->min.y; vertices[10] = 1; vertices[11] = 0;
+    vertices[12] = r->max.x; vertices[13] = r->max.y; vertices[14] = 1; vertices[15] = 1;
+
+    _TARP_ASSERT_NO_GL_ERROR(glUseProgram(_ctx->layerProgram));
+    _tpGLUploadMatrix(_ctx, _ctx->tpLayerLoc, &_ctx->transformProjection);
+    _TARP_ASSERT_NO_GL_ERROR(glActiveTexture(GL_TEXTURE0));
+    _TARP_ASSERT_NO_GL_ERROR(glBindTexture(GL_TEXTURE_2D, _layer->texture));
+    _TARP_ASSERT_NO_GL_ERROR(glBindVertexArray(_ctx->layerVao.vao));
+    _TARP_ASSERT_NO_GL_ERROR(glBindBuffer(GL_ARRAY_BUFFER, _ctx->layerVao.vbo));
+    _tpGLUpdateVAO(&_ctx->layerVao, vertices, sizeof(vertices));
+
+    /* only test against the clipping planes */
+    stencilPlaneToTestAgainst = _ctx->currentClipStencilPlane == _kTpGLClippingStencilPlaneOne ? _kTpGLClippingStencilPlaneTwo : _kTpGLClippingStencilPlaneOne;
+    _TARP_ASSERT_NO_GL_ERROR(glStencilMask(0));
+    _TARP_ASSERT_NO_GL_ERROR(glStencilFunc(_ctx->clippingStackDepth ? GL_NOTEQUAL : GL_ALWAYS, 0, stencilPlaneToTestAgainst));
+    _TARP_ASSERT_NO_GL_ERROR(glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE));
+    _TARP_ASSERT_NO_GL_ERROR(glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA));
+
+    _TARP_ASSERT_NO_GL_ERROR(glDrawArrays(GL_TRIANGLE_STRIP, 0, 4));
+
+    _TARP_ASSERT_NO_GL_ERROR(glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
+    _TARP_ASSERT_NO_GL_ERROR(glUseProgram(_ctx->program));
+    _TARP_ASSERT_NO_GL_ERROR(glBindVertexArray(_ctx->vao.vao));
+
+    return tpFalse;
+}
+
+TARP_API tpBool tpDrawLayer(tpContext _ctx, tpLayer _layer)
+{
+    _tpGLContext * ctx = (_tpGLContext *)_ctx.pointer;
+    _tpGLLayer * layer = (_tpGLLayer *)_layer.pointer;
+
+    if (ctx->currentLayer)
+    {
+        _tpGLSetErrorMessage("Layers can't be drawn into other layers.");
+        return tpTrue;
+    }
+    if (ctx->recordList)
+        return _tpGLRecordCommand(ctx, _kTpGLCommandDrawLayer, NULL, layer, NULL);
+    return _tpGLDrawLayerImpl(ctx, layer);
+}
+
+TARP_API tpPattern tpPatternCreate(tpFloat _tileWidth, tpFloat _tileHeight)
+{
+    tpPattern ret = {NULL};
+    tpLayer layer;
+    _tpGLLayer * tile;
+
+    if (_tileWidth <= 0 || _tileHeight <= 0)
+    {
+        _tpGLSetErrorMessage("The tile of a pattern needs a positive size.");
+        return ret;
+    }
+
+    /* the tile is recorded and rendered like a layer */
+    layer = tpLayerCreate();
+    tile = (_tpGLLayer *)layer.pointer;
+    if (!tile)
+        return ret;
+
+    tile->bTile = tpTrue;
+    tile->bounds.min = tpVec2Make(0, 0);
+    tile->bounds.max = tpVec2Make(_tileWidth, _tileHeight);
+
+    ret.pointer = tile;
+    return ret;
+}
+
+TARP_API void tpPatternDestroy(tpPattern _pattern)
+{
+    tpLayer layer;
+    layer.pointer = _pattern.pointer;
+    tpLayerDestroy(layer);
+}
+
+TARP_API tpBool tpPatternAddPath(tpPattern _pattern, tpPath _path, const tpStyle * _style)
+{
+    _tpGLCommand cmd;
+    _tpGLLayer * tile = (_tpGLLayer *)_pattern.pointer;
+    tpTransform identity = tpTransformMakeIdentity();
+
+    if (_style->fill.type == kTpPaintTypePattern || _style->stroke.type == kTpPaintTypePattern)
+    {
+        _tpGLSetErrorMessage("Patterns can't be nested.");
+        return tpTrue;
+    }
+
+    memset(&cmd, 0, sizeof(cmd));
+    cmd.type = _kTpGLCommandDrawPath;
+    cmd.path = (_tpGLPath *)_path.pointer;
+    cmd.transform = identity;
+    cmd.projection = tpMat4MakeIdentity();
+    cmd.match = -1;
+    if (_tpGLCommandSetStyle(&tile->list, &cmd, cmd.path, _style))
+        return tpTrue;
+    _tpGLPathTransformedBounds(cmd.path, _style, &identity, &cmd.bounds);
+
+    if (_tpGLCommandArrayAppendPtr(&tile->list.commands, &cmd))
+    {
+        _tpGLSetErrorMessage("Could not allocate memory for the recorded commands.");
+        return tpTrue;
+    }
+    tile->version = _tpGLNextVersion();
+    tile->bDirty = tpTrue;
+    return tpFalse;
+}
+
+TARP_API void tpPatternClear(tpPattern _pattern)
+{
+    _tpGLLayer * tile = (_tpGLLayer *)_pattern.pointer;
+    _tpGLCommandListClear(&tile->list);
+    tile->version = _tpGLNextVersion();
+    tile->bDirty = tpTrue;
+}
+
 #endif /* TARP_IMPLEMENTATION_OPENGL */
 #endif /* TARP_IMPLEMENTATION */
 
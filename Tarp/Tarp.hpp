@@ -0,0 +1,844 @@
+/* See Tarp.h for info */
+/*
+Optional, header only C++ wrapper around the Tarp C API. It provides move only RAII types
+for the Tarp handles, overloads that take spans for bulk segment, polyline and command import
+and template helpers to build paths from your own point types.
+
+It does not contain any implementation, so you still have to create the Tarp implementation in one of
+your source files as described in Tarp.h. All functions follow the C API and return tpTrue on error
+(see tpErrorMessage).
+*/
+
+#ifndef TARP_TARP_HPP
+#define TARP_TARP_HPP
+
+#include <Tarp/Tarp.h>
+
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace tarp
+{
+/*
+Non owning view of contiguous memory. It can be constructed from pointer and count, built in arrays and any
+container that has data() and size() member functions (i.e. std::vector, std::array and std::span).
+*/
+template<class T>
+class Span
+{
+public:
+
+    Span() :
+        m_data(nullptr),
+        m_size(0)
+    {
+    }
+
+    Span(T * _data, std::size_t _size) :
+        m_data(_data),
+        m_size(_size)
+    {
+    }
+
+    template<std::size_t N>
+    Span(T (&_array)[N]) :
+        m_data(_array),
+        m_size(N)
+    {
+    }
+
+    template<class C, class = typename std::enable_if <
+                 !std::is_same<typename std::decay<C>::type, Span>::value &&
+                 std::is_convertible<decltype(std::declval<C &>().data()), T *>::value >::type >
+    Span(C && _container) :
+        m_data(_container.data()),
+        m_size(_container.size())
+    {
+    }
+
+    T * data() const
+    {
+        return m_data;
+    }
+
+    std::size_t size() const
+    {
+        return m_size;
+    }
+
+    bool empty() const
+    {
+        return m_size == 0;
+    }
+
+    T * begin() const
+    {
+        return m_data;
+    }
+
+    T * end() const
+    {
+        return m_data + m_size;
+    }
+
+    T & operator [](std::size_t _index) const
+    {
+        return m_data[_index];
+    }
+
+private:
+
+    T * m_data;
+    std::size_t m_size;
+};
+
+/*
+Tells the template helpers how to read the coordinates of a point type. The default works for
+all types with public x and y members, specialize it for anything else.
+*/
+template<class P>
+struct PointTraits
+{
+    static tpFloat x(const P & _p)
+    {
+        return static_cast<tpFloat>(_p.x);
+    }
+
+    static tpFloat y(const P & _p)
+    {
+        return static_cast<tpFloat>(_p.y);
+    }
+};
+
+namespace detail
+{
+/* scratch buffer that is reused by the template helpers to avoid allocating for every call */
+inline std::vector<tpFloat> & scratchCoordinates()
+{
+    static thread_local std::vector<tpFloat> s_coords;
+    return s_coords;
+}
+
+template<class Range>
+inline const tpFloat * packCoordinates(const Range & _points, int & _outCount)
+{
+    typedef typename std::decay<decltype(*std::begin(_points))>::type PointType;
+
+    std::vector<tpFloat> & coords = scratchCoordinates();
+    coords.clear();
+    for (const auto & pt : _points)
+    {
+        coords.push_back(PointTraits<PointType>::x(pt));
+        coords.push_back(PointTraits<PointType>::y(pt));
+    }
+    _outCount = static_cast<int>(coords.size() / 2);
+    return coords.data();
+}
+}
+
+/*
+Move only owner of a Tarp handle that calls DestroyFn on the handle once it goes out of scope.
+Use get() to pass the handle to the C API.
+*/
+template<class H, void (*DestroyFn)(H)>
+class Handle
+{
+public:
+
+    Handle()
+    {
+        m_handle.pointer = nullptr;
+    }
+
+    explicit Handle(H _handle) :
+        m_handle(_handle)
+    {
+    }
+
+    Handle(Handle && _other) noexcept :
+        m_handle(_other.release())
+    {
+    }
+
+    Handle(const Handle &) = delete;
+
+    Handle & operator = (const Handle &) = delete;
+
+    Handle & operator = (Handle && _other) noexcept
+    {
+        if (this != &_other)
+            reset(_other.release());
+        return *this;
+    }
+
+    ~Handle()
+    {
+        reset();
+    }
+
+    /* destroys the owned handle (if any) and takes ownership of _handle */
+    void reset(H _handle = H())
+    {
+        if (m_handle.pointer)
+            DestroyFn(m_handle);
+        m_handle = _handle;
+    }
+
+    /* gives up ownership of the handle without destroying it */
+    H release()
+    {
+        H ret = m_handle;
+        m_handle.pointer = nullptr;
+        return ret;
+    }
+
+    H get() const
+    {
+        return m_handle;
+    }
+
+    explicit operator bool() const
+    {
+        return m_handle.pointer != nullptr;
+    }
+
+protected:
+
+    H m_handle;
+};
+
+class Path : public Handle<tpPath, tpPathDestroy>
+{
+public:
+
+    Path() = default;
+
+    explicit Path(tpPath _path) :
+        Handle(_path)
+    {
+    }
+
+    static Path create()
+    {
+        return Path(tpPathCreate());
+    }
+
+    Path clone() const
+    {
+        return Path(tpPathClone(m_handle));
+    }
+
+    tpBool moveTo(tpFloat _x, tpFloat _y)
+    {
+        return tpPathMoveTo(m_handle, _x, _y);
+    }
+
+    tpBool lineTo(tpFloat _x, tpFloat _y)
+    {
+        return tpPathLineTo(m_handle, _x, _y);
+    }
+
+    tpBool cubicCurveTo(tpFloat _h0x, tpFloat _h0y, tpFloat _h1x, tpFloat _h1y, tpFloat _px, tpFloat _py)
+    {
+        return tpPathCubicCurveTo(m_handle, _h0x, _h0y, _h1x, _h1y, _px, _py);
+    }
+
+    tpBool quadraticCurveTo(tpFloat _hx, tpFloat _hy, tpFloat _px, tpFloat _py)
+    {
+        return tpPathQuadraticCurveTo(m_handle, _hx, _hy, _px, _py);
+    }
+
+    template<class P>
+    tpBool moveTo(const P & _p)
+    {
+        return moveTo(PointTraits<P>::x(_p), PointTraits<P>::y(_p));
+    }
+
+    template<class P>
+    tpBool lineTo(const P & _p)
+    {
+        return lineTo(PointTraits<P>::x(_p), PointTraits<P>::y(_p));
+    }
+
+    template<class P>
+    tpBool cubicCurveTo(const P & _h0, const P & _h1, const P & _p)
+    {
+        return cubicCurveTo(PointTraits<P>::x(_h0), PointTraits<P>::y(_h0),
+                            PointTraits<P>::x(_h1), PointTraits<P>::y(_h1),
+                            PointTraits<P>::x(_p), PointTraits<P>::y(_p));
+    }
+
+    template<class P>
+    tpBool quadraticCurveTo(const P & _h, const P & _p)
+    {
+        return quadraticCurveTo(PointTraits<P>::x(_h), PointTraits<P>::y(_h),
+                                PointTraits<P>::x(_p), PointTraits<P>::y(_p));
+    }
+
+    tpBool close()
+    {
+        return tpPathClose(m_handle);
+    }
+
+    tpBool clear()
+    {
+        return tpPathClear(m_handle);
+    }
+
+    tpBool addCircle(tpFloat _x, tpFloat _y, tpFloat _r)
+    {
+        return tpPathAddCircle(m_handle, _x, _y, _r);
+    }
+
+    tpBool addEllipse(tpFloat _x, tpFloat _y, tpFloat _width, tpFloat _height)
+    {
+        return tpPathAddEllipse(m_handle, _x, _y, _width, _height);
+    }
+
+    tpBool addRect(tpFloat _x, tpFloat _y, tpFloat _width, tpFloat _height)
+    {
+        return tpPathAddRect(m_handle, _x, _y, _width, _height);
+    }
+
+    /* the C API does not modify the segments, it only lacks the const qualifier */
+    tpBool addSegments(Span<const tpSegment> _segments)
+    {
+        return tpPathAddSegments(m_handle, const_cast<tpSegment *>(_segments.data()), static_cast<int>(_segments.size()));
+    }
+
+    tpBool addContour(Span<const tpSegment> _segments, tpBool _bClosed = tpFalse)
+    {
+        return tpPathAddContour(m_handle, const_cast<tpSegment *>(_segments.data()), static_cast<int>(_segments.size()), _bClosed);
+    }
+
+    tpBool setContour(int _contourIndex, Span<const tpSegment> _segments, tpBool _bClosed = tpFalse)
+    {
+        return tpPathSetContour(m_handle, _contourIndex, const_cast<tpSegment *>(_segments.data()),
+                                static_cast<int>(_segments.size()), _bClosed);
+    }
+
+    tpBool addPolyline(Span<const tpVec2> _points, tpBool _bClosed = tpFalse)
+    {
+        return tpPathAddPolyline(m_handle, reinterpret_cast<const tpFloat *>(_points.data()),
+                                 static_cast<int>(_points.size()), _bClosed);
+    }
+
+    /* _xy holds the interleaved coordinates of the points (x0, y0, x1, y1...) */
+    tpBool addPolyline(Span<const tpFloat> _xy, tpBool _bClosed = tpFalse)
+    {
+        return tpPathAddPolyline(m_handle, _xy.data(), static_cast<int>(_xy.size() / 2), _bClosed);
+    }
+
+    /*
+    Adds a polyline contour from any range of points that PointTraits understands (i.e. std::vector<MyVec2>)
+    without building an intermediate segment array.
+    */
+    template<class Range>
+    tpBool addPolylinePoints(const Range & _points, tpBool _bClosed = tpFalse)
+    {
+        int count;
+        const tpFloat * xy = detail::packCoordinates(_points, count);
+        return tpPathAddPolyline(m_handle, xy, count, _bClosed);
+    }
+
+    tpBool addCommands(Span<const tpPathCommand> _commands, Span<const tpFloat> _coords)
+    {
+        return tpPathAddCommands(m_handle, _commands.data(), static_cast<int>(_commands.size()),
+                                 _coords.data(), static_cast<int>(_coords.size()));
+    }
+
+    /* same as above, but takes the coordinates from any range of points that PointTraits understands */
+    template<class Range>
+    tpBool addCommandPoints(Span<const tpPathCommand> _commands, const Range & _points)
+    {
+        int count;
+        const tpFloat * xy = detail::packCoordinates(_points, count);
+        return tpPathAddCommands(m_handle, _commands.data(), static_cast<int>(_commands.size()), xy, count * 2);
+    }
+
+    tpBool removeContour(int _contourIndex)
+    {
+        return tpPathRemoveContour(m_handle, _contourIndex);
+    }
+
+    tpBool removeSegment(int _contourIndex, int _segmentIndex)
+    {
+        return tpPathRemoveSegment(m_handle, _contourIndex, _segmentIndex);
+    }
+
+    tpBool removeSegments(int _contourIndex, int _from, int _to)
+    {
+        return tpPathRemoveSegments(m_handle, _contourIndex, _from, _to);
+    }
+
+    int contourCount() const
+    {
+        return tpPathContourCount(m_handle);
+    }
+
+    tpBool setFillPaintTransform(const tpTransform & _transform)
+    {
+        return tpPathSetFillPaintTransform(m_handle, &_transform);
+    }
+
+    tpBool setStrokePaintTransform(const tpTransform & _transform)
+    {
+        return tpPathSetStrokePaintTransform(m_handle, &_transform);
+    }
+
+    tpBool setTransform(const tpTransform & _transform)
+    {
+        return tpPathSetTransform(m_handle, &_transform);
+    }
+
+    tpBool setSimplifyTolerance(tpFloat _tolerance)
+    {
+        return tpPathSetSimplifyTolerance(m_handle, _tolerance);
+    }
+
+    tpBool setQualityHints(const tpQualityHints & _hints)
+    {
+        return tpPathSetQualityHints(m_handle, &_hints);
+    }
+
+    tpBool setFrozenTopology(tpBool _bFrozen)
+    {
+        return tpPathSetFrozenTopology(m_handle, _bFrozen);
+    }
+
+    tpBool tessellate(const tpStyle & _style, tpFloat _scale, const tpTessellationCallbacks & _callbacks) const
+    {
+        return tpPathTessellate(m_handle, &_style, _scale, &_callbacks);
+    }
+
+    tpBool hitTestFill(tpFloat _x, tpFloat _y, tpFillRule _fillRule) const
+    {
+        return tpPathHitTestFill(m_handle, _x, _y, _fillRule);
+    }
+
+    tpBool hitTestStroke(const tpStyle & _style, tpFloat _x, tpFloat _y) const
+    {
+        return tpPathHitTestStroke(m_handle, &_style, _x, _y);
+    }
+};
+
+class Gradient : public Handle<tpGradient, tpGradientDestroy>
+{
+public:
+
+    Gradient() = default;
+
+    explicit Gradient(tpGradient _gradient) :
+        Handle(_gradient)
+    {
+    }
+
+    static Gradient createLinear(tpFloat _x0, tpFloat _y0, tpFloat _x1, tpFloat _y1)
+    {
+        return Gradient(tpGradientCreateLinear(_x0, _y0, _x1, _y1));
+    }
+
+    static Gradient createRadial(tpFloat _fx, tpFloat _fy, tpFloat _ox, tpFloat _oy, tpFloat _dx, tpFloat _dy, tpFloat _ratio)
+    {
+        return Gradient(tpGradientCreateRadial(_fx, _fy, _ox, _oy, _dx, _dy, _ratio));
+    }
+
+    static Gradient createRadialSymmetric(tpFloat _x, tpFloat _y, tpFloat _r)
+    {
+        return Gradient(tpGradientCreateRadialSymmetric(_x, _y, _r));
+    }
+
+    Gradient clone() const
+    {
+        return Gradient(tpGradientClone(m_handle));
+    }
+
+    void setPositions(tpFloat _x0, tpFloat _y0, tpFloat _x1, tpFloat _y1)
+    {
+        tpGradientSetPositions(m_handle, _x0, _y0, _x1, _y1);
+    }
+
+    void setFocalPointOffset(tpFloat _x, tpFloat _y)
+    {
+        tpGradientSetFocalPointOffset(m_handle, _x, _y);
+    }
+
+    void setRatio(tpFloat _ratio)
+    {
+        tpGradientSetRatio(m_handle, _ratio);
+    }
+
+    void addColorStop(tpFloat _r, tpFloat _g, tpFloat _b, tpFloat _a, tpFloat _offset)
+    {
+        tpGradientAddColorStop(m_handle, _r, _g, _b, _a, _offset);
+    }
+
+    void clearColorStops()
+    {
+        tpGradientClearColorStops(m_handle);
+    }
+
+    /* the returned paint does not own the gradient, keep the gradient alive while it is in use */
+    tpPaint paint() const
+    {
+        return tpPaintMakeGradient(m_handle);
+    }
+};
+
+class Style : public Handle<tpStyleHandle, tpStyleDestroy>
+{
+public:
+
+    Style() = default;
+
+    explicit Style(tpStyleHandle _style) :
+        Handle(_style)
+    {
+    }
+
+    static Style create()
+    {
+        return Style(tpStyleCreate());
+    }
+
+    static Style create(const tpStyle & _style)
+    {
+        return Style(tpStyleCreateFrom(&_style));
+    }
+
+    Style clone() const
+    {
+        return Style(tpStyleClone(m_handle));
+    }
+
+    tpBool set(const tpStyle & _style)
+    {
+        return tpStyleSet(m_handle, &_style);
+    }
+
+    /* the dash array of the returned style points into the handle */
+    tpStyle style() const
+    {
+        return tpStyleGet(m_handle);
+    }
+
+    void setFill(tpPaint _paint)
+    {
+        tpStyleSetFill(m_handle, _paint);
+    }
+
+    void setFillColor(tpFloat _r, tpFloat _g, tpFloat _b, tpFloat _a)
+    {
+        tpStyleSetFillColor(m_handle, _r, _g, _b, _a);
+    }
+
+    void setFillGradient(const Gradient & _gradient)
+    {
+        tpStyleSetFillGradient(m_handle, _gradient.get());
+    }
+
+    void setFillRule(tpFillRule _fillRule)
+    {
+        tpStyleSetFillRule(m_handle, _fillRule);
+    }
+
+    void setStroke(tpPaint _paint)
+    {
+        tpStyleSetStroke(m_handle, _paint);
+    }
+
+    void setStrokeColor(tpFloat _r, tpFloat _g, tpFloat _b, tpFloat _a)
+    {
+        tpStyleSetStrokeColor(m_handle, _r, _g, _b, _a);
+    }
+
+    void setStrokeGradient(const Gradient & _gradient)
+    {
+        tpStyleSetStrokeGradient(m_handle, _gradient.get());
+    }
+
+    void setStrokeWidth(tpFloat _width)
+    {
+        tpStyleSetStrokeWidth(m_handle, _width);
+    }
+
+    void setStrokeJoin(tpStrokeJoin _join)
+    {
+        tpStyleSetStrokeJoin(m_handle, _join);
+    }
+
+    void setStrokeCap(tpStrokeCap _cap)
+    {
+        tpStyleSetStrokeCap(m_handle, _cap);
+    }
+
+    void setMiterLimit(tpFloat _limit)
+    {
+        tpStyleSetMiterLimit(m_handle, _limit);
+    }
+
+    void setScaleStroke(tpBool _bScaleStroke)
+    {
+        tpStyleSetScaleStroke(m_handle, _bScaleStroke);
+    }
+
+    tpBool setDashArray(Span<const tpFloat> _dashArray)
+    {
+        return tpStyleSetDashArray(m_handle, _dashArray.data(), static_cast<int>(_dashArray.size()));
+    }
+
+    void setDashOffset(tpFloat _offset)
+    {
+        tpStyleSetDashOffset(m_handle, _offset);
+    }
+};
+
+class SpatialIndex : public Handle<tpSpatialIndex, tpSpatialIndexDestroy>
+{
+public:
+
+    SpatialIndex() = default;
+
+    explicit SpatialIndex(tpSpatialIndex _index) :
+        Handle(_index)
+    {
+    }
+
+    static SpatialIndex create(tpFloat _cellSize)
+    {
+        return SpatialIndex(tpSpatialIndexCreate(_cellSize));
+    }
+
+    tpBool insert(const Path & _path, const tpStyle & _style, const tpTransform * _transform = nullptr)
+    {
+        return tpSpatialIndexInsert(m_handle, _path.get(), &_style, _transform);
+    }
+
+    tpBool remove(const Path & _path)
+    {
+        return tpSpatialIndexRemove(m_handle, _path.get());
+    }
+
+    void clear()
+    {
+        tpSpatialIndexClear(m_handle);
+    }
+
+    int query(tpFloat _minX, tpFloat _minY, tpFloat _maxX, tpFloat _maxY, Span<tpPath> _outPaths) const
+    {
+        return tpSpatialIndexQuery(m_handle, _minX, _minY, _maxX, _maxY,
+                                   _outPaths.data(), static_cast<int>(_outPaths.size()));
+    }
+};
+
+class Layer : public Handle<tpLayer, tpLayerDestroy>
+{
+public:
+
+    Layer() = default;
+
+    explicit Layer(tpLayer _layer) :
+        Handle(_layer)
+    {
+    }
+
+    static Layer create()
+    {
+        return Layer(tpLayerCreate());
+    }
+};
+
+class Pattern : public Handle<tpPattern, tpPatternDestroy>
+{
+public:
+
+    Pattern() = default;
+
+    explicit Pattern(tpPattern _pattern) :
+        Handle(_pattern)
+    {
+    }
+
+    static Pattern create(tpFloat _tileWidth, tpFloat _tileHeight)
+    {
+        return Pattern(tpPatternCreate(_tileWidth, _tileHeight));
+    }
+
+    /* the path needs to stay alive for as long as the pattern is drawn */
+    tpBool addPath(const Path & _path, const tpStyle & _style)
+    {
+        return tpPatternAddPath(m_handle, _path.get(), &_style);
+    }
+
+    void clear()
+    {
+        tpPatternClear(m_handle);
+    }
+
+    /* the returned paint does not own the pattern, keep the pattern alive while it is in use */
+    tpPaint paint() const
+    {
+        return tpPaintMakePattern(m_handle);
+    }
+};
+
+class GlyphCache : public Handle<tpGlyphCache, tpGlyphCacheDestroy>
+{
+public:
+
+    GlyphCache() = default;
+
+    explicit GlyphCache(tpGlyphCache _cache) :
+        Handle(_cache)
+    {
+    }
+
+    static GlyphCache create(tpFloat _unitsPerEm)
+    {
+        return GlyphCache(tpGlyphCacheCreate(_unitsPerEm));
+    }
+
+    tpBool addGlyph(int _glyph, Span<const tpPathCommand> _commands, Span<const tpFloat> _coords)
+    {
+        return tpGlyphCacheAddGlyph(m_handle, _glyph, _commands.data(), static_cast<int>(_commands.size()),
+                                    _coords.data(), static_cast<int>(_coords.size()));
+    }
+
+    tpBool hasGlyph(int _glyph) const
+    {
+        return tpGlyphCacheHasGlyph(m_handle, _glyph);
+    }
+};
+
+class Context : public Handle<tpContext, tpContextDestroy>
+{
+public:
+
+    Context() = default;
+
+    explicit Context(tpContext _ctx) :
+        Handle(_ctx)
+    {
+    }
+
+    static Context create()
+    {
+        return Context(tpContextCreate());
+    }
+
+    static Context create(const tpContextOptions & _options)
+    {
+        return Context(tpContextCreateWithOptions(&_options));
+    }
+
+    int programCache(void * _outData, int _maxSize) const
+    {
+        return tpContextProgramCache(m_handle, _outData, _maxSize);
+    }
+
+    tpBool prepareDrawing()
+    {
+        return tpPrepareDrawing(m_handle);
+    }
+
+    tpBool finishDrawing()
+    {
+        return tpFinishDrawing(m_handle);
+    }
+
+    tpBool setProjection(const tpMat4 & _projection)
+    {
+        return tpSetProjection(m_handle, &_projection);
+    }
+
+    tpBool setTransform(const tpTransform & _transform)
+    {
+        return tpSetTransform(m_handle, &_transform);
+    }
+
+    tpBool resetTransform()
+    {
+        return tpResetTransform(m_handle);
+    }
+
+    tpBool drawPath(const Path & _path, const tpStyle & _style)
+    {
+        return tpDrawPath(m_handle, _path.get(), &_style);
+    }
+
+    tpBool drawPath(const Path & _path, const Style & _style)
+    {
+        return tpDrawPathWithStyle(m_handle, _path.get(), _style.get());
+    }
+
+    tpBool drawGlyphRun(const GlyphCache & _cache, Span<const tpGlyphInstance> _glyphs, tpFloat _size, tpColor _color)
+    {
+        return tpDrawGlyphRun(m_handle, _cache.get(), _glyphs.data(), static_cast<int>(_glyphs.size()), _size, _color);
+    }
+
+    tpBool beginClipping(const Path & _path)
+    {
+        return tpBeginClipping(m_handle, _path.get());
+    }
+
+    tpBool endClipping()
+    {
+        return tpEndClipping(m_handle);
+    }
+
+    tpBool resetClipping()
+    {
+        return tpResetClipping(m_handle);
+    }
+
+    tpBool setRetainedMode(tpBool _bEnabled, tpColor _clearColor)
+    {
+        return tpSetRetainedMode(m_handle, _bEnabled, _clearColor);
+    }
+
+    void invalidateRetainedFrame()
+    {
+        tpInvalidateRetainedFrame(m_handle);
+    }
+
+    int retainedDamage(Span<int> _outRects) const
+    {
+        return tpRetainedDamage(m_handle, _outRects.data(), static_cast<int>(_outRects.size() / 4));
+    }
+
+    tpBool beginLayer(const Layer & _layer)
+    {
+        return tpBeginLayer(m_handle, _layer.get());
+    }
+
+    tpBool endLayer()
+    {
+        return tpEndLayer(m_handle);
+    }
+
+    tpBool drawLayer(const Layer & _layer)
+    {
+        return tpDrawLayer(m_handle, _layer.get());
+    }
+
+    tpBool setDepthOrdering(tpBool _bEnabled)
+    {
+        return tpSetDepthOrdering(m_handle, _bEnabled);
+    }
+
+    tpBool setOcclusionCulling(tpBool _bEnabled)
+    {
+        return tpSetOcclusionCulling(m_handle, _bEnabled);
+    }
+
+    tpBool setMinimumPathSize(tpFloat _pixels, tpSmallPathMode _mode)
+    {
+        return tpSetMinimumPathSize(m_handle, _pixels, _mode);
+    }
+};
+}
+
+#endif /* TARP_TARP_HPP */
@@ -54,6 +54,7 @@ TARP_API void _TARP_FN(_TARP_ARRAY_T, Deallocate)(_TARP_ARRAY_T * _array)
     if (_array->array)
     {
         TARP_FREE(_array->array);
+        _array->array = NULL;
         _array->count = 0;
         _array->capacity = 0;
     }
@@ -45,7 +45,7 @@ int main(int argc, char * argv[])
     tpContext ctx = tpContextCreate();
     if (!tpContextIsValidHandle(ctx))
     {
-        printf("Could not init Tarp context: %s\n", tpContextErrorMessage(ctx));
+        printf("Could not init Tarp context: %s\n", tpErrorMessage());
         return EXIT_FAILURE;
     }
 
@@ -68,22 +68,22 @@ int main(int argc, char * argv[])
     tpPath squarePath = tpPathCreate();
     tpPathAddRect(squarePath, -32, -32, 64, 64);
     
-    tpStyle roundStyle = tpStyleCreate();
+    tpStyleHandle roundStyle = tpStyleCreate();
     tpStyleSetFillColor(roundStyle, 0, 0, 0, 0);
     tpStyleSetStrokeColor(roundStyle, 1, 1, 1, 1);
     tpStyleSetStrokeWidth(roundStyle, 16);
     tpStyleSetStrokeJoin(roundStyle, kTpStrokeJoinRound);
     tpStyleSetStrokeCap(roundStyle, kTpStrokeCapRound);
     
-    tpStyle miterStyle = tpStyleClone(roundStyle);
+    tpStyleHandle miterStyle = tpStyleClone(roundStyle);
     tpStyleSetStrokeJoin(miterStyle, kTpStrokeJoinMiter);
     tpStyleSetStrokeCap(miterStyle, kTpStrokeCapSquare);
     
-    tpStyle bevelStyle = tpStyleClone(roundStyle);
+    tpStyleHandle bevelStyle = tpStyleClone(roundStyle);
     tpStyleSetStrokeJoin(bevelStyle, kTpStrokeJoinBevel);
     tpStyleSetStrokeCap(bevelStyle, kTpStrokeCapButt);
     
-    tpStyle redStyle = tpStyleClone(bevelStyle);
+    tpStyleHandle redStyle = tpStyleClone(bevelStyle);
     tpStyleSetStrokeWidth(redStyle, 2);
     tpStyleSetStrokeColor(redStyle, 0.0f, 0.5f, 1.0f, 1.0f);
     
@@ -93,17 +93,17 @@ int main(int argc, char * argv[])
     tpGradientAddColorStop(grad0, 1.0f, 1.0f, 1.0f, 1.0f, 0.75f);
     tpGradientAddColorStop(grad0, 0.0f, 0.5f, 1.0f, 1.0f, 0.7501f);
     tpGradientAddColorStop(grad0, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f);
-    tpStyle gradStyle0 = tpStyleCreate();
+    tpStyleHandle gradStyle0 = tpStyleCreate();
     tpStyleSetFillGradient(gradStyle0, grad0);
     
     tpGradient grad1 = tpGradientClone(grad0);
     tpGradientSetPositions(grad1, -32, 16, 32, -16);
-    tpStyle gradStyle1 = tpStyleClone(gradStyle0);
+    tpStyleHandle gradStyle1 = tpStyleClone(gradStyle0);
     tpStyleSetFillGradient(gradStyle1, grad1);
     
     tpGradient grad2 = tpGradientClone(grad0);
     tpGradientSetPositions(grad2, -48, 48, 48, -48);
-    tpStyle gradStyle2 = tpStyleClone(gradStyle0);
+    tpStyleHandle gradStyle2 = tpStyleClone(gradStyle0);
     tpStyleSetFillGradient(gradStyle2, grad2);
     
     tpGradient rgrad0 = tpGradientCreateRadialSymmetric(0, 0, 32);
@@ -112,32 +112,32 @@ int main(int argc, char * argv[])
     tpGradientAddColorStop(rgrad0, 1.0f, 1.0f, 1.0f, 1.0f, 0.75f);
     tpGradientAddColorStop(rgrad0, 0.0f, 0.5f, 1.0f, 1.0f, 0.7501f);
     tpGradientAddColorStop(rgrad0, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f);
-    tpStyle rgradStyle0 = tpStyleClone(gradStyle0);
+    tpStyleHandle rgradStyle0 = tpStyleClone(gradStyle0);
     tpStyleSetFillGradient(rgradStyle0, rgrad0);
     
     tpGradient rgrad1 = tpGradientClone(rgrad0);
     tpGradientSetPositions(rgrad1, -32, 32, 32, 32);
-    tpStyle rgradStyle1 = tpStyleClone(rgradStyle0);
+    tpStyleHandle rgradStyle1 = tpStyleClone(rgradStyle0);
     tpStyleSetFillGradient(rgradStyle1, rgrad1);
     
     tpGradient rgrad2 = tpGradientClone(rgrad0);
     tpGradientSetPositions(rgrad2, 0, 0, 0, 0);
-    tpStyle rgradStyle2 = tpStyleClone(rgradStyle0);
+    tpStyleHandle rgradStyle2 = tpStyleClone(rgradStyle0);
     tpStyleSetFillGradient(rgradStyle2, rgrad2);
     
     tpGradient rgrad3 = tpGradientClone(rgrad0);
     tpGradientSetFocalPointOffset(rgrad3, 32, -32);
-    tpStyle rgradStyle3 = tpStyleClone(rgradStyle0);
+    tpStyleHandle rgradStyle3 = tpStyleClone(rgradStyle0);
     tpStyleSetFillGradient(rgradStyle3, rgrad3);
     
     tpGradient rgrad4 = tpGradientClone(rgrad1);
     tpGradientSetFocalPointOffset(rgrad4, 0, -64);
-    tpStyle rgradStyle4 = tpStyleClone(rgradStyle0);
+    tpStyleHandle rgradStyle4 = tpStyleClone(rgradStyle0);
     tpStyleSetFillGradient(rgradStyle4, rgrad4);
     
     tpGradient rgrad5 = tpGradientClone(rgrad2);
     tpGradientSetPositions(rgrad5, 64, 0, 32, 0);
-    tpStyle rgradStyle5 = tpStyleClone(rgradStyle0);
+    tpStyleHandle rgradStyle5 = tpStyleClone(rgradStyle0);
     tpStyleSetFillGradient(rgradStyle5, rgrad5);
     
     tpTransform distortion = tpTransformMake(-0.1, 0.9, 0.0,
@@ -161,65 +161,65 @@ int main(int argc, char * argv[])
         tpTransform transform;
         transform = tpTransformMakeTranslation(48, 32);
         tpSetTransform(ctx, &transform);
-        tpDrawPath(ctx, zigzagPath, roundStyle);
-        tpDrawPath(ctx, zigzagPath, redStyle);
+        tpDrawPathWithStyle(ctx, zigzagPath, roundStyle);
+        tpDrawPathWithStyle(ctx, zigzagPath, redStyle);
         
         transform = tpTransformMakeTranslation(48, 96);
         tpSetTransform(ctx, &transform);
-        tpDrawPath(ctx, zigzagPath, miterStyle);
-        tpDrawPath(ctx, zigzagPath, redStyle);
+        tpDrawPathWithStyle(ctx, zigzagPath, miterStyle);
+        tpDrawPathWithStyle(ctx, zigzagPath, redStyle);
         
         transform = tpTransformMakeTranslation(48, 160);
         tpSetTransform(ctx, &transform);
-        tpDrawPath(ctx, zigzagPath, bevelStyle);
-        tpDrawPath(ctx, zigzagPath, redStyle);
+        tpDrawPathWithStyle(ctx, zigzagPath, bevelStyle);
+        tpDrawPathWithStyle(ctx, zigzagPath, redStyle);
         
         /* linear gradients */
         transform = tpTransformMakeTranslation(128, 48);
         transform = tpTransformCombine(&transform, &distortion);
         tpSetTransform(ctx, &transform);
-        tpDrawPath(ctx, squarePath, gradStyle0);
+        tpDrawPathWithStyle(ctx, squarePath, gradStyle0);
         
         transform = tpTransformMakeTranslation(128, 128);
         transform = tpTransformCombine(&transform, &distortion);
         tpSetTransform(ctx, &transform);
-        tpDrawPath(ctx, squarePath, gradStyle1);
+        tpDrawPathWithStyle(ctx, squarePath, gradStyle1);
         
         transform = tpTransformMakeTranslation(128, 208);
         transform = tpTransformCombine(&transform, &distortion);
         tpSetTransform(ctx, &transform);
-        tpDrawPath(ctx, squarePath, gradStyle2);
+        tpDrawPathWithStyle(ctx, squarePath, gradStyle2);
         
         /* radial gradients */
         transform = tpTransformMakeTranslation(192, 48);
         transform = tpTransformCombine(&transform, &distortion);
         tpSetTransform(ctx, &transform);
-        tpDrawPath(ctx, squarePath, rgradStyle0);
+        tpDrawPathWithStyle(ctx, squarePath, rgradStyle0);
         
         transform = tpTransformMakeTranslation(192, 128);
         transform = tpTransformCombine(&transform, &distortion);
         tpSetTransform(ctx, &transform);
-        tpDrawPath(ctx, squarePath, rgradStyle1);
+        tpDrawPathWithStyle(ctx, squarePath, rgradStyle1);
         
         transform = tpTransformMakeTranslation(192, 208);
         transform = tpTransformCombine(&transform, &distortion);
         tpSetTransform(ctx, &transform);
-        tpDrawPath(ctx, squarePath, rgradStyle2);
+        tpDrawPathWithStyle(ctx, squarePath, rgradStyle2);
         
         transform = tpTransformMakeTranslation(256, 48);
         transform = tpTransformCombine(&transform, &distortion);
         tpSetTransform(ctx, &transform);
-        tpDrawPath(ctx, squarePath, rgradStyle3);
+        tpDrawPathWithStyle(ctx, squarePath, rgradStyle3);
         
         transform = tpTransformMakeTranslation(256, 128);
         transform = tpTransformCombine(&transform, &distortion);
         tpSetTransform(ctx, &transform);
-        tpDrawPath(ctx, squarePath, rgradStyle4);
+        tpDrawPathWithStyle(ctx, squarePath, rgradStyle4);
         
         transform = tpTransformMakeTranslation(256, 208);
         transform = tpTransformCombine(&transform, &distortion);
         tpSetTransform(ctx, &transform);
-        tpDrawPath(ctx, squarePath, rgradStyle5);
+        tpDrawPathWithStyle(ctx, squarePath, rgradStyle5);
 
         /* call this when you are done with Tarp for the frame */
         tpFinishDrawing(ctx);